@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include "data/tensor.h"
+
+namespace kuiper_infer {
+
+/*
+* @brief 内置的激活函数
+*
+* 超越函数使用多项式近似, 在[-20, 20]上与双精度结果比较的最大误差:
+* kSigmoid  绝对误差 < 2e-7
+* kTanh     绝对误差 < 2e-6
+* kSilu     绝对误差 < 1e-6 * max(1, |x|)
+* kGelu     绝对误差 < 1e-6 * max(1, |x|), 按erf计算, 与torch默认一致
+* kGeluTanh 绝对误差 < 2e-6 * max(1, |x|), torch的approximate='tanh'
+* kClip     截断到[alpha, beta], 即relu6/hardtanh/clamp
+* exp的相对误差 < 2e-7, 输入被截断到[-87.3, 88.3]
+*/
+enum class ActivationType {
+  kNone = 0,
+  kRelu = 1,
+  kLeakyRelu = 2,
+  kSigmoid = 3,
+  kTanh = 4,
+  kSilu = 5,
+  kGelu = 6,
+  kGeluTanh = 7,
+  kHardSwish = 8,
+  kClip = 9,
+};
+
+/*
+* @brief 逐元素计算激活函数
+*
+* 编译时支持AVX-512或AVX2+FMA时使用向量实现, 尾部和其他平台使用相同算法的标量实现
+* @param type 激活函数
+* @param input 输入
+* @param output 输出, 可以与输入相同
+* @param size 元素个数
+* @param alpha kLeakyRelu的负半轴斜率, kClip的下界
+* @param beta kClip的上界
+*/
+void ActivationForward(ActivationType type, const float* input, float* output, size_t size,
+                       float alpha = 0.01f, float beta = 0.f);
+
+/*
+* @brief 逐元素计算act(input + residual), 残差加法和激活函数在同一遍内完成
+*
+* 用于卷积和全连接层的输出后处理, 避免单独的加法算子再读写一遍输出
+* @param type 激活函数, kNone时只做加法
+* @param input 输入
+* @param residual 残差, 元素个数与输入相同
+* @param output 输出, 可以与输入或残差相同
+* @param size 元素个数
+* @param alpha kLeakyRelu的负半轴斜率, kClip的下界
+* @param beta kClip的上界
+*/
+void ResidualActivationForward(ActivationType type, const float* input, const float* residual,
+                               float* output, size_t size, float alpha = 0.01f, float beta = 0.f);
+
+/*
+* @brief 对张量逐元素计算激活函数
+* @param type 激活函数
+* @param input 输入张量
+* @param output 输出张量, 形状和布局与输入相同, 可以是输入本身
+* @param alpha kLeakyRelu的负半轴斜率, kClip的下界
+* @param beta kClip的上界
+*/
+void ActivationForward(ActivationType type, const std::shared_ptr<Tensor<float>>& input,
+                       const std::shared_ptr<Tensor<float>>& output, float alpha = 0.01f,
+                       float beta = 0.f);
+
+}  // namespace kuiper_infer
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kuiper_infer {
+
+/// Alignment of every tensor buffer handed out by the allocators
+constexpr size_t kTensorAlignment = 64;
+
+/*
+* @brief 分配器的统计信息
+*/
+struct TensorAllocatorStats {
+  /// Bytes handed out and not yet released
+  size_t bytes_in_use = 0;
+
+  /// Bytes kept by the allocator for reuse
+  size_t bytes_cached = 0;
+
+  /// Number of Allocate calls
+  uint64_t allocations = 0;
+
+  /// Number of Allocate calls served from cached blocks
+  uint64_t pool_hits = 0;
+
+  /*
+  * @brief 缓存命中率
+  * @return pool_hits / allocations, 没有分配时为0
+  */
+  double hit_rate() const;
+};
+
+/*
+* @brief 张量存储的分配器接口
+*/
+class TensorAllocator {
+ public:
+  virtual ~TensorAllocator() = default;
+
+  /*
+  * @brief 分配至少bytes字节, 按kTensorAlignment对齐的内存
+  * @param bytes 字节数
+  * @return 内存地址
+  */
+  virtual void* Allocate(size_t bytes) = 0;
+
+  /*
+  * @brief 归还由Allocate分配的内存
+  * @param ptr 内存地址
+  * @param bytes 分配时的字节数
+  */
+  virtual void Release(void* ptr, size_t bytes) = 0;
+
+  /*
+  * @brief 获取统计信息
+  */
+  virtual TensorAllocatorStats stats() const = 0;
+};
+
+/*
+* @brief 按大小分级的内存池
+*
+* 每个2的幂区间分为4级, 最小64字节, 超过kMaxPooledBytes的请求直接向系统申请.
+* 释放的内存先进入当前线程的缓存, 缓存满后归还到全局池, 线程退出时线程缓存也归还到全局池.
+* 线程缓存不持有内存池, 分配器被替换后随最后一个张量一起释放, 包括所有线程缓存中的内存.
+*/
+class PooledTensorAllocator : public TensorAllocator {
+ public:
+  /// Largest request served from the pool
+  static constexpr size_t kMaxPooledBytes = size_t(1) << 28;
+
+  /// Bytes each thread may cache over all size classes
+  static constexpr size_t kThreadCacheBytes = size_t(1) << 24;
+
+  PooledTensorAllocator();
+
+  void* Allocate(size_t bytes) override;
+
+  void Release(void* ptr, size_t bytes) override;
+
+  TensorAllocatorStats stats() const override;
+
+  /*
+  * @brief 释放全局池和所有线程缓存中的内存
+  */
+  void ReleaseCached();
+
+  /*
+  * @brief 计算请求所在的大小级别
+  * @param bytes 请求的字节数
+  * @param class_bytes 该级别实际分配的字节数
+  * @return 级别下标, 不在池中管理时返回-1
+  */
+  static int32_t SizeClass(size_t bytes, size_t* class_bytes);
+
+  struct PoolState;
+
+ private:
+  std::shared_ptr<PoolState> state_;
+};
+
+/*
+* @brief 获取张量存储当前使用的分配器, 默认为PooledTensorAllocator
+*/
+std::shared_ptr<TensorAllocator> GetTensorAllocator();
+
+/*
+* @brief 替换张量存储使用的分配器, 已分配的内存仍归还给原分配器
+* @param allocator 新的分配器, 为空时恢复默认分配器
+*/
+void SetTensorAllocator(std::shared_ptr<TensorAllocator> allocator);
+
+/*
+* @brief 从当前分配器申请size个元素的存储, 析构时自动归还
+* @param size 元素个数
+* @return 存储的共享指针
+*/
+template <typename T>
+std::shared_ptr<T> AllocateTensorStorage(size_t size) {
+  std::shared_ptr<TensorAllocator> allocator = GetTensorAllocator();
+  const size_t bytes = size * sizeof(T);
+  T* ptr = static_cast<T*>(allocator->Allocate(bytes));
+  return std::shared_ptr<T>(ptr, [allocator, bytes](T* p) { allocator->Release(p, bytes); });
+}
+
+}  // namespace kuiper_infer
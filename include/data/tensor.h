@@ -4,10 +4,44 @@
 #include <memory>
 #include <numeric>
 #include <vector>
+#include "data/allocator.h"
 
 using namespace std;
 
 namespace kuiper_infer {
+    /*
+    * @brief 张量的存储布局
+    *
+    * kColMajor: 每个通道按列存储, 与arma::Cube一致
+    * kRowMajor: 连续的行主序NCHW存储, 与PNNX权重和外部输入一致,
+    *            data_中每个通道以cols x rows的矩阵存放
+    * kNCHW8c/kNCHW16c: 通道分块存储, 每8或16个通道为一组, 组内按行主序逐像素
+    *            交错存放, 与AVX2/AVX-512的向量宽度一致. 通道数补齐到块大小的倍数,
+    *            data_中每组通道以(block * cols) x rows的矩阵存放
+    */
+    enum class TensorLayout {
+        kColMajor = 0,
+        kRowMajor = 1,
+        kNCHW8c = 2,
+        kNCHW16c = 3,
+    };
+
+    /*
+    * @brief 获取布局的通道块大小
+    * @param layout 存储布局
+    * @return 分块布局返回8或16, 其他布局返回1
+    */
+    inline uint32_t TensorLayoutBlockSize(TensorLayout layout) {
+        switch (layout) {
+            case TensorLayout::kNCHW8c:
+                return 8;
+            case TensorLayout::kNCHW16c:
+                return 16;
+            default:
+                return 1;
+        }
+    }
+
     template<typename T>
     class Tensor {
         public:
@@ -23,12 +57,37 @@ namespace kuiper_infer {
             explicit Tensor(uint32_t rows, uint32_t cols);
             explicit Tensor(const vector<uint32_t>& shapes);
 
+            /*
+            * @brief 创建指定存储布局的张量
+            * @param channels 通道数
+            * @param rows 行数
+            * @param cols 列数
+            * @param layout 存储布局
+            */
+            explicit Tensor(uint32_t channels, uint32_t rows, uint32_t cols, TensorLayout layout);
+
+            /*
+            * @brief 创建指向外部内存的指定布局的张量
+            * @param raw_ptr 外部内存
+            * @param shapes 形状, 依次为通道数, 行数和列数
+            * @param layout 外部内存的布局
+            */
+            explicit Tensor(T* raw_ptr, const vector<uint32_t>& shapes, TensorLayout layout);
+
+            Tensor(const Tensor& tensor);
+
+            Tensor(Tensor&& tensor) noexcept = default;
+
+            Tensor& operator=(const Tensor& tensor);
+
+            Tensor& operator=(Tensor&& tensor) noexcept = default;
+
 
             // ----- function -----
 
             /*
             * @brief 获取张量的大小
-            * @return 张量的大小
+            * @return 张量的大小, 分块布局下包含补齐的通道
             */
             uint32_t size() const;
 
@@ -47,7 +106,28 @@ namespace kuiper_infer {
             */
             uint32_t channels() const;
 
-            
+            /*
+            * @brief 获取张量的存储布局
+            */
+            TensorLayout layout() const;
+
+            /*
+            * @brief 转换张量的存储布局, 视图张量在原内存中转换
+            *
+            * 视图张量只能在存储大小相同的布局间转换
+            * @param layout 目标布局
+            */
+            void convert_layout(TensorLayout layout);
+
+            /*
+            * @brief 获取通道块大小, 非分块布局为1
+            */
+            uint32_t block_size() const;
+
+            /*
+            * @brief 设置张量的数据, data按张量当前布局的存储方向给出
+            * @param data 数据
+            */
             void set_data(const arma::Cube<T>& data);
 
 
@@ -80,6 +160,8 @@ namespace kuiper_infer {
 
             /*
             * @brief 获取张量的数据
+            *
+            * 行主序布局下每个通道的矩阵是cols x rows
             * @return 张量的数据
             */
             arma::Cube<T>& data();
@@ -125,7 +207,7 @@ namespace kuiper_infer {
            /*
             * @brief 填充张量
             * @param values 填充的值
-            * @param row_major 是否按行填充
+            * @param row_major 是否按行填充, 行主序布局下按行填充只需一次拷贝
             */
             void fill(const vector<T>& values, bool row_major = true);
 
@@ -158,7 +240,12 @@ namespace kuiper_infer {
             void randn(T mean = 0, T std = 1);
 
 
-            void transform(const function<T(const T&)> &op);
+           /*
+            * @brief 对每个元素应用op并写回, op在调用处内联, 可以被向量化
+            * @param op 一元函数, 参数和返回值为T
+            */
+            template<typename Op>
+            void transform(Op&& op);
 
             void review(const vector<uint32_t>& shapes);
            
@@ -168,11 +255,21 @@ namespace kuiper_infer {
             void show() const;
 
 
+           /*
+            * @brief 改变张量的形状
+            * @param shape 新的形状
+            * @param row_major 是否按行主序重排, 行主序布局下只修改形状不移动数据
+            */
             void reshape(const vector<uint32_t>& shape, bool row_major = false);
 
-
+           /*
+            * @brief 展平张量
+            * @param row_major 是否按行主序展平, 行主序布局下只修改形状不移动数据
+            */
             void flatten(bool row_major = false);
 
+            T* raw_ptr();
+
             const T* raw_ptr() const;
 
 
@@ -197,11 +294,33 @@ namespace kuiper_infer {
             const T* matrix_raw_ptr(uint32_t index) const;
 
         private:
+           /*
+            * @brief 从张量分配器申请存储, data_指向这块存储
+            * @param channels 通道数
+            * @param rows 行数
+            * @param cols 列数
+            */
+            void allocate(uint32_t channels, uint32_t rows, uint32_t cols);
+
+            shared_ptr<T> storage_;
+            TensorLayout layout_ = TensorLayout::kColMajor;
+            // 分块布局下补齐前的通道数
+            uint32_t blocked_channels_ = 0;
             arma::Cube<T> data_;
             vector<uint32_t> raw_shapes_;
     };
 
     
+    template<typename T>
+    template<typename Op>
+    void Tensor<T>::transform(Op&& op) {
+        T* data = this->data_.memptr();
+        const size_t size = this->data_.size();
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = op(data[i]);
+        }
+    }
+
     using sftensor = std::shared_ptr<Tensor<float>>;
     using ftensor = Tensor<float>;
 };
\ No newline at end of file
@@ -0,0 +1,254 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include "data/tensor.h"
+#include "data/tensor_util.h"
+
+namespace kuiper_infer {
+
+/*
+* 惰性的逐元素张量表达式
+*
+* TensorExpr(a) * TensorExpr(b) + TensorExpr(c)只构建表达式树, 不分配内存也不计算,
+* TensorAssign把整个表达式在一次遍历中写入预先分配的输出张量, 输出可以是表达式中的
+* 某个输入(原地计算). 输入按numpy规则广播, 被广播的维度步长为0.
+*/
+namespace expr {
+
+/*
+* @brief 表达式的基类, E为具体的表达式类型
+*/
+template <typename E>
+struct Expression {
+  const E& self() const { return static_cast<const E&>(*this); }
+};
+
+/*
+* @brief 张量叶子节点
+*/
+template <typename T>
+class TensorLeaf : public Expression<TensorLeaf<T>> {
+ public:
+  using value_type = T;
+
+  explicit TensorLeaf(const Tensor<T>& tensor) : tensor_(&tensor), data_(tensor.raw_ptr()) {}
+
+  std::vector<uint32_t> shapes() const { return tensor_->shapes(); }
+
+  /*
+  * @brief 与输出形状和布局相同时可以按存储下标直接计算
+  */
+  bool IsDense(const Tensor<T>& output) const {
+    return tensor_->shapes() == output.shapes() && tensor_->layout() == output.layout();
+  }
+
+  /*
+  * @brief 计算广播到输出时的步长
+  * @param shapes 输出的形状
+  * @param row_major 输出是否为行主序, 决定哪一维是最内层
+  */
+  void Prepare(const std::vector<uint32_t>& shapes, bool row_major) {
+    const BroadcastStrides strides = TensorBroadcastStrides(*tensor_, shapes);
+    channel_stride_ = strides[1];
+    outer_stride_ = row_major ? strides[2] : strides[3];
+    inner_stride_ = row_major ? strides[3] : strides[2];
+  }
+
+  T Eval(size_t index) const { return data_[index]; }
+
+  T Eval(size_t channel, size_t outer, size_t inner) const {
+    return data_[channel * channel_stride_ + outer * outer_stride_ + inner * inner_stride_];
+  }
+
+ private:
+  const Tensor<T>* tensor_ = nullptr;
+  const T* data_ = nullptr;
+  size_t channel_stride_ = 0;
+  size_t outer_stride_ = 0;
+  size_t inner_stride_ = 0;
+};
+
+/*
+* @brief 标量节点, 广播到任意形状
+*/
+template <typename T>
+class ScalarLeaf : public Expression<ScalarLeaf<T>> {
+ public:
+  using value_type = T;
+
+  explicit ScalarLeaf(T value) : value_(value) {}
+
+  std::vector<uint32_t> shapes() const { return {}; }
+
+  bool IsDense(const Tensor<T>& output) const { return true; }
+
+  void Prepare(const std::vector<uint32_t>& shapes, bool row_major) {}
+
+  T Eval(size_t index) const { return value_; }
+
+  T Eval(size_t channel, size_t outer, size_t inner) const { return value_; }
+
+ private:
+  T value_;
+};
+
+/*
+* @brief 一元运算节点
+*/
+template <typename E, typename Op>
+class UnaryExpression : public Expression<UnaryExpression<E, Op>> {
+ public:
+  using value_type = typename E::value_type;
+
+  UnaryExpression(const E& operand, Op op) : operand_(operand), op_(op) {}
+
+  std::vector<uint32_t> shapes() const { return operand_.shapes(); }
+
+  bool IsDense(const Tensor<value_type>& output) const { return operand_.IsDense(output); }
+
+  void Prepare(const std::vector<uint32_t>& shapes, bool row_major) {
+    operand_.Prepare(shapes, row_major);
+  }
+
+  value_type Eval(size_t index) const { return op_(operand_.Eval(index)); }
+
+  value_type Eval(size_t channel, size_t outer, size_t inner) const {
+    return op_(operand_.Eval(channel, outer, inner));
+  }
+
+ private:
+  E operand_;
+  Op op_;
+};
+
+/*
+* @brief 二元运算节点
+*/
+template <typename L, typename R, typename Op>
+class BinaryExpression : public Expression<BinaryExpression<L, R, Op>> {
+ public:
+  using value_type = typename L::value_type;
+
+  BinaryExpression(const L& lhs, const R& rhs, Op op) : lhs_(lhs), rhs_(rhs), op_(op) {}
+
+  std::vector<uint32_t> shapes() const {
+    return TensorBroadcastShapes(lhs_.shapes(), rhs_.shapes());
+  }
+
+  bool IsDense(const Tensor<value_type>& output) const {
+    return lhs_.IsDense(output) && rhs_.IsDense(output);
+  }
+
+  void Prepare(const std::vector<uint32_t>& shapes, bool row_major) {
+    lhs_.Prepare(shapes, row_major);
+    rhs_.Prepare(shapes, row_major);
+  }
+
+  value_type Eval(size_t index) const { return op_(lhs_.Eval(index), rhs_.Eval(index)); }
+
+  value_type Eval(size_t channel, size_t outer, size_t inner) const {
+    return op_(lhs_.Eval(channel, outer, inner), rhs_.Eval(channel, outer, inner));
+  }
+
+ private:
+  L lhs_;
+  R rhs_;
+  Op op_;
+};
+
+/*
+* @brief 对表达式逐元素应用函数
+* @param expression 表达式
+* @param op 一元函数
+*/
+template <typename E, typename Op>
+UnaryExpression<E, Op> Map(const Expression<E>& expression, Op op) {
+  return UnaryExpression<E, Op>(expression.self(), op);
+}
+
+#define KUIPER_EXPR_BINARY_OPERATOR(symbol, functor)                                        \
+  template <typename L, typename R>                                                        \
+  BinaryExpression<L, R, functor> operator symbol(const Expression<L>& lhs,               \
+                                                  const Expression<R>& rhs) {              \
+    return BinaryExpression<L, R, functor>(lhs.self(), rhs.self(), functor());            \
+  }                                                                                        \
+  template <typename L>                                                                    \
+  BinaryExpression<L, ScalarLeaf<typename L::value_type>, functor> operator symbol(       \
+      const Expression<L>& lhs, typename L::value_type rhs) {                              \
+    return BinaryExpression<L, ScalarLeaf<typename L::value_type>, functor>(              \
+        lhs.self(), ScalarLeaf<typename L::value_type>(rhs), functor());                   \
+  }                                                                                        \
+  template <typename R>                                                                    \
+  BinaryExpression<ScalarLeaf<typename R::value_type>, R, functor> operator symbol(       \
+      typename R::value_type lhs, const Expression<R>& rhs) {                              \
+    return BinaryExpression<ScalarLeaf<typename R::value_type>, R, functor>(              \
+        ScalarLeaf<typename R::value_type>(lhs), rhs.self(), functor());                   \
+  }
+
+KUIPER_EXPR_BINARY_OPERATOR(+, std::plus<>)
+KUIPER_EXPR_BINARY_OPERATOR(-, std::minus<>)
+KUIPER_EXPR_BINARY_OPERATOR(*, std::multiplies<>)
+KUIPER_EXPR_BINARY_OPERATOR(/, std::divides<>)
+
+#undef KUIPER_EXPR_BINARY_OPERATOR
+
+}  // namespace expr
+
+/*
+* @brief 把张量包装为表达式的叶子节点, 张量在表达式求值前必须保持存活
+* @param tensor 张量
+* @return 叶子节点
+*/
+template <typename T>
+expr::TensorLeaf<T> TensorExpr(const std::shared_ptr<Tensor<T>>& tensor) {
+  CHECK(tensor != nullptr && !tensor->empty());
+  return expr::TensorLeaf<T>(*tensor);
+}
+
+/*
+* @brief 在一次遍历中计算表达式并写入输出张量
+*
+* 所有输入与输出形状和布局相同时按存储下标计算, 否则按广播步长计算,
+* 最内层循环沿输出的连续维度
+* @param output_tensor 输出张量, 形状为表达式广播后的形状, 可以是表达式的输入
+* @param expression 表达式
+*/
+template <typename T, typename E>
+void TensorAssign(const std::shared_ptr<Tensor<T>>& output_tensor,
+                  const expr::Expression<E>& expression) {
+  CHECK(output_tensor != nullptr && !output_tensor->empty());
+  E evaluator = expression.self();
+  const std::vector<uint32_t> shapes = output_tensor->shapes();
+  CHECK(TensorBroadcastShapes(shapes, evaluator.shapes()) == shapes)
+      << "Output shape is not the broadcast shape of the expression";
+
+  T* output = output_tensor->raw_ptr();
+  if (evaluator.IsDense(*output_tensor)) {
+    const size_t size = output_tensor->size();
+#pragma omp parallel for if (size >= 4096)
+    for (size_t i = 0; i < size; ++i) {
+      output[i] = evaluator.Eval(i);
+    }
+    return;
+  }
+
+  CHECK_EQ(output_tensor->block_size(), 1)
+      << "Broadcast expressions do not support channel-blocked outputs";
+  const bool row_major = output_tensor->layout() == TensorLayout::kRowMajor;
+  evaluator.Prepare(shapes, row_major);
+  const size_t channels = output_tensor->channels();
+  const size_t outer = row_major ? output_tensor->rows() : output_tensor->cols();
+  const size_t inner = row_major ? output_tensor->cols() : output_tensor->rows();
+#pragma omp parallel for if (channels * outer * inner >= 4096)
+  for (size_t index = 0; index < channels * outer; ++index) {
+    const size_t channel = index / outer;
+    const size_t o = index % outer;
+    T* output_row = output + index * inner;
+    for (size_t i = 0; i < inner; ++i) {
+      output_row[i] = evaluator.Eval(channel, o, i);
+    }
+  }
+}
+
+}  // namespace kuiper_infer
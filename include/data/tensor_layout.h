@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include "data/tensor.h"
+
+namespace kuiper_infer {
+
+/*
+* @brief 当前CPU上分块布局的默认块大小
+* @return 支持AVX-512时为kNCHW16c, 否则为kNCHW8c
+*/
+TensorLayout DefaultBlockedLayout();
+
+/*
+* @brief 将列主序或行主序的数据重排为通道分块布局
+*
+* 补齐的通道置零
+* @param src 源数据
+* @param src_layout 源数据布局, kColMajor或kRowMajor
+* @param channels 通道数
+* @param rows 行数
+* @param cols 列数
+* @param dst 目标内存, 大小为补齐后的通道数 * rows * cols
+* @param block_size 通道块大小, 8或16
+*/
+void ReorderToBlocked(const float* src, TensorLayout src_layout, uint32_t channels, uint32_t rows,
+                      uint32_t cols, float* dst, uint32_t block_size);
+
+/*
+* @brief 将通道分块布局的数据重排为列主序或行主序
+* @param src 源数据
+* @param block_size 通道块大小, 8或16
+* @param channels 通道数
+* @param rows 行数
+* @param cols 列数
+* @param dst 目标内存, 大小为channels * rows * cols
+* @param dst_layout 目标布局, kColMajor或kRowMajor
+*/
+void ReorderFromBlocked(const float* src, uint32_t block_size, uint32_t channels, uint32_t rows,
+                        uint32_t cols, float* dst, TensorLayout dst_layout);
+
+/*
+* @brief 按目标张量的布局拷贝源张量的数据
+* @param src 源张量
+* @param dst 目标张量, 形状与源张量相同
+*/
+void TensorReorder(const Tensor<float>& src, Tensor<float>& dst);
+
+}  // namespace kuiper_infer
@@ -1,13 +1,79 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <functional>
 #include "data/tensor.h"
 
 using namespace std;
 
 namespace kuiper_infer {
 
+/// 广播迭代支持的最大维数
+constexpr uint32_t kMaxBroadcastDims = 4;
+
+/// 每一维的元素步长, 被广播的维度步长为0
+using BroadcastStrides = std::array<size_t, kMaxBroadcastDims>;
+
+/*
+* @brief 按numpy规则计算两个形状广播后的形状
+*
+* 形状从右对齐, 对应的维度相等或其中之一为1
+* @param shapes1 形状1
+* @param shapes2 形状2
+* @return 广播后的形状, 维数为两者中较大的
+*/
+inline std::vector<uint32_t> TensorBroadcastShapes(const std::vector<uint32_t>& shapes1,
+                                                   const std::vector<uint32_t>& shapes2);
+
+/*
+* @brief 计算张量广播到目标形状时的步长
+*
+* 返回(批次, 通道, 行, 列)四维的步长, 批次和被广播的维度步长为0, 不支持通道分块布局
+* @param tensor 张量
+* @param shapes 目标形状, 依次为通道数, 行数和列数
+* @return 步长
+*/
+template <typename T>
+BroadcastStrides TensorBroadcastStrides(const Tensor<T>& tensor, const std::vector<uint32_t>& shapes);
+
+/*
+* @brief 广播地逐元素计算output = op(input1, input2)
+*
+* 按步长直接读取输入, 步长为0的维度重复读取同一元素, 不展开被广播的输入.
+* 各维按输出步长从大到小遍历, 最内层循环沿输出的连续维度
+* @param input1 输入1
+* @param strides1 输入1的步长
+* @param input2 输入2
+* @param strides2 输入2的步长
+* @param output 输出
+* @param output_strides 输出的步长
+* @param shapes 输出的形状, 不足四维时前面补1
+* @param op 二元运算
+*/
+template <typename T, typename BinaryOp>
+void BroadcastBinary(const T* input1, const BroadcastStrides& strides1, const T* input2,
+                     const BroadcastStrides& strides2, T* output,
+                     const BroadcastStrides& output_strides,
+                     const std::array<uint32_t, kMaxBroadcastDims>& shapes, BinaryOp op);
+
+/*
+* @brief 广播地逐元素计算两个张量, 结果写入输出张量
+*
+* 形状相同且布局一致时直接按存储顺序计算, 否则按步长广播, 输出可以是输入之一
+* @param tensor1 张量1
+* @param tensor2 张量2
+* @param output_tensor 输出张量, 形状为广播后的形状
+* @param op 二元运算
+*/
+template <typename T, typename BinaryOp>
+void TensorBroadcastBinary(const Tensor<T>& tensor1, const Tensor<T>& tensor2,
+                           Tensor<T>& output_tensor, BinaryOp op);
+
 /*
 * @brief 广播两个张量
+*
+* 会展开被广播的张量, 逐元素运算不再使用它, 见TensorBroadcastBinary
 * @param tensor1 张量1
 * @param tensor2 张量2
 * @return 广播后的张量
@@ -75,6 +141,15 @@ std::shared_ptr<Tensor<T>> TensorElementMultiply(const std::shared_ptr<Tensor<T>
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorCreate(uint32_t channels, uint32_t rows, uint32_t cols);    
 
+/*
+* @brief 创建一个指定存储布局的张量
+* @param shapes 形状, 依次为通道数, 行数和列数
+* @param layout 存储布局
+* @return 创建的张量
+*/
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorCreate(const std::vector<uint32_t>& shapes, TensorLayout layout);
+
 
 /*
 * @brief 创建一个张量
@@ -101,6 +176,19 @@ std::shared_ptr<Tensor<T>> TensorCreate(uint32_t size);
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorCreate(const std::vector<uint32_t>& shapes);
 
+/*
+* @brief 获取一组样本张量所在的连续批次内存
+*
+* 运行时图中同一个操作数的各个样本是一块连续内存中的视图, 层可以据此一次处理整个批次
+* @param tensors 样本张量
+* @param begin 第一个样本的下标
+* @param count 样本个数
+* @return 样本在内存中首尾相接时返回第一个样本的数据地址, 否则返回nullptr
+*/
+template <typename T>
+T* TensorBatchPtr(const std::vector<std::shared_ptr<Tensor<T>>>& tensors, size_t begin,
+                  size_t count);
+
 /*
 * @brief 克隆一个张量
 * @param tensor 张量
@@ -120,7 +208,8 @@ tuple<shared_ptr<Tensor<T>>, shared_ptr<Tensor<T>>> TensorBroadcast(
         CHECK(tensor1->channels() == tensor2->channels());
         if (tensor2->rows() == 1 && tensor2->cols() == 1) {
         std::shared_ptr<Tensor<T>> new_tensor =
-            TensorCreate<T>(tensor2->channels(), tensor1->rows(), tensor1->cols());
+            TensorCreate<T>({tensor2->channels(), tensor1->rows(), tensor1->cols()},
+                            tensor1->layout());
         CHECK(tensor2->size() == tensor2->channels());
         for (uint32_t c = 0; c < tensor2->channels(); ++c) {
             T* new_tensor_ptr = new_tensor->matrix_raw_ptr(c);
@@ -129,7 +218,8 @@ tuple<shared_ptr<Tensor<T>>, shared_ptr<Tensor<T>>> TensorBroadcast(
         return {tensor1, new_tensor};
         } else if (tensor1->rows() == 1 && tensor1->cols() == 1) {
         std::shared_ptr<Tensor<T>> new_tensor =
-            TensorCreate<T>(tensor1->channels(), tensor2->rows(), tensor2->cols());
+            TensorCreate<T>({tensor1->channels(), tensor2->rows(), tensor2->cols()},
+                            tensor2->layout());
         CHECK(tensor1->size() == tensor1->channels());
             for (uint32_t c = 0; c < tensor1->channels(); ++c) {
             T* new_tensor_ptr = new_tensor->matrix_raw_ptr(c);
@@ -147,30 +237,148 @@ template <typename T>
 bool TensorIsSame(const std::shared_ptr<Tensor<T>>& a, const std::shared_ptr<Tensor<T>>& b,
                     T threshold) {
     CHECK(a != nullptr && b != nullptr);
-    if (a->shape() != b->shape()) {
+    if (a->shapes() != b->shapes()) {
         return false;
     }
-    bool is_same = arma::approx_equal(a->data(), b->data(), "absdiff", threshold);
-    return is_same;
+    if (a->layout() == b->layout()) {
+        return arma::approx_equal(a->data(), b->data(), "absdiff", threshold);
+    }
+    for (uint32_t c = 0; c < a->channels(); ++c) {
+        for (uint32_t r = 0; r < a->rows(); ++r) {
+            for (uint32_t col = 0; col < a->cols(); ++col) {
+                if (std::abs(a->at(c, r, col) - b->at(c, r, col)) > threshold) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+inline std::vector<uint32_t> TensorBroadcastShapes(const std::vector<uint32_t>& shapes1,
+                                                   const std::vector<uint32_t>& shapes2) {
+    const size_t dims = std::max(shapes1.size(), shapes2.size());
+    CHECK_LE(dims, kMaxBroadcastDims) << "Broadcast supports at most 4 dimensions";
+    std::vector<uint32_t> shapes(dims, 1);
+    for (size_t i = 0; i < dims; ++i) {
+        const uint32_t dim1 = i < shapes1.size() ? shapes1.at(shapes1.size() - 1 - i) : 1;
+        const uint32_t dim2 = i < shapes2.size() ? shapes2.at(shapes2.size() - 1 - i) : 1;
+        CHECK(dim1 == dim2 || dim1 == 1 || dim2 == 1) << "Broadcast shape is not adapting!";
+        shapes.at(dims - 1 - i) = dim1 == 1 ? dim2 : dim1;
+    }
+    return shapes;
+}
+
+template <typename T>
+BroadcastStrides TensorBroadcastStrides(const Tensor<T>& tensor,
+                                        const std::vector<uint32_t>& shapes) {
+    CHECK_EQ(shapes.size(), 3);
+    CHECK_EQ(tensor.block_size(), 1) << "Broadcast does not support channel-blocked tensors";
+    const std::vector<uint32_t> tensor_shapes = tensor.shapes();
+    const size_t rows = tensor.rows();
+    const size_t cols = tensor.cols();
+
+    BroadcastStrides strides{0, rows * cols, 1, 1};
+    if (tensor.layout() == TensorLayout::kRowMajor) {
+        strides.at(2) = cols;
+    } else {
+        strides.at(3) = rows;
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        CHECK(tensor_shapes.at(i) == shapes.at(i) || tensor_shapes.at(i) == 1)
+            << "Broadcast shape is not adapting!";
+        if (tensor_shapes.at(i) != shapes.at(i)) {
+            strides.at(i + 1) = 0;
+        }
+    }
+    return strides;
+}
+
+template <typename T, typename BinaryOp>
+void BroadcastBinary(const T* input1, const BroadcastStrides& strides1, const T* input2,
+                     const BroadcastStrides& strides2, T* output,
+                     const BroadcastStrides& output_strides,
+                     const std::array<uint32_t, kMaxBroadcastDims>& shapes, BinaryOp op) {
+    CHECK(input1 != nullptr && input2 != nullptr && output != nullptr);
+    // 长度为1的维度放在最外层, 其余按输出步长从大到小排列
+    std::array<uint32_t, kMaxBroadcastDims> order{0, 1, 2, 3};
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t i, uint32_t j) {
+        if ((shapes[i] == 1) != (shapes[j] == 1)) {
+            return shapes[i] == 1;
+        }
+        return output_strides[i] > output_strides[j];
+    });
+    const uint32_t d0 = order[0], d1 = order[1], d2 = order[2], d3 = order[3];
+    const size_t outer = size_t(shapes[d0]) * shapes[d1] * shapes[d2];
+    const uint32_t inner = shapes[d3];
+    const size_t inner_stride1 = strides1[d3];
+    const size_t inner_stride2 = strides2[d3];
+    const size_t inner_output_stride = output_strides[d3];
+
+    #pragma omp parallel for if (outer * inner >= 4096)
+    for (size_t index = 0; index < outer; ++index) {
+        const size_t i2 = index % shapes[d2];
+        const size_t i1 = index / shapes[d2] % shapes[d1];
+        const size_t i0 = index / shapes[d2] / shapes[d1];
+        const T* in1 = input1 + i0 * strides1[d0] + i1 * strides1[d1] + i2 * strides1[d2];
+        const T* in2 = input2 + i0 * strides2[d0] + i1 * strides2[d1] + i2 * strides2[d2];
+        T* out = output + i0 * output_strides[d0] + i1 * output_strides[d1] +
+                 i2 * output_strides[d2];
+        if (inner_output_stride == 1 && inner_stride1 == 1 && inner_stride2 == 1) {
+            for (uint32_t j = 0; j < inner; ++j) {
+                out[j] = op(in1[j], in2[j]);
+            }
+        } else if (inner_output_stride == 1 && inner_stride1 == 1 && inner_stride2 == 0) {
+            const T value2 = *in2;
+            for (uint32_t j = 0; j < inner; ++j) {
+                out[j] = op(in1[j], value2);
+            }
+        } else if (inner_output_stride == 1 && inner_stride1 == 0 && inner_stride2 == 1) {
+            const T value1 = *in1;
+            for (uint32_t j = 0; j < inner; ++j) {
+                out[j] = op(value1, in2[j]);
+            }
+        } else {
+            for (uint32_t j = 0; j < inner; ++j) {
+                out[j * inner_output_stride] = op(in1[j * inner_stride1], in2[j * inner_stride2]);
+            }
+        }
+    }
+}
+
+template <typename T, typename BinaryOp>
+void TensorBroadcastBinary(const Tensor<T>& tensor1, const Tensor<T>& tensor2,
+                           Tensor<T>& output_tensor, BinaryOp op) {
+    CHECK(!tensor1.empty() && !tensor2.empty() && !output_tensor.empty());
+    const std::vector<uint32_t> shapes = TensorBroadcastShapes(tensor1.shapes(), tensor2.shapes());
+    CHECK(output_tensor.shapes() == shapes) << "Output shape is not the broadcast shape";
+    if (tensor1.shapes() == tensor2.shapes() && tensor1.layout() == tensor2.layout() &&
+        tensor1.layout() == output_tensor.layout()) {
+        // 存储顺序一致, 分块布局补齐的通道也一并计算
+        const T* in1 = tensor1.raw_ptr();
+        const T* in2 = tensor2.raw_ptr();
+        T* out = output_tensor.raw_ptr();
+        const size_t size = output_tensor.size();
+        #pragma omp parallel for if (size >= 4096)
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = op(in1[i], in2[i]);
+        }
+        return;
+    }
+    BroadcastBinary(tensor1.raw_ptr(), TensorBroadcastStrides(tensor1, shapes), tensor2.raw_ptr(),
+                    TensorBroadcastStrides(tensor2, shapes), output_tensor.raw_ptr(),
+                    TensorBroadcastStrides(output_tensor, shapes), {1, shapes[0], shapes[1], shapes[2]},
+                    op);
 }
 
 template <typename T>
 shared_ptr<Tensor<T>> TensorElementAdd(const shared_ptr<Tensor<T>>& tensor1,
                                         const shared_ptr<Tensor<T>>& tensor2) {
     CHECK(tensor1 != nullptr && tensor2 != nullptr);
-    if (tensor1->shapes() == tensor2->shapes()) {
-        std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(tensor1->shapes());
-        output_tensor->set_data(tensor1->data() + tensor2->data());
-        return output_tensor;
-    } else {
-        // broadcast
-        CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-        const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-        CHECK(input_tensor1->shapes() == input_tensor2->shapes());
-        std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(input_tensor1->shapes());
-        output_tensor->set_data(input_tensor1->data() + input_tensor2->data());
-        return output_tensor;
-    }
+    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(
+        TensorBroadcastShapes(tensor1->shapes(), tensor2->shapes()), tensor1->layout());
+    TensorBroadcastBinary(*tensor1, *tensor2, *output_tensor, std::plus<T>());
+    return output_tensor;
 }
 
 
@@ -178,36 +386,18 @@ template <typename T>
 void TensorElementAdd(const shared_ptr<Tensor<T>>& tensor1,
                         const shared_ptr<Tensor<T>>& tensor2,
                         const shared_ptr<Tensor<T>>& output_tensor) {
-        CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
-    if (tensor1->shapes() == tensor2->shapes()) {
-        CHECK(tensor1->shapes() == output_tensor->shapes());
-        output_tensor->set_data(tensor1->data() + tensor2->data());
-    } else {
-        CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-        const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-        CHECK(output_tensor->shapes() == input_tensor1->shapes() &&
-            output_tensor->shapes() == input_tensor2->shapes());
-        output_tensor->set_data(input_tensor1->data() + input_tensor2->data());
-    }
+    CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
+    TensorBroadcastBinary(*tensor1, *tensor2, *output_tensor, std::plus<T>());
 }
 
 template <typename T>
 shared_ptr<Tensor<T>> TensorElementMultiply(const shared_ptr<Tensor<T>>& tensor1,
                                             const shared_ptr<Tensor<T>>& tensor2) {
     CHECK(tensor1 != nullptr && tensor2 != nullptr);
-    if (tensor1->shapes() == tensor2->shapes()) {
-        std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(tensor1->shapes());
-        output_tensor->set_data(tensor1->data() % tensor2->data());
-        return output_tensor;
-    } else {
-        // broadcast
-        CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-        const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-        CHECK(input_tensor1->shapes() == input_tensor2->shapes());
-        std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(input_tensor1->shapes());
-        output_tensor->set_data(input_tensor1->data() % input_tensor2->data());
-        return output_tensor;
-    }
+    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(
+        TensorBroadcastShapes(tensor1->shapes(), tensor2->shapes()), tensor1->layout());
+    TensorBroadcastBinary(*tensor1, *tensor2, *output_tensor, std::multiplies<T>());
+    return output_tensor;
 }
 
 template <typename T>
@@ -215,17 +405,7 @@ void TensorElementMultiply(const shared_ptr<Tensor<T>>& tensor1,
                             const shared_ptr<Tensor<T>>& tensor2,
                             const shared_ptr<Tensor<T>>& output_tensor) {
     CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
-    if (tensor1->shapes() == tensor2->shapes()) {
-        CHECK(tensor1->shapes() == output_tensor->shapes());
-        output_tensor->set_data(tensor1->data() % tensor2->data());
-    } else {
-        CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-        const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-        CHECK(output_tensor->shapes() == input_tensor1->shapes() &&
-            output_tensor->shapes() == input_tensor2->shapes());
-        output_tensor->set_data(input_tensor1->data() % input_tensor2->data());
-    }
-    
+    TensorBroadcastBinary(*tensor1, *tensor2, *output_tensor, std::multiplies<T>());
 }
 
 template <typename T>
@@ -233,6 +413,12 @@ shared_ptr<Tensor<T>> TensorCreate(uint32_t channels, uint32_t rows, uint32_t co
     return make_shared<Tensor<T>>(channels, rows, cols);
 }
 
+template <typename T>
+shared_ptr<Tensor<T>> TensorCreate(const vector<uint32_t>& shapes, TensorLayout layout) {
+    CHECK_EQ(shapes.size(), 3);
+    return make_shared<Tensor<T>>(shapes.at(0), shapes.at(1), shapes.at(2), layout);
+}
+
 template <typename T>
 shared_ptr<Tensor<T>> TensorCreate(uint32_t rows, uint32_t cols) {
     return make_shared<Tensor<T>>(1, rows, cols);
@@ -255,6 +441,25 @@ shared_ptr<Tensor<T>> TensorCreate(const vector<uint32_t>& shapes) {
     }
 }
 
+template <typename T>
+T* TensorBatchPtr(const std::vector<std::shared_ptr<Tensor<T>>>& tensors, size_t begin,
+                  size_t count) {
+    CHECK_LE(begin + count, tensors.size());
+    if (count == 0 || tensors.at(begin) == nullptr || tensors.at(begin)->empty()) {
+        return nullptr;
+    }
+    T* batch_ptr = tensors.at(begin)->raw_ptr();
+    const size_t sample_size = tensors.at(begin)->size();
+    for (size_t b = 1; b < count; ++b) {
+        const std::shared_ptr<Tensor<T>>& tensor = tensors.at(begin + b);
+        if (tensor == nullptr || tensor->empty() || tensor->size() != sample_size ||
+            tensor->raw_ptr() != batch_ptr + b * sample_size) {
+            return nullptr;
+        }
+    }
+    return batch_ptr;
+}
+
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorClone(std::shared_ptr<Tensor<T>> tensor) {
     CHECK(tensor != nullptr);
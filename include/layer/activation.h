@@ -0,0 +1,113 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data/activation.h"
+#include "layer/layer.h"
+#include "runtime/op.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Output epilogue fused into a GEMM-based layer
+ *
+ * Applied to the layer output right after the matrix product, while it
+ * is still in cache: output = act(output + residual). The bias is not
+ * part of it, GEMM layers already accumulate on top of a broadcast bias.
+ *
+ * FuseGemmEpilogue records a fused epilogue on nn.Conv2d and nn.Linear
+ * operators as the parameters fused_activation (the type of the removed
+ * activation operator), fused_activation.<name> (its parameters) and
+ * fused_residual (the residual is the second input operand).
+ */
+struct FusedEpilogue {
+  ActivationType activation = ActivationType::kNone;
+
+  /// Negative slope of kLeakyRelu, lower bound of kClip
+  float alpha = 0.01f;
+
+  /// Upper bound of kClip
+  float beta = 0.f;
+
+  /// Whether the layer takes a residual input operand added to its output
+  bool residual = false;
+
+  /**
+   * @brief Checks whether the epilogue does anything
+   */
+  bool empty() const { return activation == ActivationType::kNone && !residual; }
+
+  /**
+   * @brief Applies the epilogue in place
+   *
+   * @param output Layer output of size elements
+   * @param residual Residual of the same size, null if the epilogue has none
+   * @param size Number of elements
+   */
+  void Apply(float* output, const float* residual, size_t size) const;
+
+  /**
+   * @brief Reads the fused epilogue parameters of an operator
+   *
+   * @param op The runtime operator
+   * @param epilogue Receives the epilogue, empty if nothing was fused
+   * @return kSuccess, or kParseParameterError on an unsupported activation
+   */
+  static StatusCode Parse(const std::shared_ptr<RuntimeOperator>& op, FusedEpilogue& epilogue);
+};
+
+/**
+ * @brief Elementwise activation layer
+ *
+ * Runs the activation operators PNNX exports, both the functional and the
+ * module form: relu, relu6, leaky_relu, sigmoid, tanh, silu, gelu,
+ * hardswish, hardtanh and torch.clamp. Elementwise, so it accepts every
+ * layout and may run in place.
+ */
+class ActivationLayer : public Layer<float> {
+ public:
+  explicit ActivationLayer(ActivationType type, float alpha = 0.01f, float beta = 0.f);
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool IsLayoutSupported(TensorLayout layout) const override { return true; }
+
+  /**
+   * @brief Checks whether an operator type is an activation this layer runs
+   *
+   * @param type PNNX operator type, e.g. F.relu or nn.SiLU
+   */
+  static bool IsActivationOperator(const std::string& type);
+
+  /**
+   * @brief Maps an activation operator to an activation function
+   *
+   * @param type PNNX operator type
+   * @param params Parameters of the operator
+   * @param activation Receives the activation function
+   * @param alpha Receives the negative slope or the lower bound
+   * @param beta Receives the upper bound
+   * @return kSuccess, or kParseParameterError on an unsupported operator
+   */
+  static StatusCode ParseActivation(
+      const std::string& type, const std::map<std::string, std::shared_ptr<RuntimeParameter>>& params,
+      ActivationType& activation, float& alpha, float& beta);
+
+  /**
+   * @brief Creates an activation layer from an activation operator
+   *
+   * @param op The runtime operator
+   * @param activation_layer Receives the created layer
+   * @return Status code of the creation
+   */
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& activation_layer);
+
+ private:
+  ActivationType type_ = ActivationType::kNone;
+  float alpha_ = 0.01f;
+  float beta_ = 0.f;
+};
+
+}  // namespace kuiper_infer
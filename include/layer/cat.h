@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "layer/layer.h"
+#include "runtime/op.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Concatenation layer, torch.cat
+ *
+ * Concatenates the input operands along the channel, row or column axis
+ * of the per-sample tensors. For a concatenation along channels the
+ * memory planner lets producers write straight into their slice of the
+ * output; an input that already lives in its slice is skipped, so a
+ * fully planned concatenation copies nothing.
+ *
+ * The inputs hold the batch of every input operand one after another.
+ */
+class CatLayer : public Layer<float> {
+ public:
+  /// Tensor axis the operands are concatenated along
+  enum class Axis : uint8_t {
+    kChannel = 0,
+    kRow = 1,
+    kCol = 2,
+  };
+
+  explicit CatLayer(Axis axis);
+
+  StatusCode Build(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool IsLayoutSupported(TensorLayout layout) const override;
+
+  Axis axis() const { return axis_; }
+
+  /**
+   * @brief Maps the dim parameter of torch.cat to a tensor axis
+   *
+   * @param dim Concatenation dim of the operand, negative counts from the end
+   * @param rank Number of dims of the operand, batch included
+   * @param axis Receives the tensor axis
+   * @return kSuccess, or kParseParameterError for the batch dim or a dim
+   * out of range
+   */
+  static StatusCode OperandDimToAxis(int32_t dim, uint32_t rank, Axis& axis);
+
+  /**
+   * @brief Creates a concatenation layer from a torch.cat operator
+   *
+   * @param op The runtime operator
+   * @param cat_layer Receives the created layer
+   * @return Status code of the creation
+   */
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& cat_layer);
+
+ private:
+  /**
+   * @brief Checks that the inputs concatenate to the shape of the outputs
+   */
+  StatusCode CheckTensors(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                          const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const;
+
+  Axis axis_ = Axis::kChannel;
+};
+
+}  // namespace kuiper_infer
@@ -0,0 +1,228 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "layer/activation.h"
+#include "layer/layer.h"
+#include "runtime/op.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Kernel used by a convolution layer, chosen at Build
+ */
+enum class ConvolutionAlgorithm {
+  kIm2colGemm = 0,
+  kWinograd = 1,
+  kDepthwise = 2,
+  kPointwise = 3,
+};
+
+/**
+ * @brief 2-D convolution layer, nn.Conv2d
+ *
+ * Runs on column-major tensors. Every input plane is gathered into an
+ * im2col matrix whose columns follow the storage order of the output
+ * plane, so one sgemm per group writes the output channels in place.
+ * Zero padding is applied inside the gather, the input is never padded
+ * or copied. The im2col matrix lives in the workspace handed out by the
+ * runtime graph.
+ *
+ * 3x3 stride-1 convolutions with enough channels and output tiles run
+ * Winograd F(4x4, 3x3) instead, which needs 36 instead of 144
+ * multiplications per 4x4 output tile and input channel. Depthwise
+ * convolutions (groups == in_channels) run a direct kernel that needs
+ * no workspace. With one filter per channel they also run on the
+ * channel-blocked layouts and prefer DefaultBlockedLayout(), so the
+ * runtime graph keeps activations blocked around them. Pointwise convolutions (1x1, stride 1, no padding) read
+ * the channel-major input directly as the right sgemm operand.
+ *
+ * The fused epilogue (residual add and activation) runs on the output
+ * of every group right after its sgemm, or on the whole sample for the
+ * Winograd and depthwise kernels. With a residual epilogue the inputs
+ * hold the batch of the input operand followed by the batch of the
+ * residual operand, which has the shape of the output.
+ */
+class ConvolutionLayer : public Layer<float> {
+ public:
+  explicit ConvolutionLayer(uint32_t in_channels, uint32_t out_channels, uint32_t kernel_h,
+                            uint32_t kernel_w, uint32_t stride_h, uint32_t stride_w,
+                            uint32_t padding_h, uint32_t padding_w, uint32_t dilation_h,
+                            uint32_t dilation_w, uint32_t groups, bool use_bias);
+
+  StatusCode Build(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  size_t WorkspaceSize() const override;
+
+  bool IsLayoutSupported(TensorLayout layout) const override;
+
+  TensorLayout PreferredLayout() const override;
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  /**
+   * @brief Packs the weights for the matrix product
+   *
+   * @param weights out_channels x (in_channels / groups) x kernel_h x
+   * kernel_w weights, row-major as stored by PNNX
+   * @return kSuccess, or kParseWeightError on a size mismatch
+   */
+  StatusCode set_weights(const std::vector<float>& weights);
+
+  /**
+   * @brief Sets the bias
+   *
+   * @param bias out_channels values
+   * @return kSuccess, or kParseWeightError on a size mismatch
+   */
+  StatusCode set_bias(const std::vector<float>& bias);
+
+  /**
+   * @brief Sets the epilogue applied to the output
+   *
+   * @param epilogue Residual add and activation fused into the layer
+   */
+  void set_epilogue(const FusedEpilogue& epilogue);
+
+  /**
+   * @brief Gets the kernel chosen at Build
+   *
+   * @return The convolution algorithm
+   */
+  ConvolutionAlgorithm algorithm() const { return this->algorithm_; }
+
+  /**
+   * @brief Computes the output size of one spatial dimension
+   *
+   * @return The output size, 0 if the kernel does not fit
+   */
+  static uint32_t OutputSize(uint32_t input_size, uint32_t kernel_size, uint32_t stride,
+                             uint32_t padding, uint32_t dilation);
+
+  /**
+   * @brief Creates a convolution layer from an nn.Conv2d operator
+   *
+   * @param op The runtime operator
+   * @param conv_layer Receives the created layer
+   * @return Status code of the creation
+   */
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& conv_layer);
+
+ private:
+  /**
+   * @brief Gathers one input sample into the im2col matrix
+   *
+   * Row (c * kernel_h + kh) * kernel_w + kw holds, for every output
+   * pixel in column-major order, the input pixel under kernel tap
+   * (kh, kw) of channel c, or zero where the tap falls into padding.
+   */
+  void Im2col(const Tensor<float>& input, float* col) const;
+
+  /**
+   * @brief Runs the im2col and sgemm kernel on one sample
+   */
+  void ForwardIm2colGemm(const Tensor<float>& input, const float* residual, Tensor<float>& output,
+                         float* col) const;
+
+  /**
+   * @brief Runs the Winograd F(4x4, 3x3) kernel on one sample
+   *
+   * Transforms the input tiles, multiplies them with the filters
+   * transformed at Build in one sgemm per tile element, and transforms
+   * the products back into the output.
+   */
+  void ForwardWinograd(const Tensor<float>& input, const float* residual, Tensor<float>& output,
+                       float* workspace) const;
+
+  /**
+   * @brief Runs the direct depthwise kernel on one sample
+   */
+  void ForwardDepthwise(const Tensor<float>& input, const float* residual,
+                        Tensor<float>& output) const;
+
+  /**
+   * @brief Runs a 1x1 convolution as sgemm on the input planes
+   */
+  void ForwardPointwise(const Tensor<float>& input, const float* residual,
+                        Tensor<float>& output) const;
+
+  /**
+   * @brief Multiplies the weights of every group with its input rows
+   *
+   * @param input in_channels x output plane row-major matrix, the
+   * im2col matrix or, for pointwise convolutions, the input itself
+   * @param residual Residual with the output's shape, null without one
+   * @param output Output tensor, written in place
+   */
+  void GroupGemm(const float* input, const float* residual, Tensor<float>& output) const;
+
+  /**
+   * @brief Checks for a depthwise convolution with one filter per channel,
+   * the only kind that runs on channel-blocked tensors
+   */
+  bool IsBlockedDepthwise() const;
+
+  /**
+   * @brief Packs the depthwise filters and bias for a channel block size
+   */
+  void PackBlockedDepthwise(uint32_t block_size);
+
+  /**
+   * @brief Chooses the kernel for the spatial sizes set at Build
+   */
+  ConvolutionAlgorithm SelectAlgorithm() const;
+
+  /**
+   * @brief Writes the bias into every output plane, or zeros without bias
+   */
+  void FillBias(float* output, uint32_t output_plane) const;
+
+  uint32_t in_channels_ = 0;
+  uint32_t out_channels_ = 0;
+  uint32_t kernel_h_ = 0;
+  uint32_t kernel_w_ = 0;
+  uint32_t stride_h_ = 1;
+  uint32_t stride_w_ = 1;
+  uint32_t padding_h_ = 0;
+  uint32_t padding_w_ = 0;
+  uint32_t dilation_h_ = 1;
+  uint32_t dilation_w_ = 1;
+  uint32_t groups_ = 1;
+  bool use_bias_ = false;
+  FusedEpilogue epilogue_;
+
+  ConvolutionAlgorithm algorithm_ = ConvolutionAlgorithm::kIm2colGemm;
+
+  /// Input and output spatial sizes, set at Build
+  uint32_t input_h_ = 0;
+  uint32_t input_w_ = 0;
+  uint32_t output_h_ = 0;
+  uint32_t output_w_ = 0;
+
+  /// Weights as out_channels x (in_channels / groups * kernel_h * kernel_w)
+  /// row-major, 64-byte aligned, the left operand of every group's sgemm
+  std::shared_ptr<float> packed_weights_;
+
+  /// Filters transformed to the Winograd domain at Build, 36 row-major
+  /// out_channels x in_channels matrices, null unless kWinograd is chosen
+  std::shared_ptr<float> winograd_weights_;
+
+  /// Depthwise filters and bias for blocked inputs, packed at Build,
+  /// valid while blocked_block_size_ is not 0
+  std::shared_ptr<float> blocked_weights_;
+  std::shared_ptr<float> blocked_bias_;
+  uint32_t blocked_block_size_ = 0;
+
+  /// Output tiles of the Winograd kernel
+  uint32_t tiles_h_ = 0;
+  uint32_t tiles_w_ = 0;
+
+  std::vector<float> bias_;
+
+  /// Workspace of a layer that runs outside a runtime graph
+  std::shared_ptr<float> owned_workspace_;
+  size_t owned_workspace_size_ = 0;
+};
+
+}  // namespace kuiper_infer
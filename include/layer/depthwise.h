@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace kuiper_infer {
+/**
+ * @brief Shape of a depthwise convolution
+ */
+struct DepthwiseShape {
+  uint32_t in_channels = 0;
+  /// A multiple of in_channels, output channel c reads input channel
+  /// c / (out_channels / in_channels)
+  uint32_t out_channels = 0;
+  uint32_t input_h = 0;
+  uint32_t input_w = 0;
+  uint32_t output_h = 0;
+  uint32_t output_w = 0;
+  uint32_t kernel_h = 0;
+  uint32_t kernel_w = 0;
+  uint32_t stride_h = 1;
+  uint32_t stride_w = 1;
+  uint32_t padding_h = 0;
+  uint32_t padding_w = 0;
+  uint32_t dilation_h = 1;
+  uint32_t dilation_w = 1;
+};
+
+/**
+ * @brief Direct depthwise convolution of one column-major sample
+ *
+ * Every output channel is computed from its own input channel without
+ * any intermediate buffer. Output pixels whose taps all lie inside the
+ * input are vectorized along the contiguous output column; the border
+ * ring handles the zero padding per pixel. 3x3 and 5x5 kernels with
+ * strides 1 and 2 and no dilation use kernels unrolled at compile time.
+ *
+ * @param input in_channels x input_h x input_w column-major planes
+ * @param weights out_channels x kernel_h x kernel_w row-major filters
+ * @param bias out_channels values, or null
+ * @param shape Shape of the convolution
+ * @param output out_channels x output_h x output_w column-major planes
+ */
+void DepthwiseConvolution(const float* input, const float* weights, const float* bias,
+                          const DepthwiseShape& shape, float* output);
+
+/**
+ * @brief Direct depthwise convolution of one channel-blocked sample
+ *
+ * Runs on the kNCHW8c/kNCHW16c layouts with one filter per channel
+ * (in_channels == out_channels). Every pixel holds block_size channels
+ * next to each other, so each tap is a single multiply-add over one
+ * vector of channels, and border pixels skip the taps in the padding.
+ *
+ * @param input Channel blocks of input_h x input_w pixels
+ * @param weights Channel blocks of kernel_h x kernel_w taps, block_size
+ * lanes per tap, zero for the padded channels
+ * @param bias block_size lanes per channel block
+ * @param shape Shape of the convolution
+ * @param block_size Channel block size, 8 or 16
+ * @param output Channel blocks of output_h x output_w pixels
+ */
+void DepthwiseConvolutionBlocked(const float* input, const float* weights, const float* bias,
+                                 const DepthwiseShape& shape, uint32_t block_size, float* output);
+
+}  // namespace kuiper_infer
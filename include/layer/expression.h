@@ -0,0 +1,183 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "layer/layer.h"
+#include "runtime/op.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Instruction of a compiled expression
+ */
+enum class ExpressionOp : uint8_t {
+  // 叶子
+  kInput = 0,
+  kConstant = 1,
+  // 一元运算
+  kNeg = 10,
+  kAbs = 11,
+  kSquare = 12,
+  kSqrt = 13,
+  kRsqrt = 14,
+  kReciprocal = 15,
+  kExp = 16,
+  kLog = 17,
+  kSin = 18,
+  kCos = 19,
+  kTanh = 20,
+  kFloor = 21,
+  kCeil = 22,
+  kRound = 23,
+  kTrunc = 24,
+  kSign = 25,
+  // 激活函数, PNNX不会生成, 由FuseElementwiseChains融合激活算子时使用
+  kRelu = 30,
+  kSigmoid = 31,
+  kSilu = 32,
+  kGelu = 33,
+  kGeluTanh = 34,
+  kHardSwish = 35,
+  // 二元运算
+  kAdd = 40,
+  kSub = 41,
+  kMul = 42,
+  kDiv = 43,
+  kMaximum = 44,
+  kMinimum = 45,
+  kPow = 46,
+  kAtan2 = 47,
+  kFmod = 48,
+  kRemainder = 49,
+  kFloorDivide = 50,
+  /// leaky_relu(x, slope), the slope is the second operand
+  kLeakyRelu = 51,
+};
+
+struct ExpressionInstruction {
+  ExpressionOp op = ExpressionOp::kConstant;
+
+  /// Input operand read by kInput
+  uint32_t input = 0;
+
+  /// Value pushed by kConstant
+  float value = 0.f;
+};
+
+/**
+ * @brief A PNNX expression compiled into stack bytecode
+ *
+ * The prefix form PNNX stores, e.g. add(mul(@0,@1),2.000000e+00), is
+ * compiled once into postfix instructions. Evaluation runs the program
+ * on blocks of kBlockSize elements: every instruction is one tight loop
+ * over the block, so the interpretation cost is paid once per block and
+ * the loops vectorize. Intermediate values live in a small per-thread
+ * stack of blocks and never reach memory beyond L1.
+ */
+class ExpressionProgram {
+ public:
+  /// Number of elements evaluated per instruction dispatch
+  static constexpr uint32_t kBlockSize = 256;
+
+  /// Deepest operand stack a program may use
+  static constexpr uint32_t kMaxStackDepth = 16;
+
+  /**
+   * @brief Compiles a PNNX expression
+   *
+   * Supports tensor inputs @N, numeric constants and the elementwise
+   * unary and binary functions of ExpressionOp, including the activation
+   * functions relu, sigmoid, silu, gelu, gelu_tanh, hardswish and
+   * leaky_relu(x, slope) that FuseElementwiseChains emits. Shape queries
+   * (size), lists and casts are rejected.
+   *
+   * @param expr The expr parameter of a pnnx.Expression operator
+   * @param program Receives the compiled program
+   * @return kSuccess, or kParseParameterError on an unsupported expression
+   */
+  static StatusCode Compile(const std::string& expr, ExpressionProgram& program);
+
+  /**
+   * @brief Evaluates up to kBlockSize elements
+   *
+   * Element j of input i is read from inputs[i][j * strides[i]]; a stride
+   * of 0 broadcasts one value.
+   *
+   * @param inputs Pointers to the first element of every input
+   * @param strides Element stride of every input
+   * @param output Output of count contiguous elements
+   * @param count Number of elements, at most kBlockSize
+   */
+  void EvaluateBlock(const float* const* inputs, const size_t* strides, float* output,
+                     uint32_t count) const;
+
+  /**
+   * @brief Number of tensor inputs the program reads, max @N + 1
+   */
+  uint32_t num_inputs() const { return num_inputs_; }
+
+  const std::vector<ExpressionInstruction>& instructions() const { return instructions_; }
+
+ private:
+  std::vector<ExpressionInstruction> instructions_;
+  uint32_t num_inputs_ = 0;
+};
+
+/**
+ * @brief Elementwise expression layer, pnnx.Expression
+ *
+ * Evaluates the compiled expression in a single pass over the output.
+ * Inputs broadcast by numpy rules: broadcast dimensions are read with
+ * stride 0 instead of being expanded. When every input has the output's
+ * shape and layout the whole contiguous batch is one flat loop.
+ *
+ * The inputs hold the batch of every input operand one after another,
+ * in the order of the @N references.
+ */
+class ExpressionLayer : public Layer<float> {
+ public:
+  explicit ExpressionLayer(ExpressionProgram program);
+
+  StatusCode Build(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool IsLayoutSupported(TensorLayout layout) const override;
+
+  const ExpressionProgram& program() const { return program_; }
+
+  /**
+   * @brief Creates an expression layer from a pnnx.Expression operator
+   *
+   * @param op The runtime operator
+   * @param expression_layer Receives the created layer
+   * @return Status code of the creation
+   */
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& expression_layer);
+
+ private:
+  /**
+   * @brief Checks the operand count and that every input broadcasts to
+   * its output
+   */
+  StatusCode CheckTensors(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                          const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const;
+
+  /**
+   * @brief Evaluates one sample whose inputs need broadcasting
+   */
+  void ForwardBroadcast(const std::vector<const Tensor<float>*>& inputs,
+                        Tensor<float>& output) const;
+
+  /**
+   * @brief Evaluates size elements of inputs that share the output's layout
+   */
+  void ForwardDense(const std::vector<const float*>& inputs, float* output, size_t size) const;
+
+  ExpressionProgram program_;
+};
+
+}  // namespace kuiper_infer
@@ -3,4 +3,113 @@
 #include <armadillo>
 #include <memory>
 #include <numeric>
-#include <vector>
\ No newline at end of file
+#include <string>
+#include <vector>
+#include "data/tensor.h"
+#include "utils/status_code.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Base class of all computation layers
+ *
+ * A layer consumes the input tensors of one runtime operator and writes
+ * into output tensors that were preallocated by the runtime graph.
+ */
+template <typename T>
+class Layer {
+ public:
+  explicit Layer(std::string layer_name) : layer_name_(std::move(layer_name)) {}
+
+  virtual ~Layer() = default;
+
+  /**
+   * @brief Performs forward inference
+   *
+   * Inputs of every input operand are laid out one after another, one
+   * tensor per batch item. The batch items of one operand are views into
+   * one contiguous buffer, so layers can run batch-wide kernels on the
+   * pointer returned by TensorBatchPtr.
+   *
+   * @param inputs Input tensors
+   * @param outputs Output tensors, one per batch item
+   * @return Status code of the forward pass
+   */
+  virtual StatusCode Forward(const std::vector<std::shared_ptr<Tensor<T>>>& inputs,
+                             std::vector<std::shared_ptr<Tensor<T>>>& outputs) = 0;
+
+  /**
+   * @brief Prepares the layer for the tensors it will run on
+   *
+   * Called once by the runtime graph after every tensor of the execution
+   * plan is bound and before the first Forward. The tensors have their
+   * final shapes, layouts and batch size but no data yet. Layers use it
+   * to validate shapes, pick kernels and size their workspace.
+   *
+   * @param inputs Input tensors, as later passed to Forward
+   * @param outputs Output tensors, as later passed to Forward
+   * @return Status code of the build
+   */
+  virtual StatusCode Build(const std::vector<std::shared_ptr<Tensor<T>>>& inputs,
+                           const std::vector<std::shared_ptr<Tensor<T>>>& outputs) {
+    return StatusCode::kSuccess;
+  }
+
+  /**
+   * @brief Gets the scratch memory Forward needs
+   *
+   * Valid after Build. The runtime graph allocates one workspace large
+   * enough for every layer and hands it out through set_workspace; it is
+   * shared by all layers, so its contents do not survive between calls.
+   *
+   * @return Number of elements of scratch memory, 0 if none
+   */
+  virtual size_t WorkspaceSize() const { return 0; }
+
+  /**
+   * @brief Sets the scratch memory used by Forward
+   *
+   * @param workspace 64-byte aligned memory of at least WorkspaceSize()
+   * elements, owned by the caller
+   */
+  void set_workspace(T* workspace) { this->workspace_ = workspace; }
+
+  /**
+   * @brief Checks whether the layer can run on tensors of the given layout
+   *
+   * All inputs and outputs of one forward call share the same layout.
+   * Layout-agnostic layers such as elementwise activations should accept
+   * every layout so that blocked activations can flow through them.
+   *
+   * @param layout Storage layout of the inputs and outputs
+   * @return True if Forward handles the layout
+   */
+  virtual bool IsLayoutSupported(TensorLayout layout) const {
+    return layout == TensorLayout::kColMajor;
+  }
+
+  /**
+   * @brief Gets the layout the layer runs fastest in
+   *
+   * Convolution-style layers return a channel-blocked layout, usually
+   * DefaultBlockedLayout(), so that the graph keeps activations blocked
+   * between them.
+   *
+   * @return The preferred storage layout
+   */
+  virtual TensorLayout PreferredLayout() const { return TensorLayout::kColMajor; }
+
+  /**
+   * @brief Gets the layer name
+   *
+   * @return The layer name
+   */
+  const std::string& layer_name() const { return this->layer_name_; }
+
+ protected:
+  std::string layer_name_;
+
+  /// Scratch memory of at least WorkspaceSize() elements, set by the graph
+  T* workspace_ = nullptr;
+};
+
+}  // namespace kuiper_infer
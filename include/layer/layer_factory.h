@@ -0,0 +1,99 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "layer/layer.h"
+#include "runtime/op.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Registry of layer creators keyed by PNNX operator type
+ *
+ * Layers register a creator for their operator type ("nn.Linear",
+ * "F.relu", ...) through a static LayerRegistererWrapper in their
+ * source file. The runtime graph resolves every operator to its layer
+ * once at Build time; Forward then only calls the resolved layers.
+ */
+class LayerRegisterer {
+ public:
+  /**
+   * @brief Creates a layer from a runtime operator
+   *
+   * Reads the parameters and attributes of the operator and returns
+   * kSuccess with the created layer, or an error status.
+   */
+  typedef StatusCode (*Creator)(const std::shared_ptr<RuntimeOperator>& op,
+                                std::shared_ptr<Layer<float>>& layer);
+
+  typedef std::unordered_map<std::string, Creator> CreateRegistry;
+
+  /**
+   * @brief Registers the creator of an operator type
+   *
+   * Registering one type twice is a fatal error.
+   *
+   * @param layer_type PNNX operator type
+   * @param creator Creator function
+   */
+  static void RegisterCreator(const std::string& layer_type, const Creator& creator);
+
+  /**
+   * @brief Creates the layer of an operator
+   *
+   * Fails fatally if the type is not registered or the creator fails.
+   *
+   * @param op The runtime operator
+   * @return The created layer
+   */
+  static std::shared_ptr<Layer<float>> CreateLayer(const std::shared_ptr<RuntimeOperator>& op);
+
+  /**
+   * @brief Checks whether an operator type has a creator
+   *
+   * @param layer_type PNNX operator type
+   * @return True if the type is registered
+   */
+  static bool IsRegistered(const std::string& layer_type);
+
+  /**
+   * @brief Gets the registered operator types
+   *
+   * @return Registered types in unspecified order
+   */
+  static std::vector<std::string> layer_types();
+
+  /**
+   * @brief Gets the registry
+   *
+   * Constructed on first use, so registrations from static objects of
+   * other translation units are safe.
+   *
+   * @return The registry
+   */
+  static CreateRegistry& Registry();
+};
+
+/**
+ * @brief Registers a layer creator during static initialization
+ *
+ * Defined at namespace scope in the layer's source file, for example
+ * LayerRegistererWrapper kLinearCreateInstance("nn.Linear", LinearLayer::CreateInstance);
+ */
+class LayerRegistererWrapper {
+ public:
+  explicit LayerRegistererWrapper(const std::string& layer_type,
+                                  const LayerRegisterer::Creator& creator) {
+    LayerRegisterer::RegisterCreator(layer_type, creator);
+  }
+
+  /// Registers one creator for several operator types, e.g. F.relu and nn.ReLU
+  explicit LayerRegistererWrapper(const std::vector<std::string>& layer_types,
+                                  const LayerRegisterer::Creator& creator) {
+    for (const std::string& layer_type : layer_types) {
+      LayerRegisterer::RegisterCreator(layer_type, creator);
+    }
+  }
+};
+
+}  // namespace kuiper_infer
@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "layer/activation.h"
+#include "layer/layer.h"
+#include "runtime/op.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Fully connected layer, nn.Linear
+ *
+ * Applies y = x * W^T + b on the last dimension of every sample. When
+ * the batch is contiguous and each sample is a row-major matrix, all
+ * samples are stacked into one matrix and computed with a single sgemm;
+ * a single row uses sgemv. Bias is broadcast into the output before the
+ * product, which is then accumulated on top of it, and the fused
+ * epilogue (residual add and activation) runs on each block of rows
+ * right after its product.
+ *
+ * With a residual epilogue the inputs hold the batch of the input
+ * operand followed by the batch of the residual operand, which has the
+ * shape and layout of the output.
+ */
+class LinearLayer : public Layer<float> {
+ public:
+  explicit LinearLayer(int32_t in_features, int32_t out_features, bool use_bias);
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool IsLayoutSupported(TensorLayout layout) const override;
+
+  /**
+   * @brief Packs the weights for the matrix product
+   *
+   * @param weights out_features x in_features weights, row-major as
+   * stored by PNNX
+   * @return kSuccess, or kParseWeightError on a size mismatch
+   */
+  StatusCode set_weights(const std::vector<float>& weights);
+
+  /**
+   * @brief Sets the bias
+   *
+   * @param bias out_features values
+   * @return kSuccess, or kParseWeightError on a size mismatch
+   */
+  StatusCode set_bias(const std::vector<float>& bias);
+
+  /**
+   * @brief Sets the epilogue applied to the output
+   *
+   * @param epilogue Residual add and activation fused into the layer
+   */
+  void set_epilogue(const FusedEpilogue& epilogue);
+
+  /**
+   * @brief Creates a linear layer from an nn.Linear operator
+   *
+   * @param op The runtime operator
+   * @param linear_layer Receives the created layer
+   * @return Status code of the creation
+   */
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& linear_layer);
+
+ private:
+  /**
+   * @brief Computes output rows = input rows * W^T + b for one matrix
+   *
+   * @param input Row-major rows x in_features input
+   * @param residual Row-major rows x out_features residual, or null
+   * @param output Row-major rows x out_features output
+   * @param rows Number of rows
+   */
+  void ForwardRows(const float* input, const float* residual, float* output, uint32_t rows) const;
+
+  /**
+   * @brief Computes one column-major rows x in_features plane
+   */
+  void ForwardColMajorPlane(const float* input, const float* residual, float* output,
+                            uint32_t rows) const;
+
+  int32_t in_features_ = 0;
+  int32_t out_features_ = 0;
+  bool use_bias_ = false;
+  FusedEpilogue epilogue_;
+
+  /// Weights packed once as in_features x out_features row-major (W^T),
+  /// 64-byte aligned, so both sgemm operands are used without transposes
+  std::shared_ptr<float> packed_weights_;
+
+  std::vector<float> bias_;
+};
+
+}  // namespace kuiper_infer
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace kuiper_infer {
+/// Output tile edge of Winograd F(4x4, 3x3)
+constexpr uint32_t kWinogradOutputTile = 4;
+
+/// Input tile edge of Winograd F(4x4, 3x3), output tile + kernel - 1
+constexpr uint32_t kWinogradInputTile = 6;
+
+/// Elements of one transformed tile
+constexpr uint32_t kWinogradTileSize = kWinogradInputTile * kWinogradInputTile;
+
+/**
+ * @brief Transforms 3x3 filters into the Winograd F(4x4, 3x3) domain
+ *
+ * Computes U = G g G^T for every filter. The result is laid out as
+ * kWinogradTileSize row-major out_channels x in_channels matrices, one
+ * per tile element, the left operands of the per-element sgemm.
+ *
+ * @param weights out_channels x in_channels x 3 x 3 filters, row-major
+ * @param out_channels Number of output channels
+ * @param in_channels Number of input channels
+ * @param transformed Output of kWinogradTileSize * out_channels *
+ * in_channels elements
+ */
+void WinogradTransformFilter(const float* weights, uint32_t out_channels, uint32_t in_channels,
+                             float* transformed);
+
+/**
+ * @brief Transforms the input tiles of one column-major sample
+ *
+ * Gathers the overlapping 6x6 tiles that produce each 4x4 output tile
+ * and computes V = B^T d B. Taps outside the input read as zero, so the
+ * padding of the convolution needs no padded copy. The result is laid
+ * out as kWinogradTileSize row-major channels x tiles matrices.
+ *
+ * @param input channels x input_h x input_w column-major planes
+ * @param channels Number of input channels
+ * @param input_h Input height
+ * @param input_w Input width
+ * @param padding_h Top and bottom zero padding
+ * @param padding_w Left and right zero padding
+ * @param tiles_h Number of output tiles along the height
+ * @param tiles_w Number of output tiles along the width
+ * @param transformed Output of kWinogradTileSize * channels * tiles_h *
+ * tiles_w elements
+ */
+void WinogradTransformInput(const float* input, uint32_t channels, uint32_t input_h,
+                            uint32_t input_w, uint32_t padding_h, uint32_t padding_w,
+                            uint32_t tiles_h, uint32_t tiles_w, float* transformed);
+
+/**
+ * @brief Transforms the products back into column-major output planes
+ *
+ * Computes Y = A^T m A for every tile, adds the bias and writes the
+ * part of the 4x4 tile that lies inside the output.
+ *
+ * @param transformed kWinogradTileSize row-major channels x tiles
+ * matrices
+ * @param channels Number of output channels
+ * @param tiles_h Number of output tiles along the height
+ * @param tiles_w Number of output tiles along the width
+ * @param bias channels values, or null
+ * @param output channels x output_h x output_w column-major planes
+ * @param output_h Output height
+ * @param output_w Output width
+ */
+void WinogradTransformOutput(const float* transformed, uint32_t channels, uint32_t tiles_h,
+                             uint32_t tiles_w, const float* bias, float* output, uint32_t output_h,
+                             uint32_t output_w);
+
+}  // namespace kuiper_infer
@@ -2,6 +2,8 @@
 
 #include <glog/logging.h>
 #include "runtime/datatype.h"
+#include <cstring>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -11,7 +13,18 @@ namespace kuiper_infer {
 
     explicit RuntimeAttribute(std::vector<int32_t> shape, RuntimeDataType type,
                             std::vector<char> weight_data)
-      : shape(std::move(shape)), type(type), weight_data(std::move(weight_data)) {}
+      : weight_data(std::move(weight_data)), shape(std::move(shape)), type(type) {}
+
+    /**
+     * @brief Creates an attribute viewing weights in a memory-mapped model file
+     *
+     * @param mapped_data Start of the weights, keeps the mapping alive
+     * @param mapped_size Bytes of the weights
+     */
+    explicit RuntimeAttribute(std::vector<int32_t> shape, RuntimeDataType type,
+                              std::shared_ptr<const char> mapped_data, size_t mapped_size)
+        : shape(std::move(shape)), type(type), mapped_data(std::move(mapped_data)),
+          mapped_size(mapped_size) {}
 
 
     /**
@@ -30,27 +43,46 @@ namespace kuiper_infer {
 
     RuntimeDataType type = RuntimeDataType::kTypeUnknown;
 
+    /**
+ * @brief Read-only view of the weights in the memory-mapped pnnx.bin
+ *
+ * Used instead of weight_data when set, the weights are never copied
+ * into the attribute.
+ */
+    std::shared_ptr<const char> mapped_data;
+
+    size_t mapped_size = 0;
+
+    /**
+ * @brief Weight bytes of either storage
+ */
+    const char* data() const { return mapped_data ? mapped_data.get() : weight_data.data(); }
+
+    size_t size() const { return mapped_data ? mapped_size : weight_data.size(); }
+
+    /**
+ * @brief Copies the weights out as elements of T
+ *
+ * @param need_clear_weight Releases the attribute's weights afterwards
+ */
     template <class T>
     std::vector<T> get(bool need_clear_weight = true);
     };
     template <class T>
     std::vector<T> RuntimeAttribute::get(bool need_clear_weight) {
-    CHECK(!weight_data.empty());
+    CHECK(size() != 0);
     CHECK(type != RuntimeDataType::kTypeUnknown);
     const uint32_t elem_size = sizeof(T);
-    CHECK_EQ(weight_data.size() % elem_size, 0);
-    const uint32_t weight_data_size = weight_data.size() / elem_size;
+    CHECK_EQ(size() % elem_size, 0);
+    const uint32_t weight_data_size = size() / elem_size;
 
     std::vector<T> weights;
-    weights.reserve(weight_data_size);
     switch (type) {
         case RuntimeDataType::kTypeFloat32: {
         static_assert(std::is_same<T, float>::value == true);
-        float* weight_data_ptr = reinterpret_cast<float*>(weight_data.data());
-        for (uint32_t i = 0; i < weight_data_size; ++i) {
-            float weight = *(weight_data_ptr + i);
-            weights.push_back(weight);
-        }
+        // 映射的数据不保证对齐, 整块拷贝
+        weights.resize(weight_data_size);
+        std::memcpy(weights.data(), data(), size_t(weight_data_size) * elem_size);
         break;
         }
         default: {
@@ -60,7 +92,9 @@ namespace kuiper_infer {
     if (need_clear_weight) {
         std::vector<char> empty_vec = std::vector<char>();
         this->weight_data.swap(empty_vec);
+        this->mapped_data.reset();
+        this->mapped_size = 0;
     }
     return weights;
     }
-}
\ No newline at end of file
+}
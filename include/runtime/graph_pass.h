@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include "runtime/pnnx/ir.h"
+
+namespace kuiper_infer {
+/**
+ * @brief Folds inference BatchNorm into the preceding layer
+ *
+ * Finds nn.BatchNorm2d after nn.Conv2d and nn.BatchNorm1d after a 2-d
+ * nn.Linear output where the BatchNorm is the only consumer. Each one is
+ * folded into the layer's weights and bias, w' = w * s and
+ * b' = (b - mean) * s + beta, with s = gamma / sqrt(var + eps). A bias
+ * is added to the layer if it had none. The BatchNorm operator and its
+ * input operand are then removed, and the layer writes the BatchNorm's
+ * output operand directly.
+ *
+ * Runs on the PNNX graph before runtime operators are created.
+ *
+ * @param graph The loaded PNNX graph, modified in place
+ * @return Number of folded BatchNorm operators
+ */
+int32_t FoldBatchNorm(pnnx::Graph& graph);
+
+/**
+ * @brief Fuses residual adds and activations into the preceding GEMM layer
+ *
+ * An activation operator (F.relu, nn.SiLU, torch.clamp, ...) whose input
+ * is an nn.Conv2d or nn.Linear output with no other consumer is removed
+ * and recorded on the layer as the fused_activation parameters. A
+ * pnnx.Expression add(@0,@1) of such an output and another tensor of the
+ * same shape is removed as well; the other tensor becomes the layer's
+ * second input operand and the layer gets fused_residual=True. The layer
+ * then computes act(x * W + b + residual) in its output epilogue.
+ *
+ * An add is only fused into a layer without a fused activation, as
+ * act(y) + residual does not match the epilogue order. Broadcasting adds
+ * are left alone.
+ *
+ * Runs on the PNNX graph after FoldBatchNorm, so Conv-BN-ReLU chains
+ * collapse into a single layer.
+ *
+ * @param graph The loaded PNNX graph, modified in place
+ * @return Number of fused operators
+ */
+int32_t FuseGemmEpilogue(pnnx::Graph& graph);
+
+/**
+ * @brief Merges chains of elementwise operators into single expressions
+ *
+ * Elementwise operators are pnnx.Expression and the activation operators
+ * ActivationLayer runs. When the output of one feeds another, has no
+ * other consumer and is referenced once in the consumer's expression, the
+ * producer's expression is substituted into the consumer's, which becomes
+ * a pnnx.Expression over the inputs of both; the producer and the
+ * intermediate operand are removed. Every single-consumer chain ends up
+ * as one ExpressionLayer that reads its inputs and writes its output
+ * once. A consumer that reads the intermediate more than once, e.g.
+ * mul(@0,@0), is not merged, as that would evaluate the producer's
+ * expression once per reference.
+ *
+ * Operators are visited once in topological order, so every producer is
+ * complete before its consumer merges it. Merged expressions are capped
+ * at a few hundred instructions, so a very long chain is split into
+ * several expressions instead of being recompiled at every step.
+ *
+ * Runs after FuseGemmEpilogue, which takes precedence for activations
+ * directly after a convolution or linear layer.
+ *
+ * @param graph The loaded PNNX graph, modified in place
+ * @return Number of removed operators
+ */
+int32_t FuseElementwiseChains(pnnx::Graph& graph);
+
+}  // namespace kuiper_infer
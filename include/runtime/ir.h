@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include "op.h"
+#include "layer/layer.h"
 
 
 namespace kuiper_infer {
@@ -109,7 +110,7 @@ class RuntimeGraph {
   /**
    * @brief Executes the computation graph
    *
-   * Executes the graph operations in depth-first order.
+   * Runs the execution plan compiled by Build in topological order.
    *
    * @param debug Whether to print debugging information during execution
    */
@@ -204,25 +205,37 @@ class RuntimeGraph {
   /**
    * @brief Creates a Layer object for a graph operator
    *
-   * Creates and initializes a Layer object corresponding to the given
-   * RuntimeOperator.
+   * Looks up the creator registered for the operator type in
+   * LayerRegisterer. Called once per operator at Build time.
    *
    * @param op The RuntimeOperator to create a Layer for
    * @return Pointer to the created Layer object
    */
-  template <typename T>
-  static std::shared_ptr<Layer<T>> CreateLayer(const std::shared_ptr<RuntimeOperatorBase<T>>& op);
+  static std::shared_ptr<Layer<float>> CreateLayer(const std::shared_ptr<RuntimeOperator>& op);
 
   /**
-   * Propagate output data from current operator to inputs of next operators.
+   * @brief Chooses the storage layout of every operator
+   *
+   * Operators whose layer prefers a channel-blocked layout run blocked,
+   * layout-agnostic operators inherit the layout of their first input,
+   * and all others run column-major. Activations therefore stay blocked
+   * between convolution-style layers and are only reordered where the
+   * layout changes.
    *
-   * @param current_op Current operator whose outputs will be propagated
-   * @param layer_output_datas Output data from current operator
+   * @param pnnx_operators PNNX operators parallel to the sorted operators
    */
-  template <typename T>
-  static void PropagateLayerOutputs(
-      const std::shared_ptr<RuntimeOperatorBase<T>>& current_op,
-      const std::vector<std::shared_ptr<Tensor<T>>>& layer_output_data);
+  void PlanTensorLayouts(const std::vector<pnnx::Operator*>& pnnx_operators);
+
+  /**
+   * @brief Compiles the sorted operators into a flat execution plan
+   *
+   * Binds every consumer input operand to the output tensors of its
+   * producer and records one step per computing operator, so that
+   * Forward does not need to look up or propagate anything by name.
+   * Where a consumer runs in another layout than its producer, the step
+   * reorders into tensors of the consumer layout first.
+   */
+  void BuildExecutionPlan();
 
  private:
   /**
@@ -242,7 +255,61 @@ class RuntimeGraph {
    */
   GraphState graph_state() const;
 
+  /**
+   * @brief Gets the activation memory plan
+   *
+   * Valid after Build; reports planned and naive activation bytes.
+   *
+   * @return The activation memory plan
+   */
+  const RuntimeMemoryPlan& memory_plan() const;
+
+  /**
+   * @brief Gets the storage layout planned for an operator
+   *
+   * Valid after Build; the operator's outputs are stored in this layout
+   * and its inputs are reordered into it.
+   *
+   * @param op_name Name of the operator
+   * @return The planned layout
+   */
+  TensorLayout operator_layout(const std::string& op_name) const;
+
+  /**
+   * @brief Gets the number of tensors reordered before an operator runs
+   *
+   * Valid after Build; every batch item of an input in another layout
+   * counts once.
+   *
+   * @param op_name Name of the operator
+   * @return Number of reorders of the operator's step, 0 without one
+   */
+  size_t reorder_count(const std::string& op_name) const;
+
  private:
+  /**
+   * @brief One precompiled step of the execution plan
+   *
+   * Holds the resolved layer and the tensors it reads and writes, bound
+   * once at Build time.
+   */
+  struct ExecutionStep {
+    /// Operator executed by this step
+    const RuntimeOperator* op = nullptr;
+
+    /// Layer of the operator, null for a graph output that only reorders
+    Layer<float>* layer = nullptr;
+
+    /// Layout conversions run before the layer, producer tensor first
+    std::vector<std::pair<sftensor, sftensor>> reorders;
+
+    /// Input tensors of all input operands, in operand order
+    std::vector<sftensor> inputs;
+
+    /// Output tensors, one per batch item
+    std::vector<sftensor> outputs;
+  };
+
   std::string bin_path_;
   std::string param_path_;
   std::unique_ptr<pnnx::Graph> graph_;
@@ -251,6 +318,8 @@ class RuntimeGraph {
   std::vector<std::shared_ptr<RuntimeOperator>> input_ops_;
   std::vector<std::shared_ptr<RuntimeOperator>> output_ops_;
   std::vector<std::shared_ptr<RuntimeOperator>> operators_;
+  std::vector<ExecutionStep> execution_plan_;
+  RuntimeMemoryPlan memory_plan_;
 };
 
 }
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kuiper_infer {
+/**
+ * @brief Lifetime of one activation buffer
+ *
+ * Times are indices into the topologically sorted operators. A buffer is
+ * live from the step that produces it up to and including its last use.
+ */
+struct TensorLifetime {
+  /// Number of elements of the buffer
+  size_t size = 0;
+
+  /// Execution index of the producer
+  int32_t start_time = -1;
+
+  /// Execution index of the last consumer
+  int32_t end_time = -1;
+
+  /// Planned offset in elements from the start of the arena
+  size_t offset = 0;
+};
+
+/**
+ * @brief Activation memory of a built graph
+ *
+ * All operator outputs are views into one contiguous arena.
+ */
+struct RuntimeMemoryPlan {
+  /// Arena holding every planned activation, 64-byte aligned
+  std::shared_ptr<float> arena;
+
+  /// Bytes of the arena after offset planning
+  size_t planned_bytes = 0;
+
+  /// Bytes needed if every output owned its own buffer
+  size_t naive_bytes = 0;
+
+  /// Number of outputs planned as a channel slice of a torch.cat output,
+  /// written in place by their producer instead of being copied
+  size_t concat_slices = 0;
+
+  /// Scratch memory shared by all layers, sized to the largest
+  /// Layer::WorkspaceSize(), null if no layer needs any
+  std::shared_ptr<float> workspace;
+
+  /// Bytes of the workspace
+  size_t workspace_bytes = 0;
+};
+
+/// Alignment of every planned buffer, in elements (64 bytes of float)
+constexpr size_t kArenaAlignment = 16;
+
+/**
+ * @brief Assigns arena offsets to buffers by lifetime
+ *
+ * Greedy by size: the largest buffers are placed first, each into the
+ * smallest free gap left by already placed buffers whose lifetimes
+ * overlap with it, or after all of them if no gap fits. Buffers whose
+ * lifetimes do not overlap may share memory.
+ *
+ * @param lifetimes Buffers to place, offsets are written back
+ * @return Arena size in elements
+ */
+size_t PlanMemoryOffsets(std::vector<TensorLifetime>& lifetimes);
+
+/**
+ * @brief Allocates a 64-byte aligned, zero filled float arena
+ *
+ * @param size Number of elements
+ * @return The arena, freed when the last owner releases it
+ */
+std::shared_ptr<float> CreateArena(size_t size);
+
+}  // namespace kuiper_infer
@@ -8,6 +8,7 @@
 #include "operand.h"
 #include "param.h"
 #include "attr.h"
+#include "memory_plan.h"
 #include "pnnx/ir.h"
 
 namespace kuiper_infer {
@@ -20,13 +21,15 @@ struct RuntimeOperatorBase {
   /// Execution order index of this operator
   int32_t start_time = -1;
 
+  /// Execution order index of the last consumer of this operator's output
   int32_t end_time = -1;
 
-  int32_t occur_end_time = -1;
-
   /// Whether this operator has run in current execution
   bool has_forward = false;
 
+  /// Storage layout of the tensors the layer reads and writes
+  TensorLayout layout = TensorLayout::kColMajor;
+
   /// Name of the operator
   std::string name;
 
@@ -114,14 +117,18 @@ class RuntimeOperatorUtils<float> {
   /**
    * @brief Initializes float operator outputs
    *
-   * If first run, initializes output tensors based on shapes.
-   * On later runs, checks shape match.
+   * If first run, plans the lifetimes of all output operands over the
+   * execution order given by start_time/end_time, packs them into one
+   * arena and creates every output tensor as a view at its offset, in
+   * the layout of its producer. On later runs, checks shape match.
    *
    * @param pnnx_operators Vector of PNNX operators
-   * @param operators Vector of runtime operators
+   * @param operators Vector of runtime operators in execution order
+   * @param memory_plan Receives the arena and planned/naive sizes
    */
   static void InitOperatorOutput(const std::vector<pnnx::Operator*>& pnnx_operators,
-                                 const std::vector<std::shared_ptr<RuntimeOperator>>& operators);
+                                 const std::vector<std::shared_ptr<RuntimeOperator>>& operators,
+                                 RuntimeMemoryPlan& memory_plan);
 };
 
 }
\ No newline at end of file
@@ -29,9 +29,16 @@ namespace kuiper_infer{
         /// Shape of the operand
         std::vector<int32_t> shapes;
 
-        /// Vector containing operand data
+        /// Per-sample views, datas[b] points at batch item b of batch_data
         std::vector<std::shared_ptr<Tensor<T>>> datas;
 
+        /// N x C x H x W buffer holding every batch item, sample_size apart
+        std::shared_ptr<T> batch_data;
+
+        /// Elements from one batch item to the next in batch_data, including blocked
+        /// channel padding; larger than a sample for a channel slice of a concat output
+        size_t sample_size = 0;
+
         /// Data type of the operand
         RuntimeDataType type = RuntimeDataType::kTypeUnknown;
     };
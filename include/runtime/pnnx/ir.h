@@ -4,8 +4,10 @@
 #include <initializer_list>
 #include <limits>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace torch {
@@ -193,7 +195,7 @@ class Attribute
 {
 public:
     Attribute()
-        : type(0)
+        : type(0), mapped_size(0)
     {
     }
 
@@ -219,6 +221,15 @@ public:
 
     std::vector<char> data;
 
+    // read-only view of the payload inside the memory-mapped pnnx.bin,
+    // data stays empty while it is set
+    std::shared_ptr<const char> mapped_data;
+    size_t mapped_size;
+
+    // payload of either storage
+    const char* raw_data() const;
+    size_t raw_size() const;
+
     std::map<std::string, Parameter> params;
 };
 
@@ -306,15 +317,27 @@ public:
 
     Operand* new_operand(const std::string& name);
 
+    // O(1) through the name index, operand names are unique in a graph
     Operand* get_operand(const std::string& name);
     const Operand* get_operand(const std::string& name) const;
 
+    // removes the operand from operands and the name index, then deletes it
+    // O(1), the last operand is moved into its slot so operands are not kept in order
+    void delete_operand(Operand* r);
+
     std::vector<Operator*> ops;
     std::vector<Operand*> operands;
 
 private:
     Graph(const Graph& rhs);
     Graph& operator=(const Graph& rhs);
+
+    // position of the named operand in operands, operands.size() if there is none
+    // entries are checked on use and rebuilt by a scan when operands was changed directly
+    size_t operand_position(const std::string& name) const;
+
+    // name -> position in operands
+    mutable std::unordered_map<std::string, size_t> operand_index;
 };
 
 } // namespace pnnx
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdio.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -19,13 +21,29 @@ public:
 
     uint64_t get_file_size(const std::string& name) const;
 
-    int read_file(const std::string& name, char* data);
+    // positional read, several threads may read at the same time
+    int read_file(const std::string& name, char* data) const;
+
+    // read-only view of a stored file inside the memory-mapped archive,
+    // the view keeps the mapping alive after close
+    // returns null if the archive could not be mapped, has no such file
+    // or the file is cut off by the end of the archive
+    std::shared_ptr<const char> map_file(const std::string& name) const;
+
+    // asks the kernel to read the mapped pages of a stored file ahead
+    int prefetch_file(const std::string& name) const;
 
     int close();
 
 private:
     FILE* fp;
 
+    // whole archive mapped read-only, null if mapping failed
+    std::shared_ptr<const char> mapping;
+
+    // bytes of the mapped archive, a truncated archive has entries ending past it
+    uint64_t mapping_size;
+
     struct StoreZipMeta
     {
         uint64_t offset;
@@ -41,7 +59,10 @@ public:
     StoreZipWriter();
     ~StoreZipWriter();
 
-    int open(const std::string& path);
+    // alignment > 1 pads the local extra field of every entry so that its
+    // data starts at a multiple of alignment bytes in the file, e.g. 64 to
+    // read memory-mapped weights with aligned vector loads
+    int open(const std::string& path, int alignment = 0);
 
     int write_file(const std::string& name, const char* data, uint64_t size);
 
@@ -50,6 +71,8 @@ public:
 private:
     FILE* fp;
 
+    int alignment;
+
     struct StoreZipMeta
     {
         std::string name;
@@ -12,4 +12,19 @@ namespace kuiper_infer {
     kParameterFloatArray = 6,
     kParameterStringArray = 7,
     };
-}
\ No newline at end of file
+
+   enum class StatusCode {
+    kUnknownCode = -1,
+    kSuccess = 0,
+
+    kInferInputsEmpty = 1,
+    kInferOutputsEmpty = 2,
+    kInferParameterError = 3,
+    kInferDimMismatch = 4,
+
+    kFunctionNotImplement = 5,
+    kParseWeightError = 6,
+    kParseParameterError = 7,
+    kParseNullOperator = 8,
+    };
+}
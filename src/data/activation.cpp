@@ -0,0 +1,298 @@
+#include "data/activation.h"
+#include <glog/logging.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+
+namespace {
+// 同一套算法对float和向量类型各实例化一次, 标量版本处理尾部和不支持SIMD的平台
+inline float Broadcast(float value, float) { return value; }
+inline float Load(const float* ptr, float) { return *ptr; }
+inline void Store(float* ptr, float value) { *ptr = value; }
+inline float Add(float a, float b) { return a + b; }
+inline float Sub(float a, float b) { return a - b; }
+inline float Mul(float a, float b) { return a * b; }
+inline float Div(float a, float b) { return a / b; }
+inline float Fmadd(float a, float b, float c) { return a * b + c; }
+inline float Max(float a, float b) { return a > b ? a : b; }
+inline float Min(float a, float b) { return a < b ? a : b; }
+inline float Abs(float a) { return std::fabs(a); }
+inline float Floor(float a) { return std::floor(a); }
+inline float SelectNonNegative(float x, float a, float b) { return x >= 0.f ? a : b; }
+inline float Pow2(float n) {
+  const int32_t bits = (int32_t(n) + 127) << 23;
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+#if defined(__AVX512F__)
+#define KUIPER_ACTIVATION_SIMD
+using Vec = __m512;
+constexpr size_t kVecWidth = 16;
+inline Vec Broadcast(float value, Vec) { return _mm512_set1_ps(value); }
+inline Vec Load(const float* ptr, Vec) { return _mm512_loadu_ps(ptr); }
+inline void Store(float* ptr, Vec value) { _mm512_storeu_ps(ptr, value); }
+inline Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+inline Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+inline Vec Div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+inline Vec Fmadd(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+inline Vec Max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+inline Vec Min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+inline Vec Abs(Vec a) { return _mm512_abs_ps(a); }
+inline Vec Floor(Vec a) {
+  return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+inline Vec SelectNonNegative(Vec x, Vec a, Vec b) {
+  return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GE_OQ), b, a);
+}
+inline Vec Pow2(Vec n) {
+  const __m512i bits = _mm512_slli_epi32(
+      _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+  return _mm512_castsi512_ps(bits);
+}
+#elif defined(__AVX2__) && defined(__FMA__)
+#define KUIPER_ACTIVATION_SIMD
+using Vec = __m256;
+constexpr size_t kVecWidth = 8;
+inline Vec Broadcast(float value, Vec) { return _mm256_set1_ps(value); }
+inline Vec Load(const float* ptr, Vec) { return _mm256_loadu_ps(ptr); }
+inline void Store(float* ptr, Vec value) { _mm256_storeu_ps(ptr, value); }
+inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+inline Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+inline Vec Fmadd(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+inline Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+inline Vec Abs(Vec a) {
+  return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+}
+inline Vec Floor(Vec a) { return _mm256_floor_ps(a); }
+inline Vec SelectNonNegative(Vec x, Vec a, Vec b) {
+  return _mm256_blendv_ps(b, a, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GE_OQ));
+}
+inline Vec Pow2(Vec n) {
+  const __m256i bits = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  return _mm256_castsi256_ps(bits);
+}
+#endif
+
+template <typename V>
+inline V Set1(float value) {
+  return Broadcast(value, V());
+}
+
+/*
+* exp(x) = 2^n * exp(r), n = floor(x * log2(e) + 0.5), |r| <= ln2 / 2,
+* exp(r)用Cephes expf的5阶多项式近似, 相对误差 < 2e-7
+*/
+template <typename V>
+inline V Exp(V x) {
+  x = Min(Max(x, Set1<V>(-87.3365f)), Set1<V>(88.3762f));
+  const V n = Floor(Fmadd(x, Set1<V>(1.44269504088896341f), Set1<V>(0.5f)));
+  // ln2拆成高低两部分, 减少r的舍入误差
+  V r = Sub(x, Mul(n, Set1<V>(0.693359375f)));
+  r = Sub(r, Mul(n, Set1<V>(-2.12194440e-4f)));
+
+  V y = Set1<V>(1.9875691500e-4f);
+  y = Fmadd(y, r, Set1<V>(1.3981999507e-3f));
+  y = Fmadd(y, r, Set1<V>(8.3334519073e-3f));
+  y = Fmadd(y, r, Set1<V>(4.1665795894e-2f));
+  y = Fmadd(y, r, Set1<V>(1.6666665459e-1f));
+  y = Fmadd(y, r, Set1<V>(5.0000001201e-1f));
+  y = Fmadd(y, Mul(r, r), Add(r, Set1<V>(1.f)));
+  return Mul(y, Pow2(n));
+}
+
+template <typename V>
+inline V Sigmoid(V x) {
+  return Div(Set1<V>(1.f), Add(Set1<V>(1.f), Exp(Sub(Set1<V>(0.f), x))));
+}
+
+/*
+* tanh(x)的13/6阶有理多项式近似, |x| >= 7.9053时结果已舍入为±1
+*/
+template <typename V>
+inline V Tanh(V x) {
+  x = Min(Max(x, Set1<V>(-7.90531110763549805f)), Set1<V>(7.90531110763549805f));
+  const V x2 = Mul(x, x);
+  V p = Set1<V>(-2.76076847742355e-16f);
+  p = Fmadd(p, x2, Set1<V>(2.00018790482477e-13f));
+  p = Fmadd(p, x2, Set1<V>(-8.60467152213735e-11f));
+  p = Fmadd(p, x2, Set1<V>(5.12229709037114e-08f));
+  p = Fmadd(p, x2, Set1<V>(1.48572235717979e-05f));
+  p = Fmadd(p, x2, Set1<V>(6.37261928875436e-04f));
+  p = Fmadd(p, x2, Set1<V>(4.89352455891786e-03f));
+  p = Mul(p, x);
+
+  V q = Set1<V>(1.19825839466702e-06f);
+  q = Fmadd(q, x2, Set1<V>(1.18534705686654e-04f));
+  q = Fmadd(q, x2, Set1<V>(2.26843463243900e-03f));
+  q = Fmadd(q, x2, Set1<V>(4.89352518554385e-03f));
+  return Div(p, q);
+}
+
+/*
+* gelu(x) = x * Phi(x), Phi用erfc的Abramowitz-Stegun 7.1.26近似:
+* erfc(z) = t * poly(t) * exp(-z^2), t = 1 / (1 + p * z), z = |x| / sqrt(2)
+*/
+template <typename V>
+inline V Gelu(V x) {
+  const V z = Mul(Abs(x), Set1<V>(0.70710678118654752f));
+  const V t = Div(Set1<V>(1.f), Fmadd(z, Set1<V>(0.3275911f), Set1<V>(1.f)));
+  V poly = Set1<V>(1.061405429f);
+  poly = Fmadd(poly, t, Set1<V>(-1.453152027f));
+  poly = Fmadd(poly, t, Set1<V>(1.421413741f));
+  poly = Fmadd(poly, t, Set1<V>(-0.284496736f));
+  poly = Fmadd(poly, t, Set1<V>(0.254829592f));
+  poly = Mul(poly, t);
+  // half_erfc = 0.5 * erfc(|x| / sqrt(2)) = Phi(-|x|)
+  const V half_erfc = Mul(Mul(poly, Exp(Sub(Set1<V>(0.f), Mul(z, z)))), Set1<V>(0.5f));
+  return SelectNonNegative(x, Sub(x, Mul(x, half_erfc)), Mul(x, half_erfc));
+}
+
+template <typename V>
+inline V GeluTanh(V x) {
+  const V x3 = Mul(Mul(x, x), x);
+  const V inner = Mul(Fmadd(x3, Set1<V>(0.044715f), x), Set1<V>(0.79788456080286536f));
+  return Mul(Mul(x, Set1<V>(0.5f)), Add(Set1<V>(1.f), Tanh(inner)));
+}
+
+template <typename V>
+inline V HardSwish(V x) {
+  const V relu6 = Min(Max(Add(x, Set1<V>(3.f)), Set1<V>(0.f)), Set1<V>(6.f));
+  return Mul(x, Mul(relu6, Set1<V>(1.f / 6.f)));
+}
+
+// 每个线程一次处理的元素个数
+constexpr size_t kActivationChunk = 16384;
+
+// residual非空时先逐元素加上残差再计算激活函数, 两个输入只读一遍
+template <typename Kernel>
+void RunActivation(const float* input, const float* residual, float* output, size_t size,
+                   Kernel kernel) {
+  const size_t chunks = (size + kActivationChunk - 1) / kActivationChunk;
+#pragma omp parallel for if (chunks > 1)
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    size_t i = chunk * kActivationChunk;
+    const size_t end = std::min(size, i + kActivationChunk);
+    if (residual == nullptr) {
+#if defined(KUIPER_ACTIVATION_SIMD)
+      for (; i + kVecWidth <= end; i += kVecWidth) {
+        Store(output + i, kernel(Load(input + i, Vec())));
+      }
+#endif
+      for (; i < end; ++i) {
+        output[i] = kernel(input[i]);
+      }
+    } else {
+#if defined(KUIPER_ACTIVATION_SIMD)
+      for (; i + kVecWidth <= end; i += kVecWidth) {
+        Store(output + i, kernel(Add(Load(input + i, Vec()), Load(residual + i, Vec()))));
+      }
+#endif
+      for (; i < end; ++i) {
+        output[i] = kernel(input[i] + residual[i]);
+      }
+    }
+  }
+}
+
+template <typename Runner>
+void DispatchActivation(ActivationType type, float alpha, float beta, Runner runner) {
+  switch (type) {
+    case ActivationType::kNone: {
+      runner([](auto x) { return x; });
+      break;
+    }
+    case ActivationType::kRelu: {
+      runner([](auto x) { return Max(x, Set1<decltype(x)>(0.f)); });
+      break;
+    }
+    case ActivationType::kLeakyRelu: {
+      runner([alpha](auto x) {
+        using V = decltype(x);
+        return Fmadd(Min(x, Set1<V>(0.f)), Set1<V>(alpha), Max(x, Set1<V>(0.f)));
+      });
+      break;
+    }
+    case ActivationType::kSigmoid: {
+      runner([](auto x) { return Sigmoid(x); });
+      break;
+    }
+    case ActivationType::kTanh: {
+      runner([](auto x) { return Tanh(x); });
+      break;
+    }
+    case ActivationType::kSilu: {
+      runner([](auto x) { return Mul(x, Sigmoid(x)); });
+      break;
+    }
+    case ActivationType::kGelu: {
+      runner([](auto x) { return Gelu(x); });
+      break;
+    }
+    case ActivationType::kGeluTanh: {
+      runner([](auto x) { return GeluTanh(x); });
+      break;
+    }
+    case ActivationType::kHardSwish: {
+      runner([](auto x) { return HardSwish(x); });
+      break;
+    }
+    case ActivationType::kClip: {
+      runner([alpha, beta](auto x) {
+        using V = decltype(x);
+        return Min(Max(x, Set1<V>(alpha)), Set1<V>(beta));
+      });
+      break;
+    }
+    default: {
+      LOG(FATAL) << "Unknown activation type: " << int32_t(type);
+    }
+  }
+}
+}  // namespace
+
+void ActivationForward(ActivationType type, const float* input, float* output, size_t size,
+                       float alpha, float beta) {
+  CHECK(input != nullptr && output != nullptr);
+  if (type == ActivationType::kNone) {
+    if (input != output) {
+      std::memcpy(output, input, size * sizeof(float));
+    }
+    return;
+  }
+  DispatchActivation(type, alpha, beta, [&](auto kernel) {
+    RunActivation(input, nullptr, output, size, kernel);
+  });
+}
+
+void ResidualActivationForward(ActivationType type, const float* input, const float* residual,
+                               float* output, size_t size, float alpha, float beta) {
+  CHECK(input != nullptr && residual != nullptr && output != nullptr);
+  DispatchActivation(type, alpha, beta, [&](auto kernel) {
+    RunActivation(input, residual, output, size, kernel);
+  });
+}
+
+void ActivationForward(ActivationType type, const std::shared_ptr<Tensor<float>>& input,
+                       const std::shared_ptr<Tensor<float>>& output, float alpha, float beta) {
+  CHECK(input != nullptr && output != nullptr);
+  CHECK(input->shapes() == output->shapes() && input->layout() == output->layout())
+      << "The input and output of an activation must have the same shape and layout";
+  if (input->empty()) {
+    return;
+  }
+  ActivationForward(type, input->raw_ptr(), output->raw_ptr(), input->size(), alpha, beta);
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,283 @@
+#include "data/allocator.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+namespace kuiper_infer {
+
+static constexpr int32_t kNumSizeClasses = 89;
+
+double TensorAllocatorStats::hit_rate() const {
+  if (allocations == 0) {
+    return 0.;
+  }
+  return double(pool_hits) / double(allocations);
+}
+
+namespace {
+/*
+* @brief 一个线程在一个内存池中的缓存
+*
+* 同时登记在内存池中, 内存池清空或销毁时可以在其他线程中释放它缓存的内存.
+* 只有所属线程和内存池会加锁, 锁几乎没有竞争
+*/
+struct ThreadCache {
+  std::mutex mutex;
+  std::vector<std::vector<void*>> free_lists = std::vector<std::vector<void*>>(kNumSizeClasses);
+
+  /// Bytes of all cached blocks
+  size_t bytes = 0;
+
+  /*
+  * @brief 释放缓存的所有内存, 调用者持有mutex
+  * @return 释放的字节数
+  */
+  size_t Free() {
+    for (auto& free_list : free_lists) {
+      for (void* ptr : free_list) {
+        std::free(ptr);
+      }
+      free_list.clear();
+    }
+    const size_t freed = bytes;
+    bytes = 0;
+    return freed;
+  }
+};
+}  // namespace
+
+struct PooledTensorAllocator::PoolState {
+  std::mutex mutex;
+  std::vector<std::vector<void*>> free_lists = std::vector<std::vector<void*>>(kNumSizeClasses);
+
+  /// Caches of the threads that used the pool, guarded by mutex
+  std::vector<std::shared_ptr<ThreadCache>> thread_caches;
+
+  std::atomic<size_t> bytes_in_use{0};
+  std::atomic<size_t> bytes_cached{0};
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> pool_hits{0};
+
+  ~PoolState() {
+    for (auto& free_list : free_lists) {
+      for (void* ptr : free_list) {
+        std::free(ptr);
+      }
+    }
+    for (const auto& cache : thread_caches) {
+      std::lock_guard<std::mutex> lock(cache->mutex);
+      cache->Free();
+    }
+  }
+};
+
+namespace {
+struct ThreadCacheEntry {
+  /// Does not keep the pool alive, a replaced allocator is freed with its last tensor
+  std::weak_ptr<PooledTensorAllocator::PoolState> state;
+  std::shared_ptr<ThreadCache> cache;
+};
+
+/*
+* @brief 线程的所有缓存, 线程退出时归还到仍然存在的内存池
+*/
+struct ThreadCaches {
+  std::unordered_map<const PooledTensorAllocator::PoolState*, ThreadCacheEntry> caches;
+  ~ThreadCaches();
+};
+
+// 线程退出时的析构顺序不确定, 缓存析构后的请求直接走全局池
+thread_local bool thread_caches_destroyed = false;
+
+ThreadCaches::~ThreadCaches() {
+  thread_caches_destroyed = true;
+  for (auto& [_, entry] : caches) {
+    const std::shared_ptr<PooledTensorAllocator::PoolState> state = entry.state.lock();
+    if (!state) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    {
+      std::lock_guard<std::mutex> cache_lock(entry.cache->mutex);
+      for (int32_t i = 0; i < kNumSizeClasses; ++i) {
+        auto& global_list = state->free_lists.at(i);
+        auto& local_list = entry.cache->free_lists.at(i);
+        global_list.insert(global_list.end(), local_list.begin(), local_list.end());
+        local_list.clear();
+      }
+      entry.cache->bytes = 0;
+    }
+    auto& thread_caches = state->thread_caches;
+    thread_caches.erase(std::find(thread_caches.begin(), thread_caches.end(), entry.cache));
+  }
+}
+
+ThreadCache* GetThreadCache(const std::shared_ptr<PooledTensorAllocator::PoolState>& state) {
+  if (thread_caches_destroyed) {
+    return nullptr;
+  }
+  thread_local ThreadCaches thread_caches;
+  auto& caches = thread_caches.caches;
+  const auto iter = caches.find(state.get());
+  if (iter != caches.end() && !iter->second.state.expired()) {
+    return iter->second.cache.get();
+  }
+
+  // 新的内存池, 或者同一地址上的旧内存池已经销毁, 顺便清理已销毁内存池的缓存
+  std::erase_if(caches, [](const auto& item) { return item.second.state.expired(); });
+  std::shared_ptr<ThreadCache> cache = std::make_shared<ThreadCache>();
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->thread_caches.push_back(cache);
+  }
+  caches[state.get()] = ThreadCacheEntry{state, cache};
+  return cache.get();
+}
+
+size_t SizeClassBytes(int32_t size_class) {
+  if (size_class == 0) {
+    return kTensorAlignment;
+  }
+  const int32_t power = (size_class - 1) / 4 + 6;
+  const size_t sub = (size_class - 1) % 4 + 1;
+  return (size_t(1) << power) + sub * ((size_t(1) << power) / 4);
+}
+}  // namespace
+
+PooledTensorAllocator::PooledTensorAllocator() : state_(std::make_shared<PoolState>()) {}
+
+int32_t PooledTensorAllocator::SizeClass(size_t bytes, size_t* class_bytes) {
+  CHECK(class_bytes != nullptr);
+  if (bytes <= kTensorAlignment) {
+    *class_bytes = kTensorAlignment;
+    return 0;
+  }
+  if (bytes > kMaxPooledBytes) {
+    *class_bytes = (bytes + kTensorAlignment - 1) / kTensorAlignment * kTensorAlignment;
+    return -1;
+  }
+  // base < bytes <= 2 * base, 区间按base / 4分为4级
+  const int32_t power = 63 - __builtin_clzll(bytes - 1);
+  const size_t base = size_t(1) << power;
+  const size_t step = base / 4;
+  const size_t sub = (bytes - base + step - 1) / step;
+  *class_bytes = base + sub * step;
+  return (power - 6) * 4 + int32_t(sub);
+}
+
+void* PooledTensorAllocator::Allocate(size_t bytes) {
+  size_t class_bytes = 0;
+  const int32_t size_class = SizeClass(bytes, &class_bytes);
+  state_->allocations.fetch_add(1, std::memory_order_relaxed);
+  state_->bytes_in_use.fetch_add(class_bytes, std::memory_order_relaxed);
+
+  if (size_class >= 0) {
+    ThreadCache* cache = GetThreadCache(state_);
+    void* ptr = nullptr;
+    if (cache != nullptr) {
+      std::lock_guard<std::mutex> lock(cache->mutex);
+      auto& local_list = cache->free_lists.at(size_class);
+      if (!local_list.empty()) {
+        ptr = local_list.back();
+        local_list.pop_back();
+        cache->bytes -= class_bytes;
+      }
+    }
+    if (ptr == nullptr) {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      auto& global_list = state_->free_lists.at(size_class);
+      if (!global_list.empty()) {
+        ptr = global_list.back();
+        global_list.pop_back();
+      }
+    }
+    if (ptr != nullptr) {
+      state_->pool_hits.fetch_add(1, std::memory_order_relaxed);
+      state_->bytes_cached.fetch_sub(class_bytes, std::memory_order_relaxed);
+      return ptr;
+    }
+  }
+
+  // aligned_alloc要求大小是对齐的整数倍, 80字节这样的级别向上补齐
+  const size_t aligned_bytes =
+      (class_bytes + kTensorAlignment - 1) / kTensorAlignment * kTensorAlignment;
+  void* ptr = std::aligned_alloc(kTensorAlignment, aligned_bytes);
+  CHECK(ptr != nullptr) << "Allocate tensor storage failed, bytes: " << class_bytes;
+  return ptr;
+}
+
+void PooledTensorAllocator::Release(void* ptr, size_t bytes) {
+  if (ptr == nullptr) {
+    return;
+  }
+  size_t class_bytes = 0;
+  const int32_t size_class = SizeClass(bytes, &class_bytes);
+  state_->bytes_in_use.fetch_sub(class_bytes, std::memory_order_relaxed);
+  if (size_class < 0) {
+    std::free(ptr);
+    return;
+  }
+
+  state_->bytes_cached.fetch_add(class_bytes, std::memory_order_relaxed);
+  ThreadCache* cache = GetThreadCache(state_);
+  if (cache != nullptr) {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    if (cache->bytes + class_bytes <= kThreadCacheBytes) {
+      cache->free_lists.at(size_class).push_back(ptr);
+      cache->bytes += class_bytes;
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->free_lists.at(size_class).push_back(ptr);
+}
+
+TensorAllocatorStats PooledTensorAllocator::stats() const {
+  TensorAllocatorStats stats;
+  stats.bytes_in_use = state_->bytes_in_use.load(std::memory_order_relaxed);
+  stats.bytes_cached = state_->bytes_cached.load(std::memory_order_relaxed);
+  stats.allocations = state_->allocations.load(std::memory_order_relaxed);
+  stats.pool_hits = state_->pool_hits.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void PooledTensorAllocator::ReleaseCached() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  for (int32_t i = 0; i < kNumSizeClasses; ++i) {
+    auto& free_list = state_->free_lists.at(i);
+    if (free_list.empty()) {
+      continue;
+    }
+    for (void* ptr : free_list) {
+      std::free(ptr);
+    }
+    state_->bytes_cached.fetch_sub(SizeClassBytes(i) * free_list.size(), std::memory_order_relaxed);
+    free_list.clear();
+  }
+  for (const auto& cache : state_->thread_caches) {
+    std::lock_guard<std::mutex> cache_lock(cache->mutex);
+    state_->bytes_cached.fetch_sub(cache->Free(), std::memory_order_relaxed);
+  }
+}
+
+static std::atomic<std::shared_ptr<TensorAllocator>>& AllocatorInstance() {
+  static std::atomic<std::shared_ptr<TensorAllocator>> allocator_instance{
+      std::make_shared<PooledTensorAllocator>()};
+  return allocator_instance;
+}
+
+std::shared_ptr<TensorAllocator> GetTensorAllocator() {
+  return AllocatorInstance().load(std::memory_order_acquire);
+}
+
+void SetTensorAllocator(std::shared_ptr<TensorAllocator> allocator) {
+  if (!allocator) {
+    allocator = std::make_shared<PooledTensorAllocator>();
+  }
+  AllocatorInstance().store(std::move(allocator), std::memory_order_release);
+}
+
+}  // namespace kuiper_infer
@@ -1,5 +1,6 @@
 #include "data/tensor.h"
 #include <omp.h>
+#include "data/tensor_layout.h"
 
 namespace kuiper_infer {
 
@@ -54,7 +55,7 @@ namespace kuiper_infer {
 
     template<typename T>
     Tensor<T>::Tensor(uint32_t channels, uint32_t rows, uint32_t cols) {
-        data_ = arma::Cube<T>(rows, cols, channels);
+        this->allocate(channels, rows, cols);
         if (channels == 1 && rows == 1) {
             raw_shapes_ = std::vector<uint32_t>{cols};
         } else if (channels == 1) {
@@ -67,13 +68,13 @@ namespace kuiper_infer {
     template<typename T>
     Tensor<T>::Tensor(uint32_t size) {
         raw_shapes_ = {size};
-        data_ = arma::Cube<T>(1, size, 1);
+        this->allocate(1, 1, size);
     }
 
     template<typename T>
     Tensor<T>::Tensor(uint32_t rows, uint32_t cols) {
         raw_shapes_ = {rows, cols};
-        data_ = arma::Cube<T>(rows, cols, 1);
+        this->allocate(1, rows, cols);
     }
 
     template<typename T>
@@ -85,7 +86,7 @@ namespace kuiper_infer {
         uint32_t channels = shapes_.at(0);
         uint32_t rows = shapes_.at(1);
         uint32_t cols = shapes_.at(2);
-        data_ = arma::Cube<T>(channels, rows, cols);
+        this->allocate(channels, rows, cols);
         if (channels == 1 && rows == 1) {
             this->raw_shapes_ = std::vector<uint32_t>{cols};
         } else if (channels == 1) {
@@ -95,6 +96,93 @@ namespace kuiper_infer {
         }
     }
 
+    template<typename T>
+    Tensor<T>::Tensor(uint32_t channels, uint32_t rows, uint32_t cols, TensorLayout layout)
+        : layout_(layout) {
+        this->allocate(channels, rows, cols);
+        if (channels == 1 && rows == 1) {
+            raw_shapes_ = std::vector<uint32_t>{cols};
+        } else if (channels == 1) {
+            raw_shapes_ = std::vector<uint32_t>{rows, cols};
+        } else {
+            raw_shapes_ = std::vector<uint32_t>{channels, rows, cols};
+        }
+    }
+
+    template<typename T>
+    Tensor<T>::Tensor(T* raw_ptr, const std::vector<uint32_t>& shapes, TensorLayout layout)
+        : layout_(layout) {
+        CHECK_NE(raw_ptr, nullptr);
+        CHECK_EQ(shapes.size(), 3);
+        const uint32_t channels = shapes.at(0);
+        const uint32_t rows = shapes.at(1);
+        const uint32_t cols = shapes.at(2);
+
+        if (channels == 1 && rows == 1) {
+            raw_shapes_ = std::vector<uint32_t>{cols};
+        } else if (channels == 1) {
+            raw_shapes_ = std::vector<uint32_t>{rows, cols};
+        } else {
+            raw_shapes_ = std::vector<uint32_t>{channels, rows, cols};
+        }
+
+        const uint32_t block_size = TensorLayoutBlockSize(layout);
+        if (block_size > 1) {
+            this->blocked_channels_ = channels;
+            this->data_ = arma::Cube<T>(raw_ptr, block_size * cols, rows,
+                                        (channels + block_size - 1) / block_size, false, true);
+        } else if (layout == TensorLayout::kRowMajor) {
+            this->data_ = arma::Cube<T>(raw_ptr, cols, rows, channels, false, true);
+        } else {
+            this->data_ = arma::Cube<T>(raw_ptr, rows, cols, channels, false, true);
+        }
+    }
+
+    template<typename T>
+    Tensor<T>::Tensor(const Tensor& tensor)
+        : layout_(tensor.layout_), raw_shapes_(tensor.raw_shapes_) {
+        this->allocate(tensor.channels(), tensor.rows(), tensor.cols());
+        if (!tensor.empty()) {
+            std::copy(tensor.data_.memptr(), tensor.data_.memptr() + tensor.size(),
+                      this->data_.memptr());
+        }
+    }
+
+    template<typename T>
+    Tensor<T>& Tensor<T>::operator=(const Tensor& tensor) {
+        if (this != &tensor) {
+            Tensor<T> copied(tensor);
+            *this = std::move(copied);
+        }
+        return *this;
+    }
+
+    template<typename T>
+    void Tensor<T>::allocate(uint32_t channels, uint32_t rows, uint32_t cols) {
+        const uint32_t block_size = TensorLayoutBlockSize(this->layout_);
+        this->blocked_channels_ = block_size > 1 ? channels : 0;
+        // 分块布局按块补齐通道
+        const uint32_t stored_channels = (channels + block_size - 1) / block_size * block_size;
+        const size_t size = size_t(stored_channels) * rows * cols;
+        if (size == 0) {
+            this->storage_.reset();
+            this->data_ = arma::Cube<T>(rows, cols, channels);
+            return;
+        }
+        // 池中的内存可能是脏的, 与arma一致地清零, 分块布局补齐的通道也保持为零
+        shared_ptr<T> storage = AllocateTensorStorage<T>(size);
+        std::fill(storage.get(), storage.get() + size, T(0));
+        if (block_size > 1) {
+            this->data_ = arma::Cube<T>(storage.get(), block_size * cols, rows,
+                                        stored_channels / block_size, false, false);
+        } else if (this->layout_ == TensorLayout::kRowMajor) {
+            this->data_ = arma::Cube<T>(storage.get(), cols, rows, channels, false, false);
+        } else {
+            this->data_ = arma::Cube<T>(storage.get(), rows, cols, channels, false, false);
+        }
+        this->storage_ = std::move(storage);
+    }
+
     template<typename T>
     uint32_t Tensor<T>::size() const {
         return this->data_.size();
@@ -102,22 +190,80 @@ namespace kuiper_infer {
 
     template<typename T>
     uint32_t Tensor<T>::rows() const {
+        if (this->layout_ != TensorLayout::kColMajor) {
+            return this->data_.n_cols;
+        }
         return this->data_.n_rows;
     }
 
     template<typename T>
     uint32_t Tensor<T>::cols() const {
+        if (this->layout_ == TensorLayout::kRowMajor) {
+            return this->data_.n_rows;
+        }
+        if (this->layout_ != TensorLayout::kColMajor) {
+            return this->data_.n_rows / TensorLayoutBlockSize(this->layout_);
+        }
         return this->data_.n_cols;
     }
 
     template<typename T>
     uint32_t Tensor<T>::channels() const {
+        if (TensorLayoutBlockSize(this->layout_) > 1 && !this->data_.empty()) {
+            return this->blocked_channels_;
+        }
         return this->data_.n_slices;
     }
 
+    template<typename T>
+    uint32_t Tensor<T>::block_size() const {
+        return TensorLayoutBlockSize(this->layout_);
+    }
+
+
+    template<typename T>
+    TensorLayout Tensor<T>::layout() const {
+        return this->layout_;
+    }
+
+    template<typename T>
+    void Tensor<T>::convert_layout(TensorLayout layout) {
+        if (this->layout_ == layout || this->data_.empty()) {
+            this->layout_ = layout;
+            return;
+        }
+        const uint32_t channels = this->channels();
+        const uint32_t rows = this->rows();
+        const uint32_t cols = this->cols();
+        Tensor<T> converted(channels, rows, cols, layout);
+        TensorReorder(*this, converted);
+
+        if (this->storage_) {
+            this->storage_ = std::move(converted.storage_);
+            this->data_ = std::move(converted.data_);
+        } else {
+            // 视图张量在原内存中转换
+            CHECK_EQ(converted.size(), this->size())
+                << "A view tensor can not change the size of its storage";
+            this->data_.reshape(converted.data_.n_rows, converted.data_.n_cols,
+                                converted.data_.n_slices);
+            this->data_ = converted.data_;
+        }
+        this->layout_ = layout;
+        this->blocked_channels_ = converted.blocked_channels_;
+    }
 
     template<typename T>
     void Tensor<T>::set_data(const arma::Cube<T>& data) {
+        CHECK_EQ(this->block_size(), 1) << "Can not set the data of a channel-blocked tensor";
+        if (data.n_rows != this->data_.n_rows || data.n_cols != this->data_.n_cols ||
+            data.n_slices != this->data_.n_slices) {
+            if (this->layout_ == TensorLayout::kRowMajor) {
+                this->allocate(data.n_slices, data.n_cols, data.n_rows);
+            } else {
+                this->allocate(data.n_slices, data.n_rows, data.n_cols);
+            }
+        }
         this->data_ = data;
     }
 
@@ -165,11 +311,27 @@ namespace kuiper_infer {
 
     template<typename T>
     const T Tensor<T>::at(uint32_t channel, uint32_t row, uint32_t col) const {
+        const uint32_t block_size = TensorLayoutBlockSize(this->layout_);
+        if (block_size > 1) {
+            return this->data_.at(col * block_size + channel % block_size, row,
+                                  channel / block_size);
+        }
+        if (this->layout_ == TensorLayout::kRowMajor) {
+            return this->data_.at(col, row, channel);
+        }
         return this->data_.at(row, col, channel);
     }
 
     template<typename T>
     T& Tensor<T>::at(uint32_t channel, uint32_t row, uint32_t col) {
+        const uint32_t block_size = TensorLayoutBlockSize(this->layout_);
+        if (block_size > 1) {
+            return this->data_.at(col * block_size + channel % block_size, row,
+                                  channel / block_size);
+        }
+        if (this->layout_ == TensorLayout::kRowMajor) {
+            return this->data_.at(col, row, channel);
+        }
         return this->data_.at(row, col, channel);
     }
 
@@ -179,12 +341,19 @@ namespace kuiper_infer {
         uint32_t pad_row2 = pads.at(1);  // bottom
         uint32_t pad_col1 = pads.at(2);  // left
         uint32_t pad_col2 = pads.at(3);  // right
+        CHECK_EQ(this->block_size(), 1) << "Can not pad a channel-blocked tensor";
+        if (this->layout_ == TensorLayout::kRowMajor) {
+            // 行主序布局下存储的行对应张量的列
+            std::swap(pad_row1, pad_col1);
+            std::swap(pad_row2, pad_col2);
+        }
 
-        arma::Cube<T> new_data(
+        Tensor<T> padded(
+            this->data_.n_slices,
             this->data_.n_rows + pad_row1 + pad_row2,
-            this->data_.n_cols + pad_col1 + pad_col2,
-            this->data_.n_slices
+            this->data_.n_cols + pad_col1 + pad_col2
         );
+        arma::Cube<T>& new_data = padded.data_;
 
         new_data.fill(padding_value);
         new_data.subcube(
@@ -195,7 +364,8 @@ namespace kuiper_infer {
             new_data.n_cols - pad_col2 - 1,
             new_data.n_slices - 1
         ) = this->data_;
-        this->data_ = move(new_data);
+        this->storage_ = std::move(padded.storage_);
+        this->data_ = std::move(new_data);
         this->raw_shapes_ = {
             this->channels(),
             this->rows(),
@@ -211,9 +381,19 @@ namespace kuiper_infer {
     template<typename T>
     void Tensor<T>::fill(const std::vector<T>& values, bool row_major) {
        CHECK(!this->data_.empty()) << "The data area of the tensor is empty.";
+        if (this->block_size() > 1) {
+            // 先填充到普通布局再重排
+            Tensor<T> plain(this->channels(), this->rows(), this->cols());
+            plain.fill(values, row_major);
+            TensorReorder(plain, *this);
+            return;
+        }
         const uint32_t total_elems = this->data_.size();
         CHECK_EQ(values.size(), total_elems);
-        if (row_major) {
+        if (row_major == (this->layout_ == TensorLayout::kRowMajor)) {
+            // 数据顺序与存储一致, 直接拷贝
+            std::copy(values.begin(), values.end(), this->data_.memptr());
+        } else if (row_major) {
             const uint32_t rows = this->rows();
             const uint32_t cols = this->cols();
             const uint32_t planes = rows * cols;
@@ -225,7 +405,12 @@ namespace kuiper_infer {
             this->data_.slice(i) = channel_data_t.t();
             }
         } else {
-            std::copy(values.begin(), values.end(), this->data_.memptr());
+            const uint32_t planes = this->rows() * this->cols();
+            for (uint32_t i = 0; i < this->channels(); ++i) {
+                arma::Mat<T> channel_data(const_cast<T*>(values.data()) + i * planes, this->rows(),
+                                          this->cols(), false, true);
+                this->data_.slice(i) = channel_data.t();
+            }
         }
     }
     
@@ -259,16 +444,21 @@ namespace kuiper_infer {
         }
     }
 
-    template<typename T>
-    void Tensor<T>::transform(const function<T(const T&)> &op) {
-        this->data_.transform(op);
-    }
-
     template<typename T>
     void Tensor<T>::show() const {
+        if (this->block_size() > 1) {
+            Tensor<T> plain(this->channels(), this->rows(), this->cols());
+            TensorReorder(*this, plain);
+            plain.show();
+            return;
+        }
         for (uint32_t i = 0; i < this->data_.n_slices; ++i) {
             LOG(INFO) << "Channel: " << i << endl;
-            LOG(INFO) << this->data_.slice(i) << endl;
+            if (this->layout_ == TensorLayout::kRowMajor) {
+                LOG(INFO) << this->data_.slice(i).t() << endl;
+            } else {
+                LOG(INFO) << this->data_.slice(i) << endl;
+            }
         }
     }
 
@@ -284,11 +474,19 @@ namespace kuiper_infer {
     void Tensor<T>::reshape(const std::vector<uint32_t>& shapes, bool row_major) {
         CHECK(!this->data_.empty()) << "The data area of the tensor is empty.";
         CHECK(!shapes.empty());
+        CHECK_EQ(this->block_size(), 1) << "Can not reshape a channel-blocked tensor";
         const size_t origin_size = this->size();
         const size_t current_size =
             std::accumulate(shapes.begin(), shapes.end(), size_t(1), std::multiplies<size_t>());
         CHECK(shapes.size() <= 3);
         CHECK(current_size == origin_size);
+        if (!row_major && this->layout_ == TensorLayout::kRowMajor) {
+            // 按列主序的语义重排
+            this->convert_layout(TensorLayout::kColMajor);
+            this->reshape(shapes, false);
+            this->convert_layout(TensorLayout::kRowMajor);
+            return;
+        }
         if (!row_major) {
             if (shapes.size() == 3) {
                 this->data_.reshape(shapes.at(1), shapes.at(2), shapes.at(0));
@@ -322,6 +520,12 @@ namespace kuiper_infer {
     }
     
 
+    template<typename T>
+    T* Tensor<T>::raw_ptr() {
+        CHECK(!this->data_.empty()) << "The data area of the tensor is empty.";
+        return this->data_.memptr();
+    }
+
     template<typename T>
     T* Tensor<T>::raw_ptr(size_t offset) {
         return this->data_.memptr() + offset;
@@ -329,6 +533,7 @@ namespace kuiper_infer {
 
     template <typename T>
     T* Tensor<T>::matrix_raw_ptr(uint32_t index) {
+        CHECK_EQ(this->block_size(), 1) << "A channel-blocked tensor has no channel planes";
         CHECK_LT(index, this->channels());
         size_t offset = index * this->plane_size();
         CHECK_LE(offset, this->size());
@@ -359,6 +564,7 @@ namespace kuiper_infer {
 
     template <typename T>
     const T* Tensor<T>::matrix_raw_ptr(uint32_t index) const {
+        CHECK_EQ(this->block_size(), 1) << "A channel-blocked tensor has no channel planes";
         CHECK_LT(index, this->channels());
         size_t offset = index * this->plane_size();
         CHECK_LE(offset, this->size());
@@ -370,12 +576,19 @@ namespace kuiper_infer {
     void Tensor<T>::review(const std::vector<uint32_t>& shapes) {
         CHECK(!this->data_.empty()) << "The data area of the tensor is empty.";
         CHECK_EQ(shapes.size(), 3);
+        CHECK_EQ(this->block_size(), 1) << "Can not review a channel-blocked tensor";
         const uint32_t target_ch = shapes.at(0);
         const uint32_t target_rows = shapes.at(1);
         const uint32_t target_cols = shapes.at(2);
 
         CHECK_EQ(this->data_.size(), target_ch * target_cols * target_rows);
-        arma::Cube<T> new_data(target_rows, target_cols, target_ch);
+        if (this->layout_ == TensorLayout::kRowMajor) {
+            // 行主序存储下按行重排不需要移动数据
+            this->data_.reshape(target_cols, target_rows, target_ch);
+            return;
+        }
+        Tensor<T> reviewed(target_ch, target_rows, target_cols);
+        arma::Cube<T>& new_data = reviewed.data_;
         const uint32_t plane_size = target_rows * target_cols;
         #pragma omp parallel for
         for (uint32_t channel = 0; channel < this->data_.n_slices; ++channel) {
@@ -392,7 +605,13 @@ namespace kuiper_infer {
                 }
             }
         }
-        this->data_ = std::move(new_data);
+        if (this->storage_) {
+            this->storage_ = std::move(reviewed.storage_);
+            this->data_ = std::move(new_data);
+        } else {
+            // 视图张量(如激活内存池中的输出)保持指向原内存
+            this->data_ = new_data;
+        }
     }
 
     template class Tensor<float>;
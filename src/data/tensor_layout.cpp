@@ -0,0 +1,212 @@
+#include "data/tensor_layout.h"
+#include <glog/logging.h>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+
+// 一次转置的通道数, 16通道的块按两组处理
+static constexpr uint32_t kChannelGroup = 8;
+
+/*
+* @brief 8x8转置
+*
+* 第i行从src + i * src_stride读取8个连续元素, 转置后第j行写到dst + j * dst_stride
+*/
+static inline void Transpose8x8(const float* src, size_t src_stride, float* dst,
+                                size_t dst_stride) {
+#if defined(__AVX2__)
+  __m256 r0 = _mm256_loadu_ps(src);
+  __m256 r1 = _mm256_loadu_ps(src + src_stride);
+  __m256 r2 = _mm256_loadu_ps(src + 2 * src_stride);
+  __m256 r3 = _mm256_loadu_ps(src + 3 * src_stride);
+  __m256 r4 = _mm256_loadu_ps(src + 4 * src_stride);
+  __m256 r5 = _mm256_loadu_ps(src + 5 * src_stride);
+  __m256 r6 = _mm256_loadu_ps(src + 6 * src_stride);
+  __m256 r7 = _mm256_loadu_ps(src + 7 * src_stride);
+
+  const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+  const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+  const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+  const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+  const __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+  const __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+  const __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+  const __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+  const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+  _mm256_storeu_ps(dst, _mm256_permute2f128_ps(s0, s4, 0x20));
+  _mm256_storeu_ps(dst + dst_stride, _mm256_permute2f128_ps(s1, s5, 0x20));
+  _mm256_storeu_ps(dst + 2 * dst_stride, _mm256_permute2f128_ps(s2, s6, 0x20));
+  _mm256_storeu_ps(dst + 3 * dst_stride, _mm256_permute2f128_ps(s3, s7, 0x20));
+  _mm256_storeu_ps(dst + 4 * dst_stride, _mm256_permute2f128_ps(s0, s4, 0x31));
+  _mm256_storeu_ps(dst + 5 * dst_stride, _mm256_permute2f128_ps(s1, s5, 0x31));
+  _mm256_storeu_ps(dst + 6 * dst_stride, _mm256_permute2f128_ps(s2, s6, 0x31));
+  _mm256_storeu_ps(dst + 7 * dst_stride, _mm256_permute2f128_ps(s3, s7, 0x31));
+#else
+  for (uint32_t i = 0; i < 8; ++i) {
+    for (uint32_t j = 0; j < 8; ++j) {
+      dst[j * dst_stride + i] = src[i * src_stride + j];
+    }
+  }
+#endif
+}
+
+/*
+* @brief 分块布局中像素的步长
+*
+* 源平面按存储顺序分为outer个长度为inner的连续段, 第o段第i个像素在分块布局中的偏移为
+* o * outer_stride + i * inner_stride
+*/
+struct BlockedStrides {
+  uint32_t outer = 0;
+  uint32_t inner = 0;
+  size_t outer_stride = 0;
+  size_t inner_stride = 0;
+};
+
+static BlockedStrides GetBlockedStrides(TensorLayout plain_layout, uint32_t rows, uint32_t cols,
+                                        uint32_t block_size) {
+  CHECK(plain_layout == TensorLayout::kColMajor || plain_layout == TensorLayout::kRowMajor)
+      << "Only the column-major and row-major layouts can be reordered to blocked";
+  CHECK(block_size == 8 || block_size == 16) << "Unsupported channel block size: " << block_size;
+  BlockedStrides strides;
+  if (plain_layout == TensorLayout::kRowMajor) {
+    strides.outer = rows;
+    strides.inner = cols;
+    strides.outer_stride = size_t(cols) * block_size;
+    strides.inner_stride = block_size;
+  } else {
+    strides.outer = cols;
+    strides.inner = rows;
+    strides.outer_stride = block_size;
+    strides.inner_stride = size_t(cols) * block_size;
+  }
+  return strides;
+}
+
+TensorLayout DefaultBlockedLayout() {
+#if defined(__AVX512F__)
+  return TensorLayout::kNCHW16c;
+#else
+  return TensorLayout::kNCHW8c;
+#endif
+}
+
+void ReorderToBlocked(const float* src, TensorLayout src_layout, uint32_t channels, uint32_t rows,
+                      uint32_t cols, float* dst, uint32_t block_size) {
+  CHECK(src != nullptr && dst != nullptr);
+  const BlockedStrides strides = GetBlockedStrides(src_layout, rows, cols, block_size);
+  const size_t plane_size = size_t(rows) * cols;
+  const uint32_t channel_blocks = (channels + block_size - 1) / block_size;
+
+#pragma omp parallel for
+  for (uint32_t cb = 0; cb < channel_blocks; ++cb) {
+    float* dst_block = dst + cb * plane_size * block_size;
+    for (uint32_t g = 0; g < block_size; g += kChannelGroup) {
+      const uint32_t c0 = cb * block_size + g;
+      const uint32_t group = c0 < channels ? std::min(kChannelGroup, channels - c0) : 0;
+      const float* src_group = src + c0 * plane_size;
+      for (uint32_t o = 0; o < strides.outer; ++o) {
+        const size_t src_offset = size_t(o) * strides.inner;
+        float* dst_row = dst_block + o * strides.outer_stride + g;
+        uint32_t i = 0;
+        if (group == kChannelGroup) {
+          for (; i + 8 <= strides.inner; i += 8) {
+            Transpose8x8(src_group + src_offset + i, plane_size, dst_row + i * strides.inner_stride,
+                         strides.inner_stride);
+          }
+        }
+        for (; i < strides.inner; ++i) {
+          float* dst_pixel = dst_row + i * strides.inner_stride;
+          for (uint32_t k = 0; k < kChannelGroup; ++k) {
+            dst_pixel[k] = k < group ? src_group[k * plane_size + src_offset + i] : 0.f;
+          }
+        }
+      }
+    }
+  }
+}
+
+void ReorderFromBlocked(const float* src, uint32_t block_size, uint32_t channels, uint32_t rows,
+                        uint32_t cols, float* dst, TensorLayout dst_layout) {
+  CHECK(src != nullptr && dst != nullptr);
+  const BlockedStrides strides = GetBlockedStrides(dst_layout, rows, cols, block_size);
+  const size_t plane_size = size_t(rows) * cols;
+  const uint32_t channel_blocks = (channels + block_size - 1) / block_size;
+
+#pragma omp parallel for
+  for (uint32_t cb = 0; cb < channel_blocks; ++cb) {
+    const float* src_block = src + cb * plane_size * block_size;
+    for (uint32_t g = 0; g < block_size; g += kChannelGroup) {
+      const uint32_t c0 = cb * block_size + g;
+      if (c0 >= channels) {
+        break;
+      }
+      const uint32_t group = std::min(kChannelGroup, channels - c0);
+      float* dst_group = dst + c0 * plane_size;
+      for (uint32_t o = 0; o < strides.outer; ++o) {
+        const size_t dst_offset = size_t(o) * strides.inner;
+        const float* src_row = src_block + o * strides.outer_stride + g;
+        uint32_t i = 0;
+        if (group == kChannelGroup) {
+          for (; i + 8 <= strides.inner; i += 8) {
+            Transpose8x8(src_row + i * strides.inner_stride, strides.inner_stride,
+                         dst_group + dst_offset + i, plane_size);
+          }
+        }
+        for (; i < strides.inner; ++i) {
+          const float* src_pixel = src_row + i * strides.inner_stride;
+          for (uint32_t k = 0; k < group; ++k) {
+            dst_group[k * plane_size + dst_offset + i] = src_pixel[k];
+          }
+        }
+      }
+    }
+  }
+}
+
+void TensorReorder(const Tensor<float>& src, Tensor<float>& dst) {
+  CHECK(src.shapes() == dst.shapes()) << "Reorder needs tensors of the same shape";
+  if (src.empty()) {
+    return;
+  }
+  const TensorLayout src_layout = src.layout();
+  const TensorLayout dst_layout = dst.layout();
+  if (src_layout == dst_layout) {
+    std::copy(src.raw_ptr(), src.raw_ptr() + src.size(), dst.raw_ptr());
+    return;
+  }
+
+  const uint32_t src_block_size = src.block_size();
+  const uint32_t dst_block_size = dst.block_size();
+  if (src_block_size == 1 && dst_block_size == 1) {
+    // 行主序与列主序之间逐通道转置
+    for (uint32_t c = 0; c < src.channels(); ++c) {
+      dst.slice(c) = src.slice(c).t();
+    }
+  } else if (src_block_size == 1) {
+    ReorderToBlocked(src.raw_ptr(), src_layout, src.channels(), src.rows(), src.cols(),
+                     dst.raw_ptr(), dst_block_size);
+  } else if (dst_block_size == 1) {
+    ReorderFromBlocked(src.raw_ptr(), src_block_size, src.channels(), src.rows(), src.cols(),
+                       dst.raw_ptr(), dst_layout);
+  } else {
+    // 不同块大小之间经由列主序中转
+    Tensor<float> plain(src.channels(), src.rows(), src.cols());
+    TensorReorder(src, plain);
+    TensorReorder(plain, dst);
+  }
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,200 @@
+#include "layer/activation.h"
+#include <glog/logging.h>
+#include <limits>
+#include "data/tensor_util.h"
+#include "layer/layer_factory.h"
+
+namespace kuiper_infer {
+
+namespace {
+typedef std::map<std::string, std::shared_ptr<RuntimeParameter>> ParameterMap;
+
+const std::map<std::string, ActivationType>& ActivationOperators() {
+  static const std::map<std::string, ActivationType> operators = {
+      {"F.relu", ActivationType::kRelu},           {"nn.ReLU", ActivationType::kRelu},
+      {"F.relu6", ActivationType::kClip},          {"nn.ReLU6", ActivationType::kClip},
+      {"F.leaky_relu", ActivationType::kLeakyRelu}, {"nn.LeakyReLU", ActivationType::kLeakyRelu},
+      {"F.sigmoid", ActivationType::kSigmoid},     {"nn.Sigmoid", ActivationType::kSigmoid},
+      {"torch.sigmoid", ActivationType::kSigmoid}, {"F.tanh", ActivationType::kTanh},
+      {"nn.Tanh", ActivationType::kTanh},          {"torch.tanh", ActivationType::kTanh},
+      {"F.silu", ActivationType::kSilu},           {"nn.SiLU", ActivationType::kSilu},
+      {"F.gelu", ActivationType::kGelu},           {"nn.GELU", ActivationType::kGelu},
+      {"F.hardswish", ActivationType::kHardSwish}, {"nn.Hardswish", ActivationType::kHardSwish},
+      {"F.hardtanh", ActivationType::kClip},       {"nn.Hardtanh", ActivationType::kClip},
+      {"torch.clamp", ActivationType::kClip},
+  };
+  return operators;
+}
+
+std::vector<std::string> ActivationOperatorTypes() {
+  std::vector<std::string> types;
+  for (const auto& [type, activation] : ActivationOperators()) {
+    types.push_back(type);
+  }
+  return types;
+}
+
+// 读取数值参数, 参数不存在或者为None时保留默认值
+void ReadScalar(const ParameterMap& params, const std::string& name, float& value) {
+  auto iter = params.find(name);
+  if (iter == params.end() || iter->second == nullptr) {
+    return;
+  }
+  if (const auto& float_param = std::dynamic_pointer_cast<RuntimeParameterFloat>(iter->second)) {
+    value = float_param->value;
+  } else if (const auto& int_param = std::dynamic_pointer_cast<RuntimeParameterInt>(iter->second)) {
+    value = float(int_param->value);
+  }
+}
+}  // namespace
+
+void FusedEpilogue::Apply(float* output, const float* residual, size_t size) const {
+  if (residual != nullptr) {
+    ResidualActivationForward(activation, output, residual, output, size, alpha, beta);
+  } else if (activation != ActivationType::kNone) {
+    ActivationForward(activation, output, output, size, alpha, beta);
+  }
+}
+
+StatusCode FusedEpilogue::Parse(const std::shared_ptr<RuntimeOperator>& op,
+                                FusedEpilogue& epilogue) {
+  CHECK(op != nullptr);
+  epilogue = FusedEpilogue();
+  if (op->has_parameter("fused_residual")) {
+    const auto& residual =
+        std::dynamic_pointer_cast<RuntimeParameterBool>(op->params.at("fused_residual"));
+    if (!residual) {
+      LOG(ERROR) << "The fused_residual parameter of " << op->name << " is not a bool";
+      return StatusCode::kParseParameterError;
+    }
+    epilogue.residual = residual->value;
+  }
+  if (!op->has_parameter("fused_activation")) {
+    return StatusCode::kSuccess;
+  }
+  const auto& type =
+      std::dynamic_pointer_cast<RuntimeParameterString>(op->params.at("fused_activation"));
+  if (!type) {
+    LOG(ERROR) << "The fused_activation parameter of " << op->name << " is not a string";
+    return StatusCode::kParseParameterError;
+  }
+  // 被融合的激活算子的参数以"fused_activation."为前缀
+  const std::string prefix = "fused_activation.";
+  ParameterMap activation_params;
+  for (const auto& [name, param] : op->params) {
+    if (name.compare(0, prefix.size(), prefix) == 0) {
+      activation_params.insert({name.substr(prefix.size()), param});
+    }
+  }
+  return ActivationLayer::ParseActivation(type->value, activation_params, epilogue.activation,
+                                          epilogue.alpha, epilogue.beta);
+}
+
+ActivationLayer::ActivationLayer(ActivationType type, float alpha, float beta)
+    : Layer("Activation"), type_(type), alpha_(alpha), beta_(beta) {}
+
+bool ActivationLayer::IsActivationOperator(const std::string& type) {
+  return ActivationOperators().find(type) != ActivationOperators().end();
+}
+
+StatusCode ActivationLayer::ParseActivation(const std::string& type, const ParameterMap& params,
+                                            ActivationType& activation, float& alpha,
+                                            float& beta) {
+  auto iter = ActivationOperators().find(type);
+  if (iter == ActivationOperators().end()) {
+    LOG(ERROR) << "Unsupported activation operator: " << type;
+    return StatusCode::kParseParameterError;
+  }
+  activation = iter->second;
+  alpha = 0.01f;
+  beta = 0.f;
+  if (type == "F.relu6" || type == "nn.ReLU6") {
+    alpha = 0.f;
+    beta = 6.f;
+  } else if (type == "F.hardtanh" || type == "nn.Hardtanh") {
+    alpha = -1.f;
+    beta = 1.f;
+    ReadScalar(params, "min_val", alpha);
+    ReadScalar(params, "max_val", beta);
+  } else if (type == "torch.clamp") {
+    alpha = -std::numeric_limits<float>::infinity();
+    beta = std::numeric_limits<float>::infinity();
+    ReadScalar(params, "min", alpha);
+    ReadScalar(params, "max", beta);
+  } else if (activation == ActivationType::kLeakyRelu) {
+    ReadScalar(params, "negative_slope", alpha);
+  } else if (activation == ActivationType::kGelu) {
+    auto approximate = params.find("approximate");
+    if (approximate != params.end()) {
+      const auto& value = std::dynamic_pointer_cast<RuntimeParameterString>(approximate->second);
+      if (value && value->value == "tanh") {
+        activation = ActivationType::kGeluTanh;
+      } else if (value && value->value != "none") {
+        LOG(ERROR) << "Unsupported gelu approximation: " << value->value;
+        return StatusCode::kParseParameterError;
+      }
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode ActivationLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the activation layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+  if (outputs.size() != inputs.size()) {
+    LOG(ERROR) << "The input and output tensor array size of the activation layer do not match";
+    return StatusCode::kInferOutputsEmpty;
+  }
+  const uint32_t batch = inputs.size();
+  size_t total_size = 0;
+  for (uint32_t b = 0; b < batch; ++b) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(b);
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(b);
+    if (input == nullptr || output == nullptr || input->empty()) {
+      LOG(ERROR) << "The input or output tensor of the activation layer is empty";
+      return StatusCode::kInferInputsEmpty;
+    }
+    if (input->shapes() != output->shapes() || input->layout() != output->layout()) {
+      LOG(ERROR) << "The input and output tensor of the activation layer do not match";
+      return StatusCode::kInferDimMismatch;
+    }
+    total_size += input->size();
+  }
+
+  // 连续的批次一次处理
+  const float* input_batch = TensorBatchPtr(inputs, 0, batch);
+  float* output_batch = TensorBatchPtr(outputs, 0, batch);
+  if (input_batch != nullptr && output_batch != nullptr) {
+    ActivationForward(type_, input_batch, output_batch, total_size, alpha_, beta_);
+  } else {
+    for (uint32_t b = 0; b < batch; ++b) {
+      ActivationForward(type_, inputs.at(b), outputs.at(b), alpha_, beta_);
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode ActivationLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                           std::shared_ptr<Layer<float>>& activation_layer) {
+  if (!op) {
+    LOG(ERROR) << "The activation operator is empty";
+    return StatusCode::kParseNullOperator;
+  }
+  ActivationType type = ActivationType::kNone;
+  float alpha = 0.01f;
+  float beta = 0.f;
+  const StatusCode status = ParseActivation(op->type, op->params, type, alpha, beta);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  activation_layer = std::make_shared<ActivationLayer>(type, alpha, beta);
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kActivationCreateInstance(ActivationOperatorTypes(),
+                                                 ActivationLayer::CreateInstance);
+
+}  // namespace kuiper_infer
@@ -0,0 +1,159 @@
+#include "layer/cat.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include "layer/layer_factory.h"
+
+namespace kuiper_infer {
+
+// 把一个通道平面拷贝到输出平面的(row_offset, col_offset)处
+static void CopyPlane(const float* input, uint32_t input_rows, uint32_t input_cols, float* output,
+                      uint32_t output_rows, uint32_t output_cols, uint32_t row_offset,
+                      uint32_t col_offset, TensorLayout layout) {
+  if (layout == TensorLayout::kColMajor) {
+    for (uint32_t c = 0; c < input_cols; ++c) {
+      std::copy(input + size_t(c) * input_rows, input + size_t(c + 1) * input_rows,
+                output + size_t(c + col_offset) * output_rows + row_offset);
+    }
+  } else {
+    for (uint32_t r = 0; r < input_rows; ++r) {
+      std::copy(input + size_t(r) * input_cols, input + size_t(r + 1) * input_cols,
+                output + size_t(r + row_offset) * output_cols + col_offset);
+    }
+  }
+}
+
+CatLayer::CatLayer(Axis axis) : Layer("Cat"), axis_(axis) {}
+
+bool CatLayer::IsLayoutSupported(TensorLayout layout) const {
+  return layout == TensorLayout::kColMajor || layout == TensorLayout::kRowMajor;
+}
+
+StatusCode CatLayer::CheckTensors(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                  const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  const uint32_t batch = outputs.size();
+  if (inputs.empty() || batch == 0 || inputs.size() % batch != 0) {
+    LOG(ERROR) << "The input and output tensor array size of the cat layer do not match";
+    return StatusCode::kInferInputsEmpty;
+  }
+  const uint32_t num_operands = inputs.size() / batch;
+  const uint32_t axis = uint32_t(axis_);
+  for (uint32_t b = 0; b < batch; ++b) {
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(b);
+    if (output == nullptr || output->empty() || !IsLayoutSupported(output->layout())) {
+      LOG(ERROR) << "The output tensor of the cat layer is empty or has a wrong layout";
+      return StatusCode::kInferOutputsEmpty;
+    }
+    std::vector<uint32_t> shapes = output->shapes();
+    uint32_t extent = 0;
+    for (uint32_t i = 0; i < num_operands; ++i) {
+      const std::shared_ptr<Tensor<float>>& input = inputs.at(i * batch + b);
+      if (input == nullptr || input->empty() || input->layout() != output->layout()) {
+        LOG(ERROR) << "The input tensor of the cat layer is empty or has a wrong layout";
+        return StatusCode::kInferInputsEmpty;
+      }
+      std::vector<uint32_t> input_shapes = input->shapes();
+      extent += input_shapes.at(axis);
+      input_shapes.at(axis) = shapes.at(axis);
+      if (input_shapes != shapes) {
+        LOG(ERROR) << "The input tensors of the cat layer do not match its output";
+        return StatusCode::kInferDimMismatch;
+      }
+    }
+    if (extent != shapes.at(axis)) {
+      LOG(ERROR) << "The input tensors of the cat layer do not add up to its output";
+      return StatusCode::kInferDimMismatch;
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode CatLayer::Build(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  return CheckTensors(inputs, outputs);
+}
+
+StatusCode CatLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                             std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = CheckTensors(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+
+  const uint32_t batch = outputs.size();
+  const uint32_t num_operands = inputs.size() / batch;
+  for (uint32_t b = 0; b < batch; ++b) {
+    Tensor<float>& output = *outputs.at(b);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < num_operands; ++i) {
+      const Tensor<float>& input = *inputs.at(i * batch + b);
+      if (axis_ == Axis::kChannel) {
+        // 通道平面连续, 输入的通道在输出中是一整段
+        float* slice = output.matrix_raw_ptr(offset);
+        if (input.raw_ptr() != slice) {
+          std::copy(input.raw_ptr(), input.raw_ptr() + input.size(), slice);
+        }
+        offset += input.channels();
+        continue;
+      }
+      const uint32_t row_offset = axis_ == Axis::kRow ? offset : 0;
+      const uint32_t col_offset = axis_ == Axis::kCol ? offset : 0;
+      for (uint32_t c = 0; c < output.channels(); ++c) {
+        CopyPlane(input.matrix_raw_ptr(c), input.rows(), input.cols(), output.matrix_raw_ptr(c),
+                  output.rows(), output.cols(), row_offset, col_offset, output.layout());
+      }
+      offset += axis_ == Axis::kRow ? input.rows() : input.cols();
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode CatLayer::OperandDimToAxis(int32_t dim, uint32_t rank, Axis& axis) {
+  if (rank < 2 || rank > 4) {
+    LOG(ERROR) << "Unsupported operand rank of the cat layer: " << rank;
+    return StatusCode::kParseParameterError;
+  }
+  if (dim < 0) {
+    dim += int32_t(rank);
+  }
+  if (dim <= 0 || dim >= int32_t(rank)) {
+    LOG(ERROR) << "The cat layer can not concatenate along dim " << dim << " of a rank " << rank
+               << " operand";
+    return StatusCode::kParseParameterError;
+  }
+  // 2维和3维的操作数存为通道数为1的张量, 维度靠后对齐到(channels, rows, cols)
+  axis = Axis(dim + 3 - int32_t(rank));
+  return StatusCode::kSuccess;
+}
+
+StatusCode CatLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                    std::shared_ptr<Layer<float>>& cat_layer) {
+  if (!op) {
+    LOG(ERROR) << "The cat operator is empty";
+    return StatusCode::kParseNullOperator;
+  }
+  if (!op->has_parameter("dim")) {
+    LOG(ERROR) << "Can not find the dim parameter of " << op->name;
+    return StatusCode::kParseParameterError;
+  }
+  const auto& dim = std::dynamic_pointer_cast<RuntimeParameterInt>(op->params.at("dim"));
+  if (!dim) {
+    LOG(ERROR) << "The dim parameter of " << op->name << " is not an int";
+    return StatusCode::kParseParameterError;
+  }
+  if (op->input_operands_seq.empty()) {
+    LOG(ERROR) << "The cat operator " << op->name << " has no input";
+    return StatusCode::kParseParameterError;
+  }
+  Axis axis = Axis::kChannel;
+  const StatusCode status =
+      OperandDimToAxis(dim->value, op->input_operands_seq.front()->shapes.size(), axis);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  cat_layer = std::make_shared<CatLayer>(axis);
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kCatCreateInstance("torch.cat", CatLayer::CreateInstance);
+
+}  // namespace kuiper_infer
@@ -0,0 +1,545 @@
+#include "layer/convolution.h"
+#include <cblas.h>
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+#include "data/tensor_layout.h"
+#include "layer/depthwise.h"
+#include "layer/layer_factory.h"
+#include "layer/winograd.h"
+
+namespace kuiper_infer {
+
+ConvolutionLayer::ConvolutionLayer(uint32_t in_channels, uint32_t out_channels, uint32_t kernel_h,
+                                   uint32_t kernel_w, uint32_t stride_h, uint32_t stride_w,
+                                   uint32_t padding_h, uint32_t padding_w, uint32_t dilation_h,
+                                   uint32_t dilation_w, uint32_t groups, bool use_bias)
+    : Layer("Convolution"),
+      in_channels_(in_channels),
+      out_channels_(out_channels),
+      kernel_h_(kernel_h),
+      kernel_w_(kernel_w),
+      stride_h_(stride_h),
+      stride_w_(stride_w),
+      padding_h_(padding_h),
+      padding_w_(padding_w),
+      dilation_h_(dilation_h),
+      dilation_w_(dilation_w),
+      groups_(groups),
+      use_bias_(use_bias) {
+  CHECK(in_channels > 0 && out_channels > 0 && kernel_h > 0 && kernel_w > 0);
+  CHECK(stride_h > 0 && stride_w > 0 && dilation_h > 0 && dilation_w > 0);
+  CHECK(groups > 0 && in_channels % groups == 0 && out_channels % groups == 0)
+      << "The channels " << in_channels << " and " << out_channels
+      << " are not divisible by groups " << groups;
+}
+
+uint32_t ConvolutionLayer::OutputSize(uint32_t input_size, uint32_t kernel_size, uint32_t stride,
+                                      uint32_t padding, uint32_t dilation) {
+  const int64_t extent = int64_t(dilation) * (kernel_size - 1) + 1;
+  const int64_t padded = int64_t(input_size) + 2 * int64_t(padding);
+  if (padded < extent) {
+    return 0;
+  }
+  return uint32_t((padded - extent) / stride + 1);
+}
+
+StatusCode ConvolutionLayer::set_weights(const std::vector<float>& weights) {
+  const size_t size = size_t(out_channels_) * (in_channels_ / groups_) * kernel_h_ * kernel_w_;
+  if (weights.size() != size) {
+    LOG(ERROR) << "The size of convolution weights is " << weights.size() << ", expected " << size;
+    return StatusCode::kParseWeightError;
+  }
+  // PNNX的OIHW排布按行展开即每组out x (in * kh * kw)的矩阵, 与im2col的行顺序一致
+  std::shared_ptr<float> packed_weights = AllocateTensorStorage<float>(size);
+  std::memcpy(packed_weights.get(), weights.data(), size * sizeof(float));
+  this->packed_weights_ = std::move(packed_weights);
+  this->winograd_weights_.reset();
+  this->blocked_block_size_ = 0;
+  return StatusCode::kSuccess;
+}
+
+StatusCode ConvolutionLayer::set_bias(const std::vector<float>& bias) {
+  if (bias.size() != out_channels_) {
+    LOG(ERROR) << "The size of convolution bias is " << bias.size() << ", expected "
+               << out_channels_;
+    return StatusCode::kParseWeightError;
+  }
+  this->bias_ = bias;
+  this->blocked_block_size_ = 0;
+  return StatusCode::kSuccess;
+}
+
+void ConvolutionLayer::set_epilogue(const FusedEpilogue& epilogue) { this->epilogue_ = epilogue; }
+
+bool ConvolutionLayer::IsBlockedDepthwise() const {
+  return groups_ > 1 && groups_ == in_channels_ && out_channels_ == in_channels_;
+}
+
+bool ConvolutionLayer::IsLayoutSupported(TensorLayout layout) const {
+  if (layout == TensorLayout::kColMajor) {
+    return true;
+  }
+  return IsBlockedDepthwise() &&
+         (layout == TensorLayout::kNCHW8c || layout == TensorLayout::kNCHW16c);
+}
+
+TensorLayout ConvolutionLayer::PreferredLayout() const {
+  return IsBlockedDepthwise() ? DefaultBlockedLayout() : TensorLayout::kColMajor;
+}
+
+void ConvolutionLayer::PackBlockedDepthwise(uint32_t block_size) {
+  // 每个通道块按抽头存放block_size个通道的权重, 补齐的通道权重和偏置为零
+  const uint32_t channel_blocks = (out_channels_ + block_size - 1) / block_size;
+  const size_t filter_size = size_t(kernel_h_) * kernel_w_;
+  std::shared_ptr<float> weights =
+      AllocateTensorStorage<float>(channel_blocks * filter_size * block_size);
+  std::shared_ptr<float> bias = AllocateTensorStorage<float>(channel_blocks * block_size);
+  std::fill(weights.get(), weights.get() + channel_blocks * filter_size * block_size, 0.f);
+  std::fill(bias.get(), bias.get() + channel_blocks * block_size, 0.f);
+  for (uint32_t c = 0; c < out_channels_; ++c) {
+    float* block = weights.get() + (c / block_size) * filter_size * block_size + c % block_size;
+    for (size_t k = 0; k < filter_size; ++k) {
+      block[k * block_size] = packed_weights_.get()[c * filter_size + k];
+    }
+    if (use_bias_) {
+      bias.get()[c] = bias_.at(c);
+    }
+  }
+  this->blocked_weights_ = std::move(weights);
+  this->blocked_bias_ = std::move(bias);
+  this->blocked_block_size_ = block_size;
+}
+
+StatusCode ConvolutionLayer::Build(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  if (inputs.empty() || inputs.front() == nullptr || inputs.front()->empty()) {
+    LOG(ERROR) << "The input tensor array in the convolution layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+  if (inputs.size() != (epilogue_.residual ? 2 * outputs.size() : outputs.size())) {
+    LOG(ERROR) << "The input and output tensor array size of the convolution layer do not match";
+    return StatusCode::kInferOutputsEmpty;
+  }
+  const std::shared_ptr<Tensor<float>>& input = inputs.front();
+  if (input->channels() != in_channels_) {
+    LOG(ERROR) << "The input channels of the convolution layer is " << input->channels()
+               << ", expected " << in_channels_;
+    return StatusCode::kInferDimMismatch;
+  }
+  const uint32_t output_h = OutputSize(input->rows(), kernel_h_, stride_h_, padding_h_, dilation_h_);
+  const uint32_t output_w = OutputSize(input->cols(), kernel_w_, stride_w_, padding_w_, dilation_w_);
+  if (output_h == 0 || output_w == 0) {
+    LOG(ERROR) << "The convolution kernel does not fit into the input of " << input->rows()
+               << " x " << input->cols();
+    return StatusCode::kInferDimMismatch;
+  }
+
+  this->input_h_ = input->rows();
+  this->input_w_ = input->cols();
+  this->output_h_ = output_h;
+  this->output_w_ = output_w;
+  this->algorithm_ = SelectAlgorithm();
+  if (algorithm_ == ConvolutionAlgorithm::kDepthwise && input->block_size() > 1 &&
+      packed_weights_ && (!use_bias_ || !bias_.empty()) &&
+      blocked_block_size_ != input->block_size()) {
+    PackBlockedDepthwise(input->block_size());
+  }
+  if (algorithm_ == ConvolutionAlgorithm::kWinograd) {
+    this->tiles_h_ = (output_h + kWinogradOutputTile - 1) / kWinogradOutputTile;
+    this->tiles_w_ = (output_w + kWinogradOutputTile - 1) / kWinogradOutputTile;
+    if (!winograd_weights_ && packed_weights_) {
+      std::shared_ptr<float> winograd_weights =
+          AllocateTensorStorage<float>(size_t(kWinogradTileSize) * out_channels_ * in_channels_);
+      WinogradTransformFilter(packed_weights_.get(), out_channels_, in_channels_,
+                              winograd_weights.get());
+      this->winograd_weights_ = std::move(winograd_weights);
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+ConvolutionAlgorithm ConvolutionLayer::SelectAlgorithm() const {
+  // 深度卷积是访存受限的, im2col只会多搬一遍数据
+  if (groups_ > 1 && groups_ == in_channels_) {
+    return ConvolutionAlgorithm::kDepthwise;
+  }
+  if (kernel_h_ == 1 && kernel_w_ == 1 && stride_h_ == 1 && stride_w_ == 1 && padding_h_ == 0 &&
+      padding_w_ == 0) {
+    return ConvolutionAlgorithm::kPointwise;
+  }
+  const bool winograd_shape = kernel_h_ == 3 && kernel_w_ == 3 && stride_h_ == 1 &&
+                              stride_w_ == 1 && dilation_h_ == 1 && dilation_w_ == 1 &&
+                              groups_ == 1;
+  if (!winograd_shape) {
+    return ConvolutionAlgorithm::kIm2colGemm;
+  }
+  // 通道数太少时输入输出变换的开销压过乘法的节省
+  if (in_channels_ < 8 || out_channels_ < 8) {
+    return ConvolutionAlgorithm::kIm2colGemm;
+  }
+  // 边缘不完整的分块浪费计算, 每个输出像素的乘法至少要比im2col少一半
+  const size_t tiles = size_t((output_h_ + kWinogradOutputTile - 1) / kWinogradOutputTile) *
+                       ((output_w_ + kWinogradOutputTile - 1) / kWinogradOutputTile);
+  if (size_t(output_h_) * output_w_ < 8 * tiles) {
+    return ConvolutionAlgorithm::kIm2colGemm;
+  }
+  return ConvolutionAlgorithm::kWinograd;
+}
+
+size_t ConvolutionLayer::WorkspaceSize() const {
+  switch (algorithm_) {
+    case ConvolutionAlgorithm::kIm2colGemm: {
+      return size_t(in_channels_) * kernel_h_ * kernel_w_ * output_h_ * output_w_;
+    }
+    case ConvolutionAlgorithm::kWinograd: {
+      return size_t(kWinogradTileSize) * tiles_h_ * tiles_w_ * (in_channels_ + out_channels_);
+    }
+    case ConvolutionAlgorithm::kDepthwise:
+    case ConvolutionAlgorithm::kPointwise: {
+      return 0;
+    }
+  }
+  return 0;
+}
+
+void ConvolutionLayer::Im2col(const Tensor<float>& input, float* col) const {
+  const uint32_t kernel_size = kernel_h_ * kernel_w_;
+  const uint32_t col_rows = in_channels_ * kernel_size;
+  const size_t input_plane = size_t(input_h_) * input_w_;
+  const size_t output_plane = size_t(output_h_) * output_w_;
+  const float* input_ptr = input.raw_ptr();
+
+#pragma omp parallel for if (col_rows * output_plane >= 16384)
+  for (uint32_t k = 0; k < col_rows; ++k) {
+    const uint32_t c = k / kernel_size;
+    const uint32_t kh = k % kernel_size / kernel_w_;
+    const uint32_t kw = k % kernel_w_;
+    const float* input_channel = input_ptr + c * input_plane;
+    float* col_row = col + k * output_plane;
+
+    // 输入行 ih = oh * stride_h + h_offset 落在[0, input_h)内的输出行区间
+    const int64_t h_offset = int64_t(kh) * dilation_h_ - padding_h_;
+    const int64_t oh_begin_raw = h_offset < 0 ? (-h_offset + stride_h_ - 1) / stride_h_ : 0;
+    const int64_t h_last = int64_t(input_h_) - 1 - h_offset;
+    const int64_t oh_end_raw = h_last < 0 ? 0 : h_last / stride_h_ + 1;
+    const uint32_t oh_end = uint32_t(std::min<int64_t>(output_h_, oh_end_raw));
+    const uint32_t oh_begin = uint32_t(std::min<int64_t>(oh_begin_raw, oh_end));
+
+    for (uint32_t ow = 0; ow < output_w_; ++ow) {
+      float* dst = col_row + size_t(ow) * output_h_;
+      const int64_t iw = int64_t(ow) * stride_w_ + int64_t(kw) * dilation_w_ - padding_w_;
+      if (iw < 0 || iw >= input_w_) {
+        std::fill(dst, dst + output_h_, 0.f);
+        continue;
+      }
+      const float* src = input_channel + iw * input_h_;
+      std::fill(dst, dst + oh_begin, 0.f);
+      if (stride_h_ == 1) {
+        std::memcpy(dst + oh_begin, src + oh_begin + h_offset, (oh_end - oh_begin) * sizeof(float));
+      } else {
+        for (uint32_t oh = oh_begin; oh < oh_end; ++oh) {
+          dst[oh] = src[int64_t(oh) * stride_h_ + h_offset];
+        }
+      }
+      std::fill(dst + oh_end, dst + output_h_, 0.f);
+    }
+  }
+}
+
+void ConvolutionLayer::FillBias(float* output, uint32_t output_plane) const {
+  for (uint32_t oc = 0; oc < out_channels_; ++oc) {
+    const float value = use_bias_ ? bias_.at(oc) : 0.f;
+    std::fill(output + size_t(oc) * output_plane, output + size_t(oc + 1) * output_plane, value);
+  }
+}
+
+void ConvolutionLayer::GroupGemm(const float* input, const float* residual,
+                                 Tensor<float>& output) const {
+  const uint32_t output_plane = output_h_ * output_w_;
+  const uint32_t group_out = out_channels_ / groups_;
+  const uint32_t group_k = in_channels_ / groups_ * kernel_h_ * kernel_w_;
+  float* output_ptr = output.raw_ptr();
+  float beta = 0.f;
+  if (use_bias_) {
+    FillBias(output_ptr, output_plane);
+    beta = 1.f;
+  }
+  // 输入的列按输出平面的列主序排列, 乘积的每一行就是一个输出通道
+  for (uint32_t g = 0; g < groups_; ++g) {
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, int32_t(group_out),
+                int32_t(output_plane), int32_t(group_k), 1.f,
+                packed_weights_.get() + size_t(g) * group_out * group_k, int32_t(group_k),
+                input + size_t(g) * group_k * output_plane, int32_t(output_plane), beta,
+                output_ptr + size_t(g) * group_out * output_plane, int32_t(output_plane));
+    // 该组的输出刚写完还在缓存中, 紧接着做残差加法和激活
+    const size_t group_offset = size_t(g) * group_out * output_plane;
+    epilogue_.Apply(output_ptr + group_offset,
+                    residual != nullptr ? residual + group_offset : nullptr,
+                    size_t(group_out) * output_plane);
+  }
+}
+
+void ConvolutionLayer::ForwardIm2colGemm(const Tensor<float>& input, const float* residual,
+                                         Tensor<float>& output, float* col) const {
+  Im2col(input, col);
+  GroupGemm(col, residual, output);
+}
+
+void ConvolutionLayer::ForwardPointwise(const Tensor<float>& input, const float* residual,
+                                        Tensor<float>& output) const {
+  // 1x1卷积的im2col矩阵就是输入本身, 通道连续存放的输入直接作为右矩阵
+  GroupGemm(input.raw_ptr(), residual, output);
+}
+
+void ConvolutionLayer::ForwardWinograd(const Tensor<float>& input, const float* residual,
+                                       Tensor<float>& output, float* workspace) const {
+  const uint32_t tiles = tiles_h_ * tiles_w_;
+  float* input_transformed = workspace;
+  float* output_transformed = workspace + size_t(kWinogradTileSize) * in_channels_ * tiles;
+  WinogradTransformInput(input.raw_ptr(), in_channels_, input_h_, input_w_, padding_h_,
+                         padding_w_, tiles_h_, tiles_w_, input_transformed);
+
+  // 变换域内每个元素位置是一次out x in乘in x tiles的矩阵乘法
+  const size_t filter_matrix = size_t(out_channels_) * in_channels_;
+  for (uint32_t e = 0; e < kWinogradTileSize; ++e) {
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, int32_t(out_channels_),
+                int32_t(tiles), int32_t(in_channels_), 1.f,
+                winograd_weights_.get() + e * filter_matrix, int32_t(in_channels_),
+                input_transformed + size_t(e) * in_channels_ * tiles, int32_t(tiles), 0.f,
+                output_transformed + size_t(e) * out_channels_ * tiles, int32_t(tiles));
+  }
+
+  WinogradTransformOutput(output_transformed, out_channels_, tiles_h_, tiles_w_,
+                          use_bias_ ? bias_.data() : nullptr, output.raw_ptr(), output_h_,
+                          output_w_);
+  epilogue_.Apply(output.raw_ptr(), residual, output.size());
+}
+
+void ConvolutionLayer::ForwardDepthwise(const Tensor<float>& input, const float* residual,
+                                        Tensor<float>& output) const {
+  DepthwiseShape shape;
+  shape.in_channels = in_channels_;
+  shape.out_channels = out_channels_;
+  shape.input_h = input_h_;
+  shape.input_w = input_w_;
+  shape.output_h = output_h_;
+  shape.output_w = output_w_;
+  shape.kernel_h = kernel_h_;
+  shape.kernel_w = kernel_w_;
+  shape.stride_h = stride_h_;
+  shape.stride_w = stride_w_;
+  shape.padding_h = padding_h_;
+  shape.padding_w = padding_w_;
+  shape.dilation_h = dilation_h_;
+  shape.dilation_w = dilation_w_;
+  if (input.block_size() > 1) {
+    CHECK_EQ(blocked_block_size_, input.block_size());
+    DepthwiseConvolutionBlocked(input.raw_ptr(), blocked_weights_.get(), blocked_bias_.get(),
+                                shape, blocked_block_size_, output.raw_ptr());
+  } else {
+    DepthwiseConvolution(input.raw_ptr(), packed_weights_.get(),
+                         use_bias_ ? bias_.data() : nullptr, shape, output.raw_ptr());
+  }
+  epilogue_.Apply(output.raw_ptr(), residual, output.size());
+}
+
+StatusCode ConvolutionLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the convolution layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+  const uint32_t batch = outputs.size();
+  if (inputs.size() != (epilogue_.residual ? 2 * batch : batch)) {
+    LOG(ERROR) << "The input and output tensor array size of the convolution layer do not match";
+    return StatusCode::kInferOutputsEmpty;
+  }
+  if (!packed_weights_ || (use_bias_ && bias_.empty())) {
+    LOG(ERROR) << "The weights of the convolution layer are not set";
+    return StatusCode::kInferParameterError;
+  }
+
+  const std::shared_ptr<Tensor<float>>& first_input = inputs.front();
+  if (first_input == nullptr || first_input->rows() != input_h_ ||
+      first_input->cols() != input_w_) {
+    // 在运行时图之外使用时按实际输入构建, 图分配的工作区不再适用
+    const StatusCode status = Build(inputs, outputs);
+    if (status != StatusCode::kSuccess) {
+      return status;
+    }
+    this->workspace_ = nullptr;
+  } else if ((algorithm_ == ConvolutionAlgorithm::kWinograd && !winograd_weights_) ||
+             (algorithm_ == ConvolutionAlgorithm::kDepthwise &&
+              first_input->block_size() != 1 && blocked_block_size_ != first_input->block_size())) {
+    // 权重在Build之后才设置
+    const StatusCode status = Build(inputs, outputs);
+    if (status != StatusCode::kSuccess) {
+      return status;
+    }
+  }
+
+  const std::vector<uint32_t> input_shapes{in_channels_, input_h_, input_w_};
+  const std::vector<uint32_t> output_shapes{out_channels_, output_h_, output_w_};
+  for (uint32_t b = 0; b < batch; ++b) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(b);
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(b);
+    if (input == nullptr || output == nullptr || input->empty() || output->empty()) {
+      LOG(ERROR) << "The input or output tensor of the convolution layer is empty";
+      return StatusCode::kInferInputsEmpty;
+    }
+    if (input->shapes() != input_shapes || output->shapes() != output_shapes) {
+      LOG(ERROR) << "The input or output tensor of the convolution layer has a wrong shape";
+      return StatusCode::kInferDimMismatch;
+    }
+    if (!IsLayoutSupported(input->layout()) || input->layout() != output->layout()) {
+      LOG(ERROR) << "The convolution layer does not support the tensor layout";
+      return StatusCode::kInferDimMismatch;
+    }
+    if (epilogue_.residual) {
+      const std::shared_ptr<Tensor<float>>& residual = inputs.at(batch + b);
+      if (residual == nullptr || residual->shapes() != output_shapes ||
+          residual->layout() != output->layout()) {
+        LOG(ERROR) << "The residual tensor of the convolution layer does not match its output";
+        return StatusCode::kInferDimMismatch;
+      }
+    }
+  }
+
+  float* workspace = this->workspace_;
+  const size_t workspace_size = WorkspaceSize();
+  if (workspace == nullptr && workspace_size > 0) {
+    if (owned_workspace_size_ < workspace_size) {
+      owned_workspace_ = AllocateTensorStorage<float>(workspace_size);
+      owned_workspace_size_ = workspace_size;
+    }
+    workspace = owned_workspace_.get();
+  }
+
+  for (uint32_t b = 0; b < batch; ++b) {
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(b);
+    const float* residual = epilogue_.residual ? inputs.at(batch + b)->raw_ptr() : nullptr;
+    switch (algorithm_) {
+      case ConvolutionAlgorithm::kIm2colGemm: {
+        ForwardIm2colGemm(*inputs.at(b), residual, *output, workspace);
+        break;
+      }
+      case ConvolutionAlgorithm::kWinograd: {
+        ForwardWinograd(*inputs.at(b), residual, *output, workspace);
+        break;
+      }
+      case ConvolutionAlgorithm::kDepthwise: {
+        ForwardDepthwise(*inputs.at(b), residual, *output);
+        break;
+      }
+      case ConvolutionAlgorithm::kPointwise: {
+        ForwardPointwise(*inputs.at(b), residual, *output);
+        break;
+      }
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode ConvolutionLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                            std::shared_ptr<Layer<float>>& conv_layer) {
+  if (!op) {
+    LOG(ERROR) << "The convolution operator is empty";
+    return StatusCode::kParseNullOperator;
+  }
+  const auto& params = op->params;
+  for (const char* name : {"in_channels", "out_channels", "kernel_size", "stride", "padding",
+                           "dilation", "groups", "bias"}) {
+    if (!op->has_parameter(name)) {
+      LOG(ERROR) << "Can not find the " << name << " parameter of " << op->name;
+      return StatusCode::kParseParameterError;
+    }
+  }
+  const auto& in_channels = std::dynamic_pointer_cast<RuntimeParameterInt>(params.at("in_channels"));
+  const auto& out_channels =
+      std::dynamic_pointer_cast<RuntimeParameterInt>(params.at("out_channels"));
+  const auto& kernel_size =
+      std::dynamic_pointer_cast<RuntimeParameterIntArray>(params.at("kernel_size"));
+  const auto& stride = std::dynamic_pointer_cast<RuntimeParameterIntArray>(params.at("stride"));
+  const auto& dilation = std::dynamic_pointer_cast<RuntimeParameterIntArray>(params.at("dilation"));
+  const auto& groups = std::dynamic_pointer_cast<RuntimeParameterInt>(params.at("groups"));
+  const auto& use_bias = std::dynamic_pointer_cast<RuntimeParameterBool>(params.at("bias"));
+  if (!in_channels || !out_channels || !kernel_size || !stride || !dilation || !groups ||
+      !use_bias || kernel_size->value.size() != 2 || stride->value.size() != 2 ||
+      dilation->value.size() != 2) {
+    LOG(ERROR) << "The parameters of the convolution operator " << op->name
+               << " have wrong types";
+    return StatusCode::kParseParameterError;
+  }
+
+  if (op->has_parameter("padding_mode")) {
+    const auto& padding_mode =
+        std::dynamic_pointer_cast<RuntimeParameterString>(params.at("padding_mode"));
+    if (!padding_mode || padding_mode->value != "zeros") {
+      LOG(ERROR) << "Only zero padding is supported by the convolution operator " << op->name;
+      return StatusCode::kParseParameterError;
+    }
+  }
+
+  // padding是两个整数, 或者新版本torch导出的"valid"/"same"
+  std::vector<int32_t> padding;
+  if (const auto& padding_array =
+          std::dynamic_pointer_cast<RuntimeParameterIntArray>(params.at("padding"))) {
+    padding = padding_array->value;
+  } else if (const auto& padding_string =
+                 std::dynamic_pointer_cast<RuntimeParameterString>(params.at("padding"))) {
+    if (padding_string->value == "valid") {
+      padding = {0, 0};
+    } else if (padding_string->value == "same") {
+      for (uint32_t i = 0; i < 2; ++i) {
+        const int32_t extent = dilation->value.at(i) * (kernel_size->value.at(i) - 1);
+        if (extent % 2 != 0 || stride->value.at(i) != 1) {
+          LOG(ERROR) << "Asymmetric same padding is not supported by " << op->name;
+          return StatusCode::kParseParameterError;
+        }
+        padding.push_back(extent / 2);
+      }
+    }
+  }
+  if (padding.size() != 2) {
+    LOG(ERROR) << "The padding parameter of the convolution operator " << op->name
+               << " is wrong";
+    return StatusCode::kParseParameterError;
+  }
+
+  std::shared_ptr<ConvolutionLayer> layer = std::make_shared<ConvolutionLayer>(
+      in_channels->value, out_channels->value, kernel_size->value.at(0), kernel_size->value.at(1),
+      stride->value.at(0), stride->value.at(1), padding.at(0), padding.at(1),
+      dilation->value.at(0), dilation->value.at(1), groups->value, use_bias->value);
+
+  if (!op->has_attribute("weight")) {
+    LOG(ERROR) << "Can not find the weight attribute of " << op->name;
+    return StatusCode::kParseWeightError;
+  }
+  StatusCode status = layer->set_weights(op->attribute.at("weight")->get<float>());
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  if (use_bias->value) {
+    if (!op->has_attribute("bias")) {
+      LOG(ERROR) << "Can not find the bias attribute of " << op->name;
+      return StatusCode::kParseWeightError;
+    }
+    status = layer->set_bias(op->attribute.at("bias")->get<float>());
+    if (status != StatusCode::kSuccess) {
+      return status;
+    }
+  }
+  FusedEpilogue epilogue;
+  status = FusedEpilogue::Parse(op, epilogue);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  layer->set_epilogue(epilogue);
+  conv_layer = layer;
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kConvolutionCreateInstance("nn.Conv2d", ConvolutionLayer::CreateInstance);
+
+}  // namespace kuiper_infer
@@ -0,0 +1,194 @@
+#include "layer/depthwise.h"
+#include <glog/logging.h>
+#include <algorithm>
+
+namespace kuiper_infer {
+
+// 带边界检查的单个输出像素, 用于边框和没有特化的卷积核
+static inline float DepthwisePixel(const float* input, const float* weights, float bias,
+                                   const DepthwiseShape& s, uint32_t oh, uint32_t ow) {
+  float sum = bias;
+  for (uint32_t kw = 0; kw < s.kernel_w; ++kw) {
+    const int64_t iw = int64_t(ow) * s.stride_w + int64_t(kw) * s.dilation_w - s.padding_w;
+    if (iw < 0 || iw >= s.input_w) {
+      continue;
+    }
+    for (uint32_t kh = 0; kh < s.kernel_h; ++kh) {
+      const int64_t ih = int64_t(oh) * s.stride_h + int64_t(kh) * s.dilation_h - s.padding_h;
+      if (ih < 0 || ih >= s.input_h) {
+        continue;
+      }
+      sum += weights[kh * s.kernel_w + kw] * input[iw * s.input_h + ih];
+    }
+  }
+  return sum;
+}
+
+// 所有抽头都在输入内的输出区间[begin, end)
+static inline void InteriorRange(uint32_t input_size, uint32_t output_size, uint32_t kernel,
+                                 uint32_t stride, uint32_t padding, uint32_t dilation,
+                                 uint32_t& begin, uint32_t& end) {
+  const int64_t extent = int64_t(dilation) * (kernel - 1);
+  const int64_t first = (int64_t(padding) + stride - 1) / stride;
+  const int64_t last = int64_t(input_size) - 1 + padding - extent;
+  const int64_t past_last = last < 0 ? 0 : last / stride + 1;
+  end = uint32_t(std::clamp<int64_t>(past_last, 0, output_size));
+  begin = uint32_t(std::clamp<int64_t>(first, 0, end));
+}
+
+template <uint32_t Kernel, uint32_t Stride>
+static void DepthwiseChannelUnrolled(const float* input, const float* weights, float bias,
+                                     const DepthwiseShape& s, uint32_t oh_begin, uint32_t oh_end,
+                                     uint32_t ow_begin, uint32_t ow_end, float* output) {
+  float w[Kernel * Kernel];
+  std::copy(weights, weights + Kernel * Kernel, w);
+  const size_t input_h = s.input_h;
+  const size_t output_h = s.output_h;
+  const int32_t count = int32_t(oh_end - oh_begin);
+  for (uint32_t ow = ow_begin; ow < ow_end; ++ow) {
+    const float* src = input + (size_t(ow) * Stride - s.padding_w) * input_h +
+                       size_t(oh_begin) * Stride - s.padding_h;
+    const float* columns[Kernel];
+    for (uint32_t kw = 0; kw < Kernel; ++kw) {
+      columns[kw] = src + kw * input_h;
+    }
+    float* dst = output + ow * output_h + oh_begin;
+    // 沿连续的输出列向量化, 卷积核完全展开
+#pragma omp simd
+    for (int32_t i = 0; i < count; ++i) {
+      float sum = bias;
+      for (uint32_t kw = 0; kw < Kernel; ++kw) {
+        for (uint32_t kh = 0; kh < Kernel; ++kh) {
+          sum += w[kh * Kernel + kw] * columns[kw][i * int32_t(Stride) + int32_t(kh)];
+        }
+      }
+      dst[i] = sum;
+    }
+  }
+}
+
+template <uint32_t Kernel, uint32_t Stride>
+static void DepthwiseChannel(const float* input, const float* weights, float bias,
+                             const DepthwiseShape& s, float* output) {
+  uint32_t oh_begin = 0;
+  uint32_t oh_end = 0;
+  uint32_t ow_begin = 0;
+  uint32_t ow_end = 0;
+  const uint32_t kernel_h = Kernel == 0 ? s.kernel_h : Kernel;
+  const uint32_t kernel_w = Kernel == 0 ? s.kernel_w : Kernel;
+  InteriorRange(s.input_h, s.output_h, kernel_h, s.stride_h, s.padding_h, s.dilation_h, oh_begin,
+                oh_end);
+  InteriorRange(s.input_w, s.output_w, kernel_w, s.stride_w, s.padding_w, s.dilation_w, ow_begin,
+                ow_end);
+  if constexpr (Kernel != 0) {
+    DepthwiseChannelUnrolled<Kernel, Stride>(input, weights, bias, s, oh_begin, oh_end, ow_begin,
+                                             ow_end, output);
+  } else {
+    for (uint32_t ow = ow_begin; ow < ow_end; ++ow) {
+      float* dst = output + size_t(ow) * s.output_h;
+      for (uint32_t oh = oh_begin; oh < oh_end; ++oh) {
+        dst[oh] = DepthwisePixel(input, weights, bias, s, oh, ow);
+      }
+    }
+  }
+
+  // 边框
+  for (uint32_t ow = 0; ow < s.output_w; ++ow) {
+    float* dst = output + size_t(ow) * s.output_h;
+    if (ow < ow_begin || ow >= ow_end) {
+      for (uint32_t oh = 0; oh < s.output_h; ++oh) {
+        dst[oh] = DepthwisePixel(input, weights, bias, s, oh, ow);
+      }
+    } else {
+      for (uint32_t oh = 0; oh < oh_begin; ++oh) {
+        dst[oh] = DepthwisePixel(input, weights, bias, s, oh, ow);
+      }
+      for (uint32_t oh = oh_end; oh < s.output_h; ++oh) {
+        dst[oh] = DepthwisePixel(input, weights, bias, s, oh, ow);
+      }
+    }
+  }
+}
+
+void DepthwiseConvolution(const float* input, const float* weights, const float* bias,
+                          const DepthwiseShape& shape, float* output) {
+  typedef void (*ChannelKernel)(const float*, const float*, float, const DepthwiseShape&, float*);
+  ChannelKernel kernel = DepthwiseChannel<0, 0>;
+  const bool square = shape.kernel_h == shape.kernel_w && shape.stride_h == shape.stride_w &&
+                      shape.dilation_h == 1 && shape.dilation_w == 1;
+  if (square) {
+    const uint32_t k = shape.kernel_h;
+    const uint32_t stride = shape.stride_h;
+    if (k == 3 && stride == 1) {
+      kernel = DepthwiseChannel<3, 1>;
+    } else if (k == 3 && stride == 2) {
+      kernel = DepthwiseChannel<3, 2>;
+    } else if (k == 5 && stride == 1) {
+      kernel = DepthwiseChannel<5, 1>;
+    } else if (k == 5 && stride == 2) {
+      kernel = DepthwiseChannel<5, 2>;
+    }
+  }
+
+  const uint32_t multiplier = shape.out_channels / shape.in_channels;
+  const size_t input_plane = size_t(shape.input_h) * shape.input_w;
+  const size_t output_plane = size_t(shape.output_h) * shape.output_w;
+  const size_t filter_size = size_t(shape.kernel_h) * shape.kernel_w;
+#pragma omp parallel for if (shape.out_channels * output_plane >= 16384)
+  for (uint32_t c = 0; c < shape.out_channels; ++c) {
+    kernel(input + (c / multiplier) * input_plane, weights + c * filter_size,
+           bias != nullptr ? bias[c] : 0.f, shape, output + c * output_plane);
+  }
+}
+
+template <uint32_t Block>
+static void DepthwiseBlock(const float* input, const float* weights, const float* bias,
+                           const DepthwiseShape& s, float* output) {
+  for (uint32_t oh = 0; oh < s.output_h; ++oh) {
+    for (uint32_t ow = 0; ow < s.output_w; ++ow) {
+      float* dst = output + (size_t(oh) * s.output_w + ow) * Block;
+      float sum[Block];
+      std::copy(bias, bias + Block, sum);
+      for (uint32_t kh = 0; kh < s.kernel_h; ++kh) {
+        const int64_t ih = int64_t(oh) * s.stride_h + int64_t(kh) * s.dilation_h - s.padding_h;
+        if (ih < 0 || ih >= s.input_h) {
+          continue;
+        }
+        for (uint32_t kw = 0; kw < s.kernel_w; ++kw) {
+          const int64_t iw = int64_t(ow) * s.stride_w + int64_t(kw) * s.dilation_w - s.padding_w;
+          if (iw < 0 || iw >= s.input_w) {
+            continue;
+          }
+          const float* src = input + (size_t(ih) * s.input_w + size_t(iw)) * Block;
+          const float* w = weights + (size_t(kh) * s.kernel_w + kw) * Block;
+          // 一个像素的Block个通道正好是一个向量
+#pragma omp simd
+          for (uint32_t l = 0; l < Block; ++l) {
+            sum[l] += w[l] * src[l];
+          }
+        }
+      }
+      std::copy(sum, sum + Block, dst);
+    }
+  }
+}
+
+void DepthwiseConvolutionBlocked(const float* input, const float* weights, const float* bias,
+                                 const DepthwiseShape& shape, uint32_t block_size, float* output) {
+  CHECK_EQ(shape.in_channels, shape.out_channels);
+  CHECK(block_size == 8 || block_size == 16) << "Unsupported channel block size: " << block_size;
+  typedef void (*BlockKernel)(const float*, const float*, const float*, const DepthwiseShape&,
+                              float*);
+  const BlockKernel kernel = block_size == 8 ? DepthwiseBlock<8> : DepthwiseBlock<16>;
+  const uint32_t channel_blocks = (shape.out_channels + block_size - 1) / block_size;
+  const size_t input_block = size_t(shape.input_h) * shape.input_w * block_size;
+  const size_t output_block = size_t(shape.output_h) * shape.output_w * block_size;
+  const size_t filter_block = size_t(shape.kernel_h) * shape.kernel_w * block_size;
+#pragma omp parallel for if (channel_blocks * output_block >= 16384)
+  for (uint32_t cb = 0; cb < channel_blocks; ++cb) {
+    kernel(input + cb * input_block, weights + cb * filter_block, bias + cb * block_size, shape,
+           output + cb * output_block);
+  }
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,568 @@
+#include "layer/expression.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include "data/activation.h"
+#include "data/tensor_util.h"
+#include "layer/layer_factory.h"
+
+namespace kuiper_infer {
+
+namespace {
+// 每个线程一次处理的元素个数下限, 小于它时不开并行
+constexpr size_t kExpressionParallelSize = 16384;
+
+bool IsUnary(ExpressionOp op) { return uint8_t(op) >= 10 && uint8_t(op) < 40; }
+
+bool IsBinary(ExpressionOp op) { return uint8_t(op) >= 40; }
+
+const std::map<std::string, ExpressionOp>& ExpressionFunctions() {
+  static const std::map<std::string, ExpressionOp> functions = {
+      {"neg", ExpressionOp::kNeg},
+      {"abs", ExpressionOp::kAbs},
+      {"square", ExpressionOp::kSquare},
+      {"sqrt", ExpressionOp::kSqrt},
+      {"rsqrt", ExpressionOp::kRsqrt},
+      {"reciprocal", ExpressionOp::kReciprocal},
+      {"exp", ExpressionOp::kExp},
+      {"log", ExpressionOp::kLog},
+      {"sin", ExpressionOp::kSin},
+      {"cos", ExpressionOp::kCos},
+      {"tanh", ExpressionOp::kTanh},
+      {"floor", ExpressionOp::kFloor},
+      {"ceil", ExpressionOp::kCeil},
+      {"round", ExpressionOp::kRound},
+      {"trunc", ExpressionOp::kTrunc},
+      {"sign", ExpressionOp::kSign},
+      {"relu", ExpressionOp::kRelu},
+      {"sigmoid", ExpressionOp::kSigmoid},
+      {"silu", ExpressionOp::kSilu},
+      {"gelu", ExpressionOp::kGelu},
+      {"gelu_tanh", ExpressionOp::kGeluTanh},
+      {"hardswish", ExpressionOp::kHardSwish},
+      {"add", ExpressionOp::kAdd},
+      {"sub", ExpressionOp::kSub},
+      {"mul", ExpressionOp::kMul},
+      {"div", ExpressionOp::kDiv},
+      {"max", ExpressionOp::kMaximum},
+      {"maximum", ExpressionOp::kMaximum},
+      {"min", ExpressionOp::kMinimum},
+      {"minimum", ExpressionOp::kMinimum},
+      {"pow", ExpressionOp::kPow},
+      {"atan2", ExpressionOp::kAtan2},
+      {"fmod", ExpressionOp::kFmod},
+      {"remainder", ExpressionOp::kRemainder},
+      {"floor_divide", ExpressionOp::kFloorDivide},
+      {"leaky_relu", ExpressionOp::kLeakyRelu},
+  };
+  return functions;
+}
+
+// PNNX的前缀表达式, 递归下降地生成后缀指令
+class ExpressionParser {
+ public:
+  explicit ExpressionParser(const std::string& expr) : expr_(expr) {}
+
+  bool Parse(std::vector<ExpressionInstruction>& instructions) {
+    return ParseTerm(instructions) && pos_ == expr_.size();
+  }
+
+ private:
+  bool ParseTerm(std::vector<ExpressionInstruction>& instructions) {
+    const size_t begin = pos_;
+    while (pos_ < expr_.size() && std::strchr("(),", expr_.at(pos_)) == nullptr) {
+      pos_ += 1;
+    }
+    const std::string token = expr_.substr(begin, pos_ - begin);
+    if (token.empty()) {
+      return false;
+    }
+
+    if (pos_ < expr_.size() && expr_.at(pos_) == '(') {
+      auto function = ExpressionFunctions().find(token);
+      if (function == ExpressionFunctions().end()) {
+        LOG(ERROR) << "Unsupported function in expression: " << token;
+        return false;
+      }
+      const uint32_t arity = IsBinary(function->second) ? 2 : 1;
+      pos_ += 1;
+      for (uint32_t i = 0; i < arity; ++i) {
+        if (i > 0 && !Consume(',')) {
+          return false;
+        }
+        if (!ParseTerm(instructions)) {
+          return false;
+        }
+      }
+      if (!Consume(')')) {
+        return false;
+      }
+      ExpressionInstruction instruction;
+      instruction.op = function->second;
+      instructions.push_back(instruction);
+      return true;
+    }
+
+    ExpressionInstruction instruction;
+    char* end = nullptr;
+    if (token.at(0) == '@') {
+      const unsigned long index = std::strtoul(token.c_str() + 1, &end, 10);
+      if (token.size() == 1 || *end != '\0') {
+        return false;
+      }
+      instruction.op = ExpressionOp::kInput;
+      instruction.input = uint32_t(index);
+    } else {
+      const float value = std::strtof(token.c_str(), &end);
+      if (*end != '\0') {
+        LOG(ERROR) << "Unsupported token in expression: " << token;
+        return false;
+      }
+      instruction.op = ExpressionOp::kConstant;
+      instruction.value = value;
+    }
+    instructions.push_back(instruction);
+    return true;
+  }
+
+  bool Consume(char ch) {
+    if (pos_ >= expr_.size() || expr_.at(pos_) != ch) {
+      return false;
+    }
+    pos_ += 1;
+    return true;
+  }
+
+  const std::string& expr_;
+  size_t pos_ = 0;
+};
+
+template <typename Op>
+inline void UnaryLoop(const float* a, float* output, uint32_t count, Op op) {
+#pragma omp simd
+  for (uint32_t j = 0; j < count; ++j) {
+    output[j] = op(a[j]);
+  }
+}
+
+template <typename Op>
+inline void BinaryLoop(const float* a, const float* b, float* output, uint32_t count, Op op) {
+#pragma omp simd
+  for (uint32_t j = 0; j < count; ++j) {
+    output[j] = op(a[j], b[j]);
+  }
+}
+
+void UnaryBlock(ExpressionOp op, const float* a, float* output, uint32_t count) {
+  switch (op) {
+    case ExpressionOp::kNeg:
+      UnaryLoop(a, output, count, [](float x) { return -x; });
+      break;
+    case ExpressionOp::kAbs:
+      UnaryLoop(a, output, count, [](float x) { return std::fabs(x); });
+      break;
+    case ExpressionOp::kSquare:
+      UnaryLoop(a, output, count, [](float x) { return x * x; });
+      break;
+    case ExpressionOp::kSqrt:
+      UnaryLoop(a, output, count, [](float x) { return std::sqrt(x); });
+      break;
+    case ExpressionOp::kRsqrt:
+      UnaryLoop(a, output, count, [](float x) { return 1.f / std::sqrt(x); });
+      break;
+    case ExpressionOp::kReciprocal:
+      UnaryLoop(a, output, count, [](float x) { return 1.f / x; });
+      break;
+    case ExpressionOp::kExp:
+      UnaryLoop(a, output, count, [](float x) { return std::exp(x); });
+      break;
+    case ExpressionOp::kLog:
+      UnaryLoop(a, output, count, [](float x) { return std::log(x); });
+      break;
+    case ExpressionOp::kSin:
+      UnaryLoop(a, output, count, [](float x) { return std::sin(x); });
+      break;
+    case ExpressionOp::kCos:
+      UnaryLoop(a, output, count, [](float x) { return std::cos(x); });
+      break;
+    case ExpressionOp::kTanh:
+      // 复用激活函数的向量化多项式近似
+      ActivationForward(ActivationType::kTanh, a, output, count);
+      break;
+    case ExpressionOp::kFloor:
+      UnaryLoop(a, output, count, [](float x) { return std::floor(x); });
+      break;
+    case ExpressionOp::kCeil:
+      UnaryLoop(a, output, count, [](float x) { return std::ceil(x); });
+      break;
+    case ExpressionOp::kRound:
+      // 与torch.round一致, 0.5舍入到偶数
+      UnaryLoop(a, output, count, [](float x) { return std::nearbyint(x); });
+      break;
+    case ExpressionOp::kTrunc:
+      UnaryLoop(a, output, count, [](float x) { return std::trunc(x); });
+      break;
+    case ExpressionOp::kSign:
+      UnaryLoop(a, output, count, [](float x) { return float(x > 0.f) - float(x < 0.f); });
+      break;
+    case ExpressionOp::kRelu:
+      UnaryLoop(a, output, count, [](float x) { return x > 0.f ? x : 0.f; });
+      break;
+    case ExpressionOp::kSigmoid:
+      ActivationForward(ActivationType::kSigmoid, a, output, count);
+      break;
+    case ExpressionOp::kSilu:
+      ActivationForward(ActivationType::kSilu, a, output, count);
+      break;
+    case ExpressionOp::kGelu:
+      ActivationForward(ActivationType::kGelu, a, output, count);
+      break;
+    case ExpressionOp::kGeluTanh:
+      ActivationForward(ActivationType::kGeluTanh, a, output, count);
+      break;
+    case ExpressionOp::kHardSwish:
+      ActivationForward(ActivationType::kHardSwish, a, output, count);
+      break;
+    default:
+      LOG(FATAL) << "Unknown unary expression op: " << int32_t(op);
+  }
+}
+
+void BinaryBlock(ExpressionOp op, const float* a, const float* b, float* output,
+                 uint32_t count) {
+  switch (op) {
+    case ExpressionOp::kAdd:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return x + y; });
+      break;
+    case ExpressionOp::kSub:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return x - y; });
+      break;
+    case ExpressionOp::kMul:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return x * y; });
+      break;
+    case ExpressionOp::kDiv:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return x / y; });
+      break;
+    case ExpressionOp::kMaximum:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return x > y ? x : y; });
+      break;
+    case ExpressionOp::kMinimum:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return x < y ? x : y; });
+      break;
+    case ExpressionOp::kPow:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return std::pow(x, y); });
+      break;
+    case ExpressionOp::kAtan2:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return std::atan2(x, y); });
+      break;
+    case ExpressionOp::kFmod:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return std::fmod(x, y); });
+      break;
+    case ExpressionOp::kRemainder:
+      // python的取余, 结果与除数同号
+      BinaryLoop(a, b, output, count, [](float x, float y) {
+        const float r = std::fmod(x, y);
+        return r != 0.f && (r < 0.f) != (y < 0.f) ? r + y : r;
+      });
+      break;
+    case ExpressionOp::kFloorDivide:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return std::floor(x / y); });
+      break;
+    case ExpressionOp::kLeakyRelu:
+      BinaryLoop(a, b, output, count, [](float x, float y) { return x >= 0.f ? x : x * y; });
+      break;
+    default:
+      LOG(FATAL) << "Unknown binary expression op: " << int32_t(op);
+  }
+}
+}  // namespace
+
+StatusCode ExpressionProgram::Compile(const std::string& expr, ExpressionProgram& program) {
+  std::vector<ExpressionInstruction> instructions;
+  ExpressionParser parser(expr);
+  if (!parser.Parse(instructions)) {
+    LOG(ERROR) << "Can not compile the expression " << expr;
+    return StatusCode::kParseParameterError;
+  }
+
+  // 模拟栈的深度, 同时统计引用的输入个数
+  uint32_t depth = 0;
+  uint32_t max_depth = 0;
+  uint32_t num_inputs = 0;
+  for (const ExpressionInstruction& instruction : instructions) {
+    if (instruction.op == ExpressionOp::kInput || instruction.op == ExpressionOp::kConstant) {
+      depth += 1;
+      if (instruction.op == ExpressionOp::kInput) {
+        num_inputs = std::max(num_inputs, instruction.input + 1);
+      }
+    } else if (IsBinary(instruction.op)) {
+      depth -= 1;
+    }
+    max_depth = std::max(max_depth, depth);
+  }
+  CHECK_EQ(depth, 1);
+  if (max_depth > kMaxStackDepth) {
+    LOG(ERROR) << "The expression " << expr << " needs a stack of " << max_depth
+               << ", at most " << kMaxStackDepth << " is supported";
+    return StatusCode::kParseParameterError;
+  }
+
+  program.instructions_ = std::move(instructions);
+  program.num_inputs_ = num_inputs;
+  return StatusCode::kSuccess;
+}
+
+void ExpressionProgram::EvaluateBlock(const float* const* inputs, const size_t* strides,
+                                      float* output, uint32_t count) const {
+  CHECK_LE(count, kBlockSize);
+  // 栈上每个位置指向一个输入或者该位置的中间结果块, 连续的输入不复制
+  alignas(64) float stack[kMaxStackDepth][kBlockSize];
+  const float* operands[kMaxStackDepth];
+  uint32_t top = 0;
+  const size_t size = instructions_.size();
+  for (size_t k = 0; k < size; ++k) {
+    const ExpressionInstruction& instruction = instructions_[k];
+    const bool last = k + 1 == size;
+    if (instruction.op == ExpressionOp::kInput) {
+      const float* input = inputs[instruction.input];
+      const size_t stride = strides[instruction.input];
+      if (stride == 1 && !last) {
+        operands[top] = input;
+      } else {
+        float* slot = last ? output : stack[top];
+        if (stride == 0) {
+          std::fill(slot, slot + count, *input);
+        } else if (stride == 1) {
+          std::copy(input, input + count, slot);
+        } else {
+          for (uint32_t j = 0; j < count; ++j) {
+            slot[j] = input[j * stride];
+          }
+        }
+        operands[top] = slot;
+      }
+      top += 1;
+    } else if (instruction.op == ExpressionOp::kConstant) {
+      float* slot = last ? output : stack[top];
+      std::fill(slot, slot + count, instruction.value);
+      operands[top] = slot;
+      top += 1;
+    } else if (IsUnary(instruction.op)) {
+      float* slot = last ? output : stack[top - 1];
+      UnaryBlock(instruction.op, operands[top - 1], slot, count);
+      operands[top - 1] = slot;
+    } else {
+      float* slot = last ? output : stack[top - 2];
+      BinaryBlock(instruction.op, operands[top - 2], operands[top - 1], slot, count);
+      operands[top - 2] = slot;
+      top -= 1;
+    }
+  }
+}
+
+ExpressionLayer::ExpressionLayer(ExpressionProgram program)
+    : Layer("Expression"), program_(std::move(program)) {}
+
+bool ExpressionLayer::IsLayoutSupported(TensorLayout layout) const {
+  return layout == TensorLayout::kColMajor || layout == TensorLayout::kRowMajor;
+}
+
+StatusCode ExpressionLayer::CheckTensors(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  if (outputs.empty()) {
+    LOG(ERROR) << "The output tensor array in the expression layer is empty";
+    return StatusCode::kInferOutputsEmpty;
+  }
+  const uint32_t batch = outputs.size();
+  if (inputs.size() != size_t(program_.num_inputs()) * batch) {
+    LOG(ERROR) << "The expression layer expects " << program_.num_inputs()
+               << " input operands of batch " << batch << ", got " << inputs.size()
+               << " tensors";
+    return StatusCode::kInferInputsEmpty;
+  }
+  for (uint32_t b = 0; b < batch; ++b) {
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(b);
+    if (output == nullptr || output->empty() || !IsLayoutSupported(output->layout())) {
+      LOG(ERROR) << "The output tensor of the expression layer is empty or blocked";
+      return StatusCode::kInferOutputsEmpty;
+    }
+    const std::vector<uint32_t> output_shapes = output->shapes();
+    for (uint32_t i = 0; i < program_.num_inputs(); ++i) {
+      const std::shared_ptr<Tensor<float>>& input = inputs.at(i * batch + b);
+      if (input == nullptr || input->empty()) {
+        LOG(ERROR) << "The input tensor of the expression layer is empty";
+        return StatusCode::kInferInputsEmpty;
+      }
+      const std::vector<uint32_t> input_shapes = input->shapes();
+      for (size_t d = 0; d < output_shapes.size(); ++d) {
+        if (input_shapes.at(d) != output_shapes.at(d) && input_shapes.at(d) != 1) {
+          LOG(ERROR) << "The input of the expression layer does not broadcast to its output";
+          return StatusCode::kInferDimMismatch;
+        }
+      }
+      if (input_shapes != output_shapes && input->block_size() != 1) {
+        LOG(ERROR) << "Broadcast inputs of the expression layer can not be channel-blocked";
+        return StatusCode::kInferDimMismatch;
+      }
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode ExpressionLayer::Build(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                  const std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  return CheckTensors(inputs, outputs);
+}
+
+void ExpressionLayer::ForwardDense(const std::vector<const float*>& inputs, float* output,
+                                   size_t size) const {
+  const uint32_t block_size = ExpressionProgram::kBlockSize;
+  const size_t blocks = (size + block_size - 1) / block_size;
+  const std::vector<size_t> strides(inputs.size(), 1);
+#pragma omp parallel if (size >= kExpressionParallelSize)
+  {
+    std::vector<const float*> block_inputs(inputs.size());
+#pragma omp for
+    for (size_t block = 0; block < blocks; ++block) {
+      const size_t begin = block * block_size;
+      for (size_t i = 0; i < inputs.size(); ++i) {
+        block_inputs[i] = inputs[i] + begin;
+      }
+      program_.EvaluateBlock(block_inputs.data(), strides.data(), output + begin,
+                             uint32_t(std::min<size_t>(block_size, size - begin)));
+    }
+  }
+}
+
+void ExpressionLayer::ForwardBroadcast(const std::vector<const Tensor<float>*>& inputs,
+                                       Tensor<float>& output) const {
+  const std::vector<uint32_t> shapes = output.shapes();
+  const bool row_major = output.layout() == TensorLayout::kRowMajor;
+  const size_t outer = row_major ? output.rows() : output.cols();
+  const size_t inner = row_major ? output.cols() : output.rows();
+  const size_t rows = size_t(output.channels()) * outer;
+
+  // 最内层沿输出的连续维度, 被广播的维度步长为0
+  const size_t num_inputs = inputs.size();
+  std::vector<const float*> data(num_inputs);
+  std::vector<size_t> channel_strides(num_inputs);
+  std::vector<size_t> outer_strides(num_inputs);
+  std::vector<size_t> inner_strides(num_inputs);
+  for (size_t i = 0; i < num_inputs; ++i) {
+    const BroadcastStrides strides = TensorBroadcastStrides(*inputs.at(i), shapes);
+    data.at(i) = inputs.at(i)->raw_ptr();
+    channel_strides.at(i) = strides[1];
+    outer_strides.at(i) = row_major ? strides[2] : strides[3];
+    inner_strides.at(i) = row_major ? strides[3] : strides[2];
+  }
+
+  const uint32_t block_size = ExpressionProgram::kBlockSize;
+  float* output_ptr = output.raw_ptr();
+#pragma omp parallel if (rows * inner >= kExpressionParallelSize)
+  {
+    std::vector<const float*> block_inputs(num_inputs);
+#pragma omp for
+    for (size_t index = 0; index < rows; ++index) {
+      const size_t channel = index / outer;
+      const size_t o = index % outer;
+      float* output_row = output_ptr + index * inner;
+      for (size_t begin = 0; begin < inner; begin += block_size) {
+        for (size_t i = 0; i < num_inputs; ++i) {
+          block_inputs[i] = data[i] + channel * channel_strides[i] + o * outer_strides[i] +
+                            begin * inner_strides[i];
+        }
+        program_.EvaluateBlock(block_inputs.data(), inner_strides.data(), output_row + begin,
+                               uint32_t(std::min<size_t>(block_size, inner - begin)));
+      }
+    }
+  }
+}
+
+StatusCode ExpressionLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = CheckTensors(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  const uint32_t batch = outputs.size();
+  const uint32_t num_inputs = program_.num_inputs();
+  auto is_dense = [&](uint32_t b) {
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(b);
+    for (uint32_t i = 0; i < num_inputs; ++i) {
+      const std::shared_ptr<Tensor<float>>& input = inputs.at(i * batch + b);
+      if (input->shapes() != output->shapes() || input->layout() != output->layout()) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  bool dense = true;
+  for (uint32_t b = 0; b < batch && dense; ++b) {
+    dense = is_dense(b);
+  }
+  if (dense) {
+    // 形状相同时各操作数连续的批次作为一个扁平数组计算
+    float* output_batch = TensorBatchPtr(outputs, 0, batch);
+    std::vector<const float*> input_batches(num_inputs);
+    bool contiguous = output_batch != nullptr;
+    for (uint32_t i = 0; i < num_inputs && contiguous; ++i) {
+      input_batches.at(i) = TensorBatchPtr(inputs, i * batch, batch);
+      contiguous = input_batches.at(i) != nullptr;
+    }
+    if (contiguous) {
+      ForwardDense(input_batches, output_batch, size_t(batch) * outputs.front()->size());
+      return StatusCode::kSuccess;
+    }
+  }
+
+  for (uint32_t b = 0; b < batch; ++b) {
+    if (is_dense(b)) {
+      std::vector<const float*> sample_inputs(num_inputs);
+      for (uint32_t i = 0; i < num_inputs; ++i) {
+        sample_inputs.at(i) = inputs.at(i * batch + b)->raw_ptr();
+      }
+      ForwardDense(sample_inputs, outputs.at(b)->raw_ptr(), outputs.at(b)->size());
+    } else {
+      std::vector<const Tensor<float>*> sample_inputs(num_inputs);
+      for (uint32_t i = 0; i < num_inputs; ++i) {
+        sample_inputs.at(i) = inputs.at(i * batch + b).get();
+      }
+      ForwardBroadcast(sample_inputs, *outputs.at(b));
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode ExpressionLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                           std::shared_ptr<Layer<float>>& expression_layer) {
+  if (!op) {
+    LOG(ERROR) << "The expression operator is empty";
+    return StatusCode::kParseNullOperator;
+  }
+  if (!op->has_parameter("expr")) {
+    LOG(ERROR) << "Can not find the expr parameter of " << op->name;
+    return StatusCode::kParseParameterError;
+  }
+  const auto& expr = std::dynamic_pointer_cast<RuntimeParameterString>(op->params.at("expr"));
+  if (!expr) {
+    LOG(ERROR) << "The expr parameter of " << op->name << " is not a string";
+    return StatusCode::kParseParameterError;
+  }
+  ExpressionProgram program;
+  const StatusCode status = ExpressionProgram::Compile(expr->value, program);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  expression_layer = std::make_shared<ExpressionLayer>(std::move(program));
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kExpressionCreateInstance("pnnx.Expression",
+                                                 ExpressionLayer::CreateInstance);
+
+}  // namespace kuiper_infer
@@ -0,0 +1,48 @@
+#include "layer/layer_factory.h"
+#include <glog/logging.h>
+
+namespace kuiper_infer {
+
+LayerRegisterer::CreateRegistry& LayerRegisterer::Registry() {
+  static CreateRegistry* kRegistry = new CreateRegistry();
+  return *kRegistry;
+}
+
+void LayerRegisterer::RegisterCreator(const std::string& layer_type, const Creator& creator) {
+  CHECK(creator != nullptr) << "The creator of layer type " << layer_type << " is empty";
+  CreateRegistry& registry = Registry();
+  CHECK(registry.find(layer_type) == registry.end())
+      << "Layer type " << layer_type << " has already been registered";
+  registry.insert({layer_type, creator});
+}
+
+std::shared_ptr<Layer<float>> LayerRegisterer::CreateLayer(
+    const std::shared_ptr<RuntimeOperator>& op) {
+  CHECK(op != nullptr) << "The operator is empty";
+  const CreateRegistry& registry = Registry();
+  const auto creator = registry.find(op->type);
+  LOG_IF(FATAL, creator == registry.end())
+      << "No layer is registered for operator " << op->name << " of type " << op->type;
+
+  std::shared_ptr<Layer<float>> layer;
+  const StatusCode status = creator->second(op, layer);
+  LOG_IF(FATAL, status != StatusCode::kSuccess)
+      << "Create layer " << op->name << " failed, error code: " << int32_t(status);
+  CHECK(layer != nullptr) << "Layer " << op->name << " create failed!";
+  return layer;
+}
+
+bool LayerRegisterer::IsRegistered(const std::string& layer_type) {
+  const CreateRegistry& registry = Registry();
+  return registry.find(layer_type) != registry.end();
+}
+
+std::vector<std::string> LayerRegisterer::layer_types() {
+  std::vector<std::string> layer_types;
+  for (const auto& [layer_type, _] : Registry()) {
+    layer_types.push_back(layer_type);
+  }
+  return layer_types;
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,239 @@
+#include "layer/linear.h"
+#include <cblas.h>
+#include <glog/logging.h>
+#include <algorithm>
+#include "data/tensor_util.h"
+#include "layer/layer_factory.h"
+
+namespace kuiper_infer {
+
+// 分块后每块输出的元素个数上限, 约为L2缓存大小
+constexpr uint32_t kEpilogueBlockSize = 64 * 1024;
+
+// 每块至少的行数, 太小的矩阵乘法效率很低
+constexpr uint32_t kEpilogueMinRows = 256;
+
+LinearLayer::LinearLayer(int32_t in_features, int32_t out_features, bool use_bias)
+    : Layer("Linear"), in_features_(in_features), out_features_(out_features), use_bias_(use_bias) {
+  CHECK_GT(in_features, 0);
+  CHECK_GT(out_features, 0);
+}
+
+bool LinearLayer::IsLayoutSupported(TensorLayout layout) const {
+  return layout == TensorLayout::kColMajor || layout == TensorLayout::kRowMajor;
+}
+
+StatusCode LinearLayer::set_weights(const std::vector<float>& weights) {
+  const size_t size = size_t(in_features_) * out_features_;
+  if (weights.size() != size) {
+    LOG(ERROR) << "The size of linear weights is " << weights.size() << ", expected " << size;
+    return StatusCode::kParseWeightError;
+  }
+  // PNNX按out x in行主序存放, 转置为in x out, 两个矩阵乘法操作数都不需要转置
+  std::shared_ptr<float> packed_weights = AllocateTensorStorage<float>(size);
+  for (int32_t o = 0; o < out_features_; ++o) {
+    for (int32_t i = 0; i < in_features_; ++i) {
+      packed_weights.get()[size_t(i) * out_features_ + o] = weights.at(size_t(o) * in_features_ + i);
+    }
+  }
+  this->packed_weights_ = std::move(packed_weights);
+  return StatusCode::kSuccess;
+}
+
+StatusCode LinearLayer::set_bias(const std::vector<float>& bias) {
+  if (bias.size() != size_t(out_features_)) {
+    LOG(ERROR) << "The size of linear bias is " << bias.size() << ", expected " << out_features_;
+    return StatusCode::kParseWeightError;
+  }
+  this->bias_ = bias;
+  return StatusCode::kSuccess;
+}
+
+void LinearLayer::set_epilogue(const FusedEpilogue& epilogue) { this->epilogue_ = epilogue; }
+
+void LinearLayer::ForwardRows(const float* input, const float* residual, float* output,
+                              uint32_t rows) const {
+  // 有后处理时按行分块, 每块乘完后趁输出还在缓存中做残差加法和激活
+  const uint32_t block_rows =
+      std::max<uint32_t>(kEpilogueMinRows, kEpilogueBlockSize / uint32_t(out_features_));
+  if (!epilogue_.empty() && rows > block_rows) {
+    for (uint32_t r = 0; r < rows; r += block_rows) {
+      const uint32_t count = std::min(block_rows, rows - r);
+      ForwardRows(input + size_t(r) * in_features_,
+                  residual != nullptr ? residual + size_t(r) * out_features_ : nullptr,
+                  output + size_t(r) * out_features_, count);
+    }
+    return;
+  }
+
+  float beta = 0.f;
+  if (use_bias_) {
+    for (uint32_t r = 0; r < rows; ++r) {
+      std::copy(bias_.begin(), bias_.end(), output + size_t(r) * out_features_);
+    }
+    beta = 1.f;
+  }
+
+  if (rows == 1) {
+    cblas_sgemv(CblasRowMajor, CblasTrans, in_features_, out_features_, 1.f,
+                packed_weights_.get(), out_features_, input, 1, beta, output, 1);
+  } else {
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, int32_t(rows), out_features_,
+                in_features_, 1.f, input, in_features_, packed_weights_.get(), out_features_, beta,
+                output, out_features_);
+  }
+  epilogue_.Apply(output, residual, size_t(rows) * out_features_);
+}
+
+void LinearLayer::ForwardColMajorPlane(const float* input, const float* residual, float* output,
+                                       uint32_t rows) const {
+  float beta = 0.f;
+  if (use_bias_) {
+    for (int32_t o = 0; o < out_features_; ++o) {
+      std::fill(output + size_t(o) * rows, output + size_t(o + 1) * rows, bias_.at(o));
+    }
+    beta = 1.f;
+  }
+  // 打包的in x out行主序权重即out x in列主序的W
+  cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, int32_t(rows), out_features_, in_features_,
+              1.f, input, int32_t(rows), packed_weights_.get(), out_features_, beta, output,
+              int32_t(rows));
+  epilogue_.Apply(output, residual, size_t(rows) * out_features_);
+}
+
+StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the linear layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+  const uint32_t batch = outputs.size();
+  if (inputs.size() != (epilogue_.residual ? 2 * batch : batch)) {
+    LOG(ERROR) << "The input and output tensor array size of the linear layer do not match";
+    return StatusCode::kInferDimMismatch;
+  }
+  if (!packed_weights_ || (use_bias_ && bias_.empty())) {
+    LOG(ERROR) << "The weights of the linear layer are not set";
+    return StatusCode::kInferParameterError;
+  }
+
+  const std::shared_ptr<Tensor<float>>& first_input = inputs.front();
+  CHECK(first_input != nullptr && !first_input->empty());
+  const uint32_t channels = first_input->channels();
+  const uint32_t rows = first_input->rows();
+  const TensorLayout layout = first_input->layout();
+  for (uint32_t b = 0; b < batch; ++b) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(b);
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(b);
+    if (input == nullptr || output == nullptr || input->empty() || output->empty()) {
+      LOG(ERROR) << "The input or output tensor of the linear layer is empty";
+      return StatusCode::kInferInputsEmpty;
+    }
+    if (input->channels() != channels || input->rows() != rows ||
+        input->cols() != uint32_t(in_features_) || input->layout() != layout) {
+      LOG(ERROR) << "The input tensors of the linear layer do not share one shape";
+      return StatusCode::kInferDimMismatch;
+    }
+    if (output->shapes() != std::vector<uint32_t>{channels, rows, uint32_t(out_features_)} ||
+        output->layout() != layout || !IsLayoutSupported(layout)) {
+      LOG(ERROR) << "The output tensor of the linear layer has a wrong shape or layout";
+      return StatusCode::kInferDimMismatch;
+    }
+    if (epilogue_.residual) {
+      const std::shared_ptr<Tensor<float>>& residual = inputs.at(batch + b);
+      if (residual == nullptr || residual->shapes() != output->shapes() ||
+          residual->layout() != layout) {
+        LOG(ERROR) << "The residual tensor of the linear layer does not match its output";
+        return StatusCode::kInferDimMismatch;
+      }
+    }
+  }
+  auto residual_ptr = [&](uint32_t b, uint32_t c) -> const float* {
+    return epilogue_.residual ? inputs.at(batch + b)->matrix_raw_ptr(c) : nullptr;
+  };
+
+  if (layout == TensorLayout::kRowMajor || rows == 1) {
+    // 每个样本是channels * rows行的行主序矩阵, 连续的批次合成一个矩阵只做一次乘法
+    const uint32_t sample_rows = channels * rows;
+    const float* input_batch = TensorBatchPtr(inputs, 0, batch);
+    float* output_batch = TensorBatchPtr(outputs, 0, batch);
+    const float* residual_batch =
+        epilogue_.residual ? TensorBatchPtr(inputs, batch, batch) : nullptr;
+    if (input_batch != nullptr && output_batch != nullptr &&
+        (!epilogue_.residual || residual_batch != nullptr)) {
+      ForwardRows(input_batch, residual_batch, output_batch, batch * sample_rows);
+    } else {
+      for (uint32_t b = 0; b < batch; ++b) {
+        ForwardRows(inputs.at(b)->raw_ptr(), residual_ptr(b, 0), outputs.at(b)->raw_ptr(),
+                    sample_rows);
+      }
+    }
+  } else {
+    // 列主序的多行输入, 每个通道是rows x in_features的列主序矩阵
+    for (uint32_t b = 0; b < batch; ++b) {
+      for (uint32_t c = 0; c < channels; ++c) {
+        ForwardColMajorPlane(inputs.at(b)->matrix_raw_ptr(c), residual_ptr(b, c),
+                             outputs.at(b)->matrix_raw_ptr(c), rows);
+      }
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode LinearLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                       std::shared_ptr<Layer<float>>& linear_layer) {
+  if (!op) {
+    LOG(ERROR) << "The linear operator is empty";
+    return StatusCode::kParseNullOperator;
+  }
+  const auto& params = op->params;
+  if (!op->has_parameter("in_features") || !op->has_parameter("out_features") ||
+      !op->has_parameter("bias")) {
+    LOG(ERROR) << "Can not find the in_features, out_features or bias parameter of "
+               << op->name;
+    return StatusCode::kParseParameterError;
+  }
+  const auto& in_features =
+      std::dynamic_pointer_cast<RuntimeParameterInt>(params.at("in_features"));
+  const auto& out_features =
+      std::dynamic_pointer_cast<RuntimeParameterInt>(params.at("out_features"));
+  const auto& use_bias = std::dynamic_pointer_cast<RuntimeParameterBool>(params.at("bias"));
+  if (!in_features || !out_features || !use_bias) {
+    LOG(ERROR) << "The parameters of the linear operator " << op->name << " have wrong types";
+    return StatusCode::kParseParameterError;
+  }
+
+  std::shared_ptr<LinearLayer> layer =
+      std::make_shared<LinearLayer>(in_features->value, out_features->value, use_bias->value);
+
+  if (!op->has_attribute("weight")) {
+    LOG(ERROR) << "Can not find the weight attribute of " << op->name;
+    return StatusCode::kParseWeightError;
+  }
+  StatusCode status = layer->set_weights(op->attribute.at("weight")->get<float>());
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  if (use_bias->value) {
+    if (!op->has_attribute("bias")) {
+      LOG(ERROR) << "Can not find the bias attribute of " << op->name;
+      return StatusCode::kParseWeightError;
+    }
+    status = layer->set_bias(op->attribute.at("bias")->get<float>());
+    if (status != StatusCode::kSuccess) {
+      return status;
+    }
+  }
+  FusedEpilogue epilogue;
+  status = FusedEpilogue::Parse(op, epilogue);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  layer->set_epilogue(epilogue);
+  linear_layer = layer;
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kLinearCreateInstance("nn.Linear", LinearLayer::CreateInstance);
+
+}  // namespace kuiper_infer
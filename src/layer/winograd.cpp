@@ -0,0 +1,161 @@
+#include "layer/winograd.h"
+#include <algorithm>
+
+namespace kuiper_infer {
+
+// F(4x4, 3x3)的变换矩阵, 见Lavin & Gray, Fast Algorithms for Convolutional Neural Networks
+// G =   [ 1/4,     0,    0 ]   B^T = [ 4,  0, -5,  0, 1, 0 ]   A^T = [ 1, 1,  1, 1,  1, 0 ]
+//       [-1/6,  -1/6, -1/6 ]         [ 0, -4, -4,  1, 1, 0 ]         [ 0, 1, -1, 2, -2, 0 ]
+//       [-1/6,   1/6, -1/6 ]         [ 0,  4, -4, -1, 1, 0 ]         [ 0, 1,  1, 4,  4, 0 ]
+//       [1/24,  1/12,  1/6 ]         [ 0, -2, -1,  2, 1, 0 ]         [ 0, 1, -1, 8, -8, 1 ]
+//       [1/24, -1/12,  1/6 ]         [ 0,  2, -1, -2, 1, 0 ]
+//       [   0,     0,    1 ]         [ 0,  4,  0, -5, 0, 1 ]
+
+static inline void FilterTransform1D(const float* g, size_t stride, float* u, size_t u_stride) {
+  const float g0 = g[0];
+  const float g1 = g[stride];
+  const float g2 = g[2 * stride];
+  u[0] = g0 * 0.25f;
+  u[u_stride] = (g0 + g1 + g2) * (-1.f / 6.f);
+  u[2 * u_stride] = (g0 - g1 + g2) * (-1.f / 6.f);
+  u[3 * u_stride] = g0 * (1.f / 24.f) + g1 * (1.f / 12.f) + g2 * (1.f / 6.f);
+  u[4 * u_stride] = g0 * (1.f / 24.f) - g1 * (1.f / 12.f) + g2 * (1.f / 6.f);
+  u[5 * u_stride] = g2;
+}
+
+static inline void InputTransform1D(const float* d, size_t stride, float* v, size_t v_stride) {
+  const float d0 = d[0];
+  const float d1 = d[stride];
+  const float d2 = d[2 * stride];
+  const float d3 = d[3 * stride];
+  const float d4 = d[4 * stride];
+  const float d5 = d[5 * stride];
+  v[0] = 4.f * d0 - 5.f * d2 + d4;
+  v[v_stride] = -4.f * (d1 + d2) + d3 + d4;
+  v[2 * v_stride] = 4.f * (d1 - d2) - d3 + d4;
+  v[3 * v_stride] = 2.f * (d3 - d1) - d2 + d4;
+  v[4 * v_stride] = 2.f * (d1 - d3) - d2 + d4;
+  v[5 * v_stride] = 4.f * d1 - 5.f * d3 + d5;
+}
+
+static inline void OutputTransform1D(const float* m, size_t stride, float* y, size_t y_stride) {
+  const float m1_plus_m2 = m[stride] + m[2 * stride];
+  const float m1_minus_m2 = m[stride] - m[2 * stride];
+  const float m3_plus_m4 = m[3 * stride] + m[4 * stride];
+  const float m3_minus_m4 = m[3 * stride] - m[4 * stride];
+  y[0] = m[0] + m1_plus_m2 + m3_plus_m4;
+  y[y_stride] = m1_minus_m2 + 2.f * m3_minus_m4;
+  y[2 * y_stride] = m1_plus_m2 + 4.f * m3_plus_m4;
+  y[3 * y_stride] = m1_minus_m2 + 8.f * m3_minus_m4 + m[5 * stride];
+}
+
+void WinogradTransformFilter(const float* weights, uint32_t out_channels, uint32_t in_channels,
+                             float* transformed) {
+  const size_t matrix_size = size_t(out_channels) * in_channels;
+#pragma omp parallel for if (matrix_size >= 1024)
+  for (size_t k = 0; k < matrix_size; ++k) {
+    const float* g = weights + k * 9;
+    // tmp = G g, 6 x 3; u = tmp G^T, 6 x 6
+    float tmp[kWinogradInputTile * 3];
+    for (uint32_t j = 0; j < 3; ++j) {
+      FilterTransform1D(g + j, 3, tmp + j, 3);
+    }
+    float u[kWinogradTileSize];
+    for (uint32_t i = 0; i < kWinogradInputTile; ++i) {
+      FilterTransform1D(tmp + i * 3, 1, u + i * kWinogradInputTile, 1);
+    }
+    for (uint32_t e = 0; e < kWinogradTileSize; ++e) {
+      transformed[e * matrix_size + k] = u[e];
+    }
+  }
+}
+
+void WinogradTransformInput(const float* input, uint32_t channels, uint32_t input_h,
+                            uint32_t input_w, uint32_t padding_h, uint32_t padding_w,
+                            uint32_t tiles_h, uint32_t tiles_w, float* transformed) {
+  const size_t tiles = size_t(tiles_h) * tiles_w;
+  const size_t matrix_size = channels * tiles;
+  const size_t input_plane = size_t(input_h) * input_w;
+#pragma omp parallel for if (matrix_size >= 256)
+  for (uint32_t c = 0; c < channels; ++c) {
+    const float* input_channel = input + c * input_plane;
+    // d按[h][w]存放, 与列主序平面的行列对应
+    float d[kWinogradTileSize];
+    float tmp[kWinogradTileSize];
+    float v[kWinogradTileSize];
+    for (uint32_t tw = 0; tw < tiles_w; ++tw) {
+      for (uint32_t th = 0; th < tiles_h; ++th) {
+        const int64_t h0 = int64_t(th) * kWinogradOutputTile - padding_h;
+        const int64_t w0 = int64_t(tw) * kWinogradOutputTile - padding_w;
+        const bool inside = h0 >= 0 && w0 >= 0 && h0 + kWinogradInputTile <= input_h &&
+                            w0 + kWinogradInputTile <= input_w;
+        for (uint32_t j = 0; j < kWinogradInputTile; ++j) {
+          const int64_t iw = w0 + j;
+          for (uint32_t i = 0; i < kWinogradInputTile; ++i) {
+            const int64_t ih = h0 + i;
+            d[i * kWinogradInputTile + j] =
+                inside || (ih >= 0 && ih < input_h && iw >= 0 && iw < input_w)
+                    ? input_channel[iw * input_h + ih]
+                    : 0.f;
+          }
+        }
+        // tmp = B^T d, v = tmp B
+        for (uint32_t j = 0; j < kWinogradInputTile; ++j) {
+          InputTransform1D(d + j, kWinogradInputTile, tmp + j, kWinogradInputTile);
+        }
+        for (uint32_t i = 0; i < kWinogradInputTile; ++i) {
+          InputTransform1D(tmp + i * kWinogradInputTile, 1, v + i * kWinogradInputTile, 1);
+        }
+        const size_t t = size_t(th) * tiles_w + tw;
+        float* dst = transformed + c * tiles + t;
+        for (uint32_t e = 0; e < kWinogradTileSize; ++e) {
+          dst[e * matrix_size] = v[e];
+        }
+      }
+    }
+  }
+}
+
+void WinogradTransformOutput(const float* transformed, uint32_t channels, uint32_t tiles_h,
+                             uint32_t tiles_w, const float* bias, float* output, uint32_t output_h,
+                             uint32_t output_w) {
+  const size_t tiles = size_t(tiles_h) * tiles_w;
+  const size_t matrix_size = channels * tiles;
+  const size_t output_plane = size_t(output_h) * output_w;
+#pragma omp parallel for if (matrix_size >= 256)
+  for (uint32_t c = 0; c < channels; ++c) {
+    float* output_channel = output + c * output_plane;
+    const float bias_value = bias != nullptr ? bias[c] : 0.f;
+    float m[kWinogradTileSize];
+    float tmp[kWinogradOutputTile * kWinogradInputTile];
+    float y[kWinogradOutputTile * kWinogradOutputTile];
+    for (uint32_t th = 0; th < tiles_h; ++th) {
+      for (uint32_t tw = 0; tw < tiles_w; ++tw) {
+        const size_t t = size_t(th) * tiles_w + tw;
+        const float* src = transformed + c * tiles + t;
+        for (uint32_t e = 0; e < kWinogradTileSize; ++e) {
+          m[e] = src[e * matrix_size];
+        }
+        // tmp = A^T m, y = tmp A
+        for (uint32_t j = 0; j < kWinogradInputTile; ++j) {
+          OutputTransform1D(m + j, kWinogradInputTile, tmp + j, kWinogradInputTile);
+        }
+        for (uint32_t i = 0; i < kWinogradOutputTile; ++i) {
+          OutputTransform1D(tmp + i * kWinogradInputTile, 1, y + i * kWinogradOutputTile, 1);
+        }
+        const uint32_t h0 = th * kWinogradOutputTile;
+        const uint32_t w0 = tw * kWinogradOutputTile;
+        const uint32_t valid_h = std::min(kWinogradOutputTile, output_h - h0);
+        const uint32_t valid_w = std::min(kWinogradOutputTile, output_w - w0);
+        for (uint32_t j = 0; j < valid_w; ++j) {
+          float* dst = output_channel + size_t(w0 + j) * output_h + h0;
+          for (uint32_t i = 0; i < valid_h; ++i) {
+            dst[i] = y[i * kWinogradOutputTile + j] + bias_value;
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,452 @@
+#include "runtime/graph_pass.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "layer/activation.h"
+#include "layer/expression.h"
+
+namespace kuiper_infer {
+
+// 合并后表达式的指令数上限, 每次合并都要重新编译整个表达式, 过长的链分成多段
+constexpr size_t kMaxMergedInstructions = 512;
+
+// 跳过只有一个输出的算子, input的生产者改为直接写出它的输出操作数, 其余输入由调用者处理
+// 算子本身留在graph.ops中, 由调用者记录后统一调用RemoveOperators删除
+static void BypassOperator(pnnx::Graph& graph, pnnx::Operator* op, pnnx::Operand* input) {
+  pnnx::Operand* output = op->outputs.front();
+  pnnx::Operator* producer = input->producer;
+  std::replace(producer->outputs.begin(), producer->outputs.end(), input, output);
+  output->producer = producer;
+  graph.delete_operand(input);
+}
+
+// 一次性从graph.ops中删除一组已经断开的算子
+static void RemoveOperators(pnnx::Graph& graph, const std::vector<pnnx::Operator*>& removed) {
+  if (removed.empty()) {
+    return;
+  }
+  const std::unordered_set<pnnx::Operator*> removed_set(removed.begin(), removed.end());
+  graph.ops.erase(std::remove_if(graph.ops.begin(), graph.ops.end(),
+                                 [&](pnnx::Operator* op) { return removed_set.count(op) > 0; }),
+                  graph.ops.end());
+  for (pnnx::Operator* op : removed) {
+    delete op;
+  }
+}
+
+static bool FoldableBatchNorm(const pnnx::Operator* bn) {
+  if (bn->type != "nn.BatchNorm2d" && bn->type != "nn.BatchNorm1d") {
+    return false;
+  }
+  if (bn->inputs.size() != 1 || bn->outputs.size() != 1 || !bn->has_attr("running_mean") ||
+      !bn->has_attr("running_var")) {
+    return false;
+  }
+  const pnnx::Operand* input = bn->inputs.front();
+  const pnnx::Operator* producer = input->producer;
+  if (producer == nullptr || input->consumers.size() != 1 || producer->outputs.size() != 1 ||
+      !producer->has_attr("weight") || !producer->has_param("bias")) {
+    return false;
+  }
+  if (bn->type == "nn.BatchNorm2d") {
+    return producer->type == "nn.Conv2d";
+  }
+  // BatchNorm1d对第1维归一化, 只有(N, C)形状的全连接输出第1维才是输出特征
+  return producer->type == "nn.Linear" && input->shape.size() == 2;
+}
+
+int32_t FoldBatchNorm(pnnx::Graph& graph) {
+  std::vector<pnnx::Operator*> batch_norms;
+  for (pnnx::Operator* op : graph.ops) {
+    if (FoldableBatchNorm(op)) {
+      batch_norms.push_back(op);
+    }
+  }
+
+  std::vector<pnnx::Operator*> removed;
+  for (pnnx::Operator* bn : batch_norms) {
+    pnnx::Operator* layer = bn->inputs.front()->producer;
+    pnnx::Attribute& weight = layer->attrs.at("weight");
+    if (weight.shape.empty()) {
+      continue;
+    }
+    const int32_t channels = weight.shape.front();
+
+    const std::vector<float> mean = bn->attrs.at("running_mean").get_float32_data();
+    const std::vector<float> var = bn->attrs.at("running_var").get_float32_data();
+    std::vector<float> gamma(channels, 1.f);
+    std::vector<float> beta(channels, 0.f);
+    if (bn->has_attr("weight") && bn->has_attr("bias")) {
+      gamma = bn->attrs.at("weight").get_float32_data();
+      beta = bn->attrs.at("bias").get_float32_data();
+    }
+    const float eps = bn->has_param("eps") ? bn->params.at("eps").f : 1e-5f;
+    if (mean.size() != size_t(channels) || var.size() != size_t(channels) ||
+        gamma.size() != size_t(channels) || beta.size() != size_t(channels)) {
+      LOG(WARNING) << "Can not fold " << bn->name << " into " << layer->name
+                   << ", the channels do not match";
+      continue;
+    }
+
+    const bool has_bias = layer->params.at("bias").type == 1 && layer->params.at("bias").b &&
+                          layer->has_attr("bias");
+    std::vector<float> bias =
+        has_bias ? layer->attrs.at("bias").get_float32_data() : std::vector<float>(channels, 0.f);
+    std::vector<float> weights = weight.get_float32_data();
+    if (bias.size() != size_t(channels) || weights.size() % channels != 0) {
+      continue;
+    }
+
+    // 每个输出通道的权重是连续的一段
+    const size_t channel_size = weights.size() / channels;
+    for (int32_t c = 0; c < channels; ++c) {
+      const float scale = gamma.at(c) / std::sqrt(var.at(c) + eps);
+      for (size_t i = 0; i < channel_size; ++i) {
+        weights.at(c * channel_size + i) *= scale;
+      }
+      bias.at(c) = (bias.at(c) - mean.at(c)) * scale + beta.at(c);
+    }
+    weight.set_float32_data(weights);
+    if (has_bias) {
+      layer->attrs.at("bias").set_float32_data(bias);
+    } else {
+      layer->attrs["bias"] = pnnx::Attribute({channels}, bias);
+      layer->params["bias"] = true;
+    }
+
+    BypassOperator(graph, bn, bn->inputs.front());
+    removed.push_back(bn);
+  }
+  RemoveOperators(graph, removed);
+  return int32_t(removed.size());
+}
+
+static bool IsGemmLayer(const pnnx::Operator* op) {
+  return op != nullptr && (op->type == "nn.Conv2d" || op->type == "nn.Linear") &&
+         op->outputs.size() == 1;
+}
+
+// 操作数由卷积或全连接层产生且只被一个算子使用时, 返回该层
+static pnnx::Operator* SoleGemmProducer(const pnnx::Operand* operand) {
+  if (operand->consumers.size() != 1 || !IsGemmLayer(operand->producer)) {
+    return nullptr;
+  }
+  return operand->producer;
+}
+
+static bool FuseActivation(pnnx::Graph& graph, pnnx::Operator* op) {
+  if (!ActivationLayer::IsActivationOperator(op->type) || op->inputs.size() != 1 ||
+      op->outputs.size() != 1) {
+    return false;
+  }
+  pnnx::Operator* layer = SoleGemmProducer(op->inputs.front());
+  if (layer == nullptr || layer->has_param("fused_activation")) {
+    return false;
+  }
+  layer->params["fused_activation"] = op->type;
+  for (const auto& [name, param] : op->params) {
+    layer->params["fused_activation." + name] = param;
+  }
+  BypassOperator(graph, op, op->inputs.front());
+  return true;
+}
+
+static bool FuseResidualAdd(pnnx::Graph& graph, pnnx::Operator* op) {
+  if (op->type != "pnnx.Expression" || op->inputs.size() != 2 || op->outputs.size() != 1 ||
+      !op->has_param("expr") || op->params.at("expr").s != "add(@0,@1)") {
+    return false;
+  }
+  const std::vector<int32_t>& output_shape = op->outputs.front()->shape;
+  for (uint32_t i = 0; i < 2; ++i) {
+    pnnx::Operand* input = op->inputs.at(i);
+    pnnx::Operand* residual = op->inputs.at(1 - i);
+    pnnx::Operator* layer = SoleGemmProducer(input);
+    // 激活函数已经融合时加法在激活之后, 不能再放进同一个后处理
+    if (layer == nullptr || input == residual || layer->has_param("fused_activation") ||
+        layer->has_param("fused_residual")) {
+      continue;
+    }
+    // 不做广播, 两个加数和结果形状相同
+    if (output_shape.empty() || input->shape != output_shape || residual->shape != output_shape) {
+      continue;
+    }
+    // 运行时按生产者区分输入, 残差和层的输入不能来自同一个算子
+    if (std::any_of(layer->inputs.begin(), layer->inputs.end(), [residual](pnnx::Operand* x) {
+          return x->producer == residual->producer;
+        })) {
+      continue;
+    }
+
+    residual->remove_consumer(op);
+    residual->consumers.push_back(layer);
+    layer->inputs.push_back(residual);
+    if (!layer->inputnames.empty()) {
+      layer->inputnames.push_back("residual");
+    }
+    layer->params["fused_residual"] = true;
+    BypassOperator(graph, op, input);
+    return true;
+  }
+  return false;
+}
+
+int32_t FuseGemmEpilogue(pnnx::Graph& graph) {
+  // graph.ops按拓扑序排列, 卷积之后的加法和激活都排在它后面, 一次遍历即可融合整条链
+  std::vector<pnnx::Operator*> removed;
+  for (pnnx::Operator* op : graph.ops) {
+    if (FuseResidualAdd(graph, op) || FuseActivation(graph, op)) {
+      removed.push_back(op);
+    }
+  }
+  RemoveOperators(graph, removed);
+  return int32_t(removed.size());
+}
+
+// 激活算子的标量参数转换为运行时参数
+static std::map<std::string, std::shared_ptr<RuntimeParameter>> ScalarParameters(
+    const pnnx::Operator* op) {
+  std::map<std::string, std::shared_ptr<RuntimeParameter>> params;
+  for (const auto& [name, param] : op->params) {
+    switch (param.type) {
+      case 1:
+        params.insert({name, std::make_shared<RuntimeParameterBool>(param.b)});
+        break;
+      case 2:
+        params.insert({name, std::make_shared<RuntimeParameterInt>(param.i)});
+        break;
+      case 3:
+        params.insert({name, std::make_shared<RuntimeParameterFloat>(param.f)});
+        break;
+      case 4:
+        params.insert({name, std::make_shared<RuntimeParameterString>(param.s)});
+        break;
+      default:
+        params.insert({name, std::make_shared<RuntimeParameter>()});
+    }
+  }
+  return params;
+}
+
+static std::string FormatConstant(float value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+  return buffer;
+}
+
+// 逐元素算子写成以@0..@n-1为输入的表达式, 不是逐元素算子时返回false
+static bool ElementwiseExpression(const pnnx::Operator* op, std::string& expr) {
+  if (op->outputs.size() != 1) {
+    return false;
+  }
+  if (op->type == "pnnx.Expression") {
+    if (!op->has_param("expr") || op->params.at("expr").type != 4) {
+      return false;
+    }
+    ExpressionProgram program;
+    if (ExpressionProgram::Compile(op->params.at("expr").s, program) != StatusCode::kSuccess ||
+        program.num_inputs() != op->inputs.size()) {
+      return false;
+    }
+    expr = op->params.at("expr").s;
+    return true;
+  }
+
+  if (!ActivationLayer::IsActivationOperator(op->type) || op->inputs.size() != 1) {
+    return false;
+  }
+  ActivationType type = ActivationType::kNone;
+  float alpha = 0.f;
+  float beta = 0.f;
+  if (ActivationLayer::ParseActivation(op->type, ScalarParameters(op), type, alpha, beta) !=
+      StatusCode::kSuccess) {
+    return false;
+  }
+  switch (type) {
+    case ActivationType::kRelu:
+      expr = "relu(@0)";
+      break;
+    case ActivationType::kLeakyRelu:
+      expr = "leaky_relu(@0," + FormatConstant(alpha) + ")";
+      break;
+    case ActivationType::kSigmoid:
+      expr = "sigmoid(@0)";
+      break;
+    case ActivationType::kTanh:
+      expr = "tanh(@0)";
+      break;
+    case ActivationType::kSilu:
+      expr = "silu(@0)";
+      break;
+    case ActivationType::kGelu:
+      expr = "gelu(@0)";
+      break;
+    case ActivationType::kGeluTanh:
+      expr = "gelu_tanh(@0)";
+      break;
+    case ActivationType::kHardSwish:
+      expr = "hardswish(@0)";
+      break;
+    case ActivationType::kClip: {
+      expr = "@0";
+      if (alpha > -std::numeric_limits<float>::infinity()) {
+        expr = "max(" + expr + "," + FormatConstant(alpha) + ")";
+      }
+      if (beta < std::numeric_limits<float>::infinity()) {
+        expr = "min(" + expr + "," + FormatConstant(beta) + ")";
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+  return true;
+}
+
+// 把表达式中的@i替换为replacements[i]
+static std::string SubstituteInputs(const std::string& expr,
+                                    const std::vector<std::string>& replacements) {
+  std::string result;
+  size_t i = 0;
+  while (i < expr.size()) {
+    if (expr.at(i) != '@') {
+      result += expr.at(i);
+      i += 1;
+      continue;
+    }
+    size_t end = i + 1;
+    while (end < expr.size() && std::isdigit(static_cast<unsigned char>(expr.at(end)))) {
+      end += 1;
+    }
+    result += replacements.at(std::stoul(expr.substr(i + 1, end - i - 1)));
+    i = end;
+  }
+  return result;
+}
+
+// 表达式中@index出现的次数
+static size_t CountInputReferences(const std::string& expr, size_t index) {
+  const std::string reference = "@" + std::to_string(index);
+  size_t count = 0;
+  for (size_t i = expr.find(reference); i != std::string::npos;
+       i = expr.find(reference, i + reference.size())) {
+    const size_t end = i + reference.size();
+    if (end == expr.size() || !std::isdigit(static_cast<unsigned char>(expr.at(end)))) {
+      count += 1;
+    }
+  }
+  return count;
+}
+
+// 把消费者第index个输入的生产者代入消费者的表达式consumer_expr
+// expressions记录已经处理过的逐元素算子的表达式, 成功时删除中间操作数, 生产者由调用者删除
+static bool MergeElementwise(
+    pnnx::Graph& graph, pnnx::Operator* consumer, size_t index, std::string& consumer_expr,
+    const std::unordered_map<const pnnx::Operator*, std::string>& expressions) {
+  pnnx::Operand* middle = consumer->inputs.at(index);
+  pnnx::Operator* producer = middle->producer;
+  if (producer == nullptr || middle->consumers.size() != 1 || producer->outputs.size() != 1) {
+    return false;
+  }
+  const auto producer_iter = expressions.find(producer);
+  if (producer_iter == expressions.end()) {
+    return false;
+  }
+  const std::string& producer_expr = producer_iter->second;
+  // 多次引用时代入会重复计算生产者的表达式, 链式的自引用还会让表达式指数增长
+  if (CountInputReferences(consumer_expr, index) != 1) {
+    return false;
+  }
+
+  // 合并后的输入去重, 同一个操作数只读一次
+  std::vector<pnnx::Operand*> inputs;
+  auto input_index = [&inputs](pnnx::Operand* operand) {
+    auto iter = std::find(inputs.begin(), inputs.end(), operand);
+    if (iter == inputs.end()) {
+      inputs.push_back(operand);
+      iter = inputs.end() - 1;
+    }
+    return "@" + std::to_string(iter - inputs.begin());
+  };
+  std::vector<std::string> consumer_inputs(consumer->inputs.size());
+  for (size_t i = 0; i < consumer->inputs.size(); ++i) {
+    if (i != index) {
+      consumer_inputs.at(i) = input_index(consumer->inputs.at(i));
+      continue;
+    }
+    std::vector<std::string> producer_inputs(producer->inputs.size());
+    for (size_t j = 0; j < producer->inputs.size(); ++j) {
+      producer_inputs.at(j) = input_index(producer->inputs.at(j));
+    }
+    consumer_inputs.at(i) = SubstituteInputs(producer_expr, producer_inputs);
+  }
+  const std::string expr = SubstituteInputs(consumer_expr, consumer_inputs);
+
+  // 运行时按生产者区分输入, 同一算子的多个输出不能同时作为输入
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    for (size_t j = i + 1; j < inputs.size(); ++j) {
+      if (inputs.at(i)->producer == inputs.at(j)->producer) {
+        return false;
+      }
+    }
+  }
+  ExpressionProgram program;
+  if (ExpressionProgram::Compile(expr, program) != StatusCode::kSuccess ||
+      program.instructions().size() > kMaxMergedInstructions) {
+    return false;
+  }
+
+  for (pnnx::Operand* operand : inputs) {
+    auto& consumers = operand->consumers;
+    consumers.erase(std::remove_if(consumers.begin(), consumers.end(),
+                                   [&](const pnnx::Operator* op) {
+                                     return op == consumer || op == producer;
+                                   }),
+                    consumers.end());
+    consumers.push_back(consumer);
+  }
+  consumer->type = "pnnx.Expression";
+  consumer->params.clear();
+  consumer->params["expr"] = expr;
+  consumer->inputs = inputs;
+  consumer->inputnames.clear();
+  consumer_expr = expr;
+
+  graph.delete_operand(middle);
+  return true;
+}
+
+int32_t FuseElementwiseChains(pnnx::Graph& graph) {
+  // graph.ops按拓扑序排列, 访问到一个算子时它的生产者都已经合并完成
+  std::unordered_map<const pnnx::Operator*, std::string> expressions;
+  std::vector<pnnx::Operator*> removed;
+  for (pnnx::Operator* op : graph.ops) {
+    std::string expr;
+    if (!ElementwiseExpression(op, expr)) {
+      continue;
+    }
+    // 合并后输入的顺序会变化, 每次合并后重新检查所有输入
+    size_t i = 0;
+    while (i < op->inputs.size()) {
+      pnnx::Operator* producer = op->inputs.at(i)->producer;
+      if (MergeElementwise(graph, op, i, expr, expressions)) {
+        expressions.erase(producer);
+        removed.push_back(producer);
+        i = 0;
+      } else {
+        i += 1;
+      }
+    }
+    expressions.emplace(op, std::move(expr));
+  }
+  RemoveOperators(graph, removed);
+  return int32_t(removed.size());
+}
+
+}  // namespace kuiper_infer
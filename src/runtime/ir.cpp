@@ -1,8 +1,564 @@
 #include "runtime/ir.h"
+#include <algorithm>
+#include <chrono>
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include "runtime/ir.h"
\ No newline at end of file
+#include "data/tensor_layout.h"
+#include "layer/layer.h"
+#include "layer/layer_factory.h"
+#include "runtime/graph_pass.h"
+
+namespace kuiper_infer {
+
+RuntimeGraph::RuntimeGraph(std::string param_path, std::string bin_path)
+    : bin_path_(std::move(bin_path)), param_path_(std::move(param_path)) {}
+
+void RuntimeGraph::set_bin_path(const std::string& bin_path) { this->bin_path_ = bin_path; }
+
+void RuntimeGraph::set_param_path(const std::string& param_path) {
+  this->param_path_ = param_path;
+}
+
+const std::string& RuntimeGraph::param_path() const { return this->param_path_; }
+
+const std::string& RuntimeGraph::bin_path() const { return this->bin_path_; }
+
+RuntimeGraph::GraphState RuntimeGraph::graph_state() const { return this->graph_state_; }
+
+const RuntimeMemoryPlan& RuntimeGraph::memory_plan() const { return this->memory_plan_; }
+
+TensorLayout RuntimeGraph::operator_layout(const std::string& op_name) const {
+  for (const auto& op : this->operators_) {
+    if (op->name == op_name) {
+      return op->layout;
+    }
+  }
+  LOG(FATAL) << "Can not find the operator: " << op_name;
+  return TensorLayout::kColMajor;
+}
+
+size_t RuntimeGraph::reorder_count(const std::string& op_name) const {
+  for (const ExecutionStep& step : this->execution_plan_) {
+    if (step.op->name == op_name) {
+      return step.reorders.size();
+    }
+  }
+  return 0;
+}
+
+bool RuntimeGraph::Init() {
+  if (this->bin_path_.empty() || this->param_path_.empty()) {
+    LOG(ERROR) << "The bin path or param path is empty";
+    return false;
+  }
+
+  this->graph_ = std::make_unique<pnnx::Graph>();
+  int32_t load_result = this->graph_->load(param_path_, bin_path_);
+  if (load_result != 0) {
+    LOG(ERROR) << "Can not find the param path or bin path: " << param_path_ << " " << bin_path_;
+    return false;
+  }
+
+  const int32_t folded_batch_norms = FoldBatchNorm(*this->graph_);
+  LOG_IF(INFO, folded_batch_norms > 0)
+      << "Folded " << folded_batch_norms << " BatchNorm operators into their producers";
+  const int32_t fused_epilogues = FuseGemmEpilogue(*this->graph_);
+  LOG_IF(INFO, fused_epilogues > 0)
+      << "Fused " << fused_epilogues << " activation and add operators into their producers";
+  const int32_t fused_elementwise = FuseElementwiseChains(*this->graph_);
+  LOG_IF(INFO, fused_elementwise > 0)
+      << "Fused " << fused_elementwise << " elementwise operators into expressions";
+
+  std::vector<pnnx::Operator*> operators = this->graph_->ops;
+  if (operators.empty()) {
+    LOG(ERROR) << "Can not read the layers' define";
+    return false;
+  }
+
+  this->operators_.clear();
+  for (const pnnx::Operator* op : operators) {
+    if (!op) {
+      LOG(ERROR) << "Meet the empty node";
+      continue;
+    }
+    std::shared_ptr<RuntimeOperator> runtime_operator = std::make_shared<RuntimeOperator>();
+    runtime_operator->name = op->name;
+    runtime_operator->type = op->type;
+
+    InitGraphOperatorsInput(op->inputs, runtime_operator);
+    InitGraphOperatorsOutput(op->outputs, runtime_operator);
+    InitGraphAttrs(op->attrs, runtime_operator);
+    InitGraphParams(op->params, runtime_operator);
+    this->operators_.push_back(runtime_operator);
+  }
+
+  graph_state_ = GraphState::NeedBuild;
+  return true;
+}
+
+template <typename T>
+void RuntimeGraph::InitGraphOperatorsInput(
+    const std::vector<pnnx::Operand*>& inputs,
+    const std::shared_ptr<RuntimeOperatorBase<T>>& runtime_operator) {
+  for (const pnnx::Operand* input : inputs) {
+    if (!input) {
+      continue;
+    }
+    const pnnx::Operator* producer = input->producer;
+    CHECK(producer != nullptr) << "Operand " << input->name << " has no producer";
+
+    std::shared_ptr<RuntimeOperandBase<T>> runtime_operand =
+        std::make_shared<RuntimeOperandBase<T>>();
+    runtime_operand->name = producer->name;
+    runtime_operand->shapes = std::vector<int32_t>(input->shape.begin(), input->shape.end());
+    switch (input->type) {
+      case 1: {
+        runtime_operand->type = RuntimeDataType::kTypeFloat32;
+        break;
+      }
+      case 0: {
+        runtime_operand->type = RuntimeDataType::kTypeUnknown;
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Unknown input operand type: " << input->type;
+      }
+    }
+    runtime_operator->input_operands.insert({producer->name, runtime_operand});
+    runtime_operator->input_operands_seq.push_back(runtime_operand);
+  }
+}
+
+template <typename T>
+void RuntimeGraph::InitGraphOperatorsOutput(
+    const std::vector<pnnx::Operand*>& outputs,
+    const std::shared_ptr<RuntimeOperatorBase<T>>& runtime_operator) {
+  for (const pnnx::Operand* output : outputs) {
+    if (!output) {
+      continue;
+    }
+    for (const pnnx::Operator* consumer : output->consumers) {
+      runtime_operator->output_names.push_back(consumer->name);
+    }
+  }
+}
+
+template <typename T>
+void RuntimeGraph::InitGraphParams(const std::map<std::string, pnnx::Parameter>& params,
+                                   const std::shared_ptr<RuntimeOperatorBase<T>>& runtime_operator) {
+  for (const auto& [name, parameter] : params) {
+    const int32_t type = parameter.type;
+    switch (type) {
+      case int32_t(RuntimeParameterType::kParameterUnknown): {
+        runtime_operator->params.insert({name, std::make_shared<RuntimeParameter>()});
+        break;
+      }
+      case int32_t(RuntimeParameterType::kParameterBool): {
+        runtime_operator->params.insert({name, std::make_shared<RuntimeParameterBool>(parameter.b)});
+        break;
+      }
+      case int32_t(RuntimeParameterType::kParameterInt): {
+        runtime_operator->params.insert({name, std::make_shared<RuntimeParameterInt>(parameter.i)});
+        break;
+      }
+      case int32_t(RuntimeParameterType::kParameterFloat): {
+        runtime_operator->params.insert(
+            {name, std::make_shared<RuntimeParameterFloat>(parameter.f)});
+        break;
+      }
+      case int32_t(RuntimeParameterType::kParameterString): {
+        runtime_operator->params.insert(
+            {name, std::make_shared<RuntimeParameterString>(parameter.s)});
+        break;
+      }
+      case int32_t(RuntimeParameterType::kParameterIntArray): {
+        runtime_operator->params.insert(
+            {name, std::make_shared<RuntimeParameterIntArray>(parameter.ai)});
+        break;
+      }
+      case int32_t(RuntimeParameterType::kParameterFloatArray): {
+        runtime_operator->params.insert(
+            {name, std::make_shared<RuntimeParameterFloatArray>(parameter.af)});
+        break;
+      }
+      case int32_t(RuntimeParameterType::kParameterStringArray): {
+        runtime_operator->params.insert(
+            {name, std::make_shared<RuntimeParameterStringArray>(parameter.as)});
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Unknown parameter type: " << type;
+      }
+    }
+  }
+}
+
+template <typename T>
+void RuntimeGraph::InitGraphAttrs(const std::map<std::string, pnnx::Attribute>& attrs,
+                                  const std::shared_ptr<RuntimeOperatorBase<T>>& runtime_operator) {
+  for (const auto& [name, attr] : attrs) {
+    switch (attr.type) {
+      case 1: {
+        // 映射的权重只共享视图, 不再拷贝一份
+        std::shared_ptr<RuntimeAttribute> runtime_attribute =
+            attr.mapped_data ? std::make_shared<RuntimeAttribute>(attr.shape,
+                                                                  RuntimeDataType::kTypeFloat32,
+                                                                  attr.mapped_data, attr.mapped_size)
+                             : std::make_shared<RuntimeAttribute>(
+                                   attr.shape, RuntimeDataType::kTypeFloat32, attr.data);
+        runtime_operator->attribute.insert({name, runtime_attribute});
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Unknown attribute type: " << attr.type;
+      }
+    }
+  }
+}
+
+std::shared_ptr<Layer<float>> RuntimeGraph::CreateLayer(
+    const std::shared_ptr<RuntimeOperator>& op) {
+  return LayerRegisterer::CreateLayer(op);
+}
+
+void RuntimeGraph::CreateNodeRelation() {
+  // 构建图关系
+  for (const auto& current_op : this->operators_) {
+    const std::vector<std::string>& output_names = current_op->output_names;
+    for (const auto& kOutputName : output_names) {
+      for (const auto& output_op : this->operators_) {
+        if (output_op != current_op && output_op->name == kOutputName) {
+          current_op->output_operators.insert({kOutputName, output_op});
+        }
+      }
+    }
+
+    if (current_op->type != "pnnx.Input" && current_op->type != "pnnx.Output") {
+      current_op->layer = RuntimeGraph::CreateLayer(current_op);
+      CHECK(current_op->layer != nullptr)
+          << "Layer " << current_op->name << " create failed!";
+    }
+  }
+}
+
+void RuntimeGraph::ReverseTopoSort() {
+  for (const auto& op : this->operators_) {
+    op->has_forward = false;
+  }
+  this->input_ops_.clear();
+  this->output_ops_.clear();
+
+  int32_t current_forward_idx = 0;
+  for (const auto& op : this->operators_) {
+    if (op != nullptr && !op->has_forward) {
+      this->ReverseTopoSortInternal(op, current_forward_idx);
+    }
+  }
+
+  // 后序编号越大越靠前
+  std::sort(this->operators_.begin(), this->operators_.end(),
+            [](const auto& op1, const auto& op2) { return op1->start_time > op2->start_time; });
+
+  int32_t forward_index = 0;
+  for (const auto& op : this->operators_) {
+    op->start_time = forward_index++;
+    op->has_forward = false;
+  }
+
+  // 计算每个算子输出的最后使用时刻
+  for (const auto& op : this->operators_) {
+    op->end_time = op->start_time;
+    for (const auto& [_, output_op] : op->output_operators) {
+      op->end_time = std::max(op->end_time, output_op->start_time);
+    }
+  }
+}
+
+template <typename T>
+void RuntimeGraph::ReverseTopoSortInternal(const std::shared_ptr<RuntimeOperatorBase<T>>& root_op,
+                                           int32_t& current_forward_idx) {
+  if (!root_op) {
+    return;
+  }
+  if (root_op->input_operands.empty() && !root_op->has_forward) {
+    this->input_ops_.push_back(root_op);
+  }
+  if (root_op->output_names.empty() && !root_op->has_forward) {
+    this->output_ops_.push_back(root_op);
+  }
+
+  root_op->has_forward = true;
+  const auto& next_ops = root_op->output_operators;
+  for (const auto& [_, op] : next_ops) {
+    if (op != nullptr && !op->has_forward) {
+      this->ReverseTopoSortInternal(op, current_forward_idx);
+    }
+  }
+
+  for (const auto& [_, op] : next_ops) {
+    CHECK_EQ(op->has_forward, true);
+  }
+  root_op->start_time = current_forward_idx++;
+}
+
+static bool IsFourDimensional(const std::vector<pnnx::Operand*>& operands) {
+  for (const pnnx::Operand* operand : operands) {
+    if (!operand || operand->shape.size() != 4) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RuntimeGraph::PlanTensorLayouts(const std::vector<pnnx::Operator*>& pnnx_operators) {
+  CHECK_EQ(pnnx_operators.size(), this->operators_.size());
+  std::unordered_map<std::string, TensorLayout> output_layouts;
+  for (uint32_t i = 0; i < this->operators_.size(); ++i) {
+    const auto& op = this->operators_.at(i);
+    const pnnx::Operator* pnnx_op = pnnx_operators.at(i);
+    op->layout = TensorLayout::kColMajor;
+
+    // 图的输入输出和非4维的张量保持默认布局
+    if (op->layer != nullptr && pnnx_op->outputs.size() == 1 &&
+        IsFourDimensional(pnnx_op->inputs) && IsFourDimensional(pnnx_op->outputs)) {
+      const TensorLayout preferred = op->layer->PreferredLayout();
+      if (preferred != TensorLayout::kColMajor && op->layer->IsLayoutSupported(preferred)) {
+        op->layout = preferred;
+      } else if (!op->input_operands_seq.empty()) {
+        // 与布局无关的算子沿用第一个输入的布局, 避免在卷积之间来回重排
+        const auto& producer_layout = output_layouts.find(op->input_operands_seq.front()->name);
+        if (producer_layout != output_layouts.end() &&
+            op->layer->IsLayoutSupported(producer_layout->second)) {
+          op->layout = producer_layout->second;
+        }
+      }
+    }
+    output_layouts.insert({op->name, op->layout});
+  }
+}
+
+void RuntimeGraph::BuildExecutionPlan() {
+  // 消费者的输入直接指向生产者的输出张量, 运行时无需按名字传播
+  for (const auto& op : this->operators_) {
+    for (const auto& [_, output_op] : op->output_operators) {
+      const auto& input_operand = output_op->input_operands.find(op->name);
+      CHECK(input_operand != output_op->input_operands.end())
+          << "Operator " << output_op->name << " has no input from " << op->name;
+      CHECK(op->output_operands != nullptr) << "Operator " << op->name << " has no output";
+      input_operand->second->datas = op->output_operands->datas;
+      input_operand->second->batch_data = op->output_operands->batch_data;
+      input_operand->second->sample_size = op->output_operands->sample_size;
+    }
+  }
+
+  this->execution_plan_.clear();
+  this->execution_plan_.reserve(this->operators_.size());
+  for (const auto& op : this->operators_) {
+    if (op->type == "pnnx.Input") {
+      continue;
+    }
+
+    ExecutionStep step;
+    step.op = op.get();
+    // 布局不同的输入在这一步先重排到算子的布局, 重排后的批次同样连续存放
+    for (const auto& input_operand : op->input_operands_seq) {
+      if (input_operand->datas.empty() || input_operand->datas.front()->layout() == op->layout) {
+        continue;
+      }
+      const sftensor& first = input_operand->datas.front();
+      const std::vector<uint32_t> shapes = first->shapes();
+      const uint32_t block_size = TensorLayoutBlockSize(op->layout);
+      const size_t sample_size = size_t((shapes.at(0) + block_size - 1) / block_size * block_size) *
+                                 shapes.at(1) * shapes.at(2);
+      std::shared_ptr<float> batch_data =
+          AllocateTensorStorage<float>(sample_size * input_operand->datas.size());
+      for (uint32_t b = 0; b < input_operand->datas.size(); ++b) {
+        sftensor& input_data = input_operand->datas.at(b);
+        CHECK(input_data != nullptr) << "Operator " << op->name << " has an unbound input";
+        // 与内存池中的输出一样, 视图持有重排后的批次
+        sftensor reordered(new ftensor(batch_data.get() + b * sample_size, shapes, op->layout),
+                           [batch_data](ftensor* view) { delete view; });
+        step.reorders.emplace_back(input_data, reordered);
+        input_data = reordered;
+      }
+      input_operand->batch_data = std::move(batch_data);
+      input_operand->sample_size = sample_size;
+    }
+
+    if (op->type == "pnnx.Output") {
+      if (!step.reorders.empty()) {
+        this->execution_plan_.push_back(std::move(step));
+      }
+      continue;
+    }
+    CHECK(op->layer != nullptr) << "Layer " << op->name << " is not created!";
+    step.layer = op->layer.get();
+    for (const auto& input_operand : op->input_operands_seq) {
+      step.inputs.insert(step.inputs.end(), input_operand->datas.begin(),
+                         input_operand->datas.end());
+    }
+    if (op->output_operands) {
+      step.outputs = op->output_operands->datas;
+    }
+    const StatusCode status = step.layer->Build(step.inputs, step.outputs);
+    CHECK(status == StatusCode::kSuccess)
+        << "Layer " << op->name << " build failed, error code: " << int32_t(status);
+    this->execution_plan_.push_back(std::move(step));
+  }
+
+  // 层按顺序执行, 所有层共用一块工作区
+  size_t workspace_size = 0;
+  for (const ExecutionStep& step : this->execution_plan_) {
+    if (step.layer != nullptr) {
+      workspace_size = std::max(workspace_size, step.layer->WorkspaceSize());
+    }
+  }
+  memory_plan_.workspace =
+      workspace_size > 0 ? AllocateTensorStorage<float>(workspace_size) : nullptr;
+  memory_plan_.workspace_bytes = workspace_size * sizeof(float);
+  for (const ExecutionStep& step : this->execution_plan_) {
+    if (step.layer != nullptr) {
+      step.layer->set_workspace(memory_plan_.workspace.get());
+    }
+  }
+}
+
+void RuntimeGraph::Build() {
+  if (graph_state_ == GraphState::Complete) {
+    LOG(INFO) << "Model has been built already!";
+    return;
+  }
+
+  if (graph_state_ == GraphState::NeedInit) {
+    bool init_graph = Init();
+    LOG_IF(FATAL, !init_graph) << "Init graph failed!";
+  }
+
+  CHECK(graph_state_ >= GraphState::NeedBuild)
+      << "Graph status error, current state is " << int32_t(graph_state_);
+  LOG_IF(FATAL, this->operators_.empty()) << "Graph operators is empty, may be no init";
+
+  CreateNodeRelation();
+  ReverseTopoSort();
+
+  // 与排序后的 operators_ 一一对应的 pnnx 算子
+  std::unordered_map<std::string, pnnx::Operator*> pnnx_operators_map;
+  for (pnnx::Operator* pnnx_op : this->graph_->ops) {
+    pnnx_operators_map.insert({pnnx_op->name, pnnx_op});
+  }
+  std::vector<pnnx::Operator*> pnnx_operators;
+  pnnx_operators.reserve(this->operators_.size());
+  for (const auto& op : this->operators_) {
+    pnnx_operators.push_back(pnnx_operators_map.at(op->name));
+  }
+
+  PlanTensorLayouts(pnnx_operators);
+  RuntimeOperatorUtils<float>::InitOperatorInput(operators_);
+  RuntimeOperatorUtils<float>::InitOperatorOutput(pnnx_operators, operators_, memory_plan_);
+  LOG(INFO) << "Activation memory planned: " << memory_plan_.planned_bytes
+            << " bytes, naive: " << memory_plan_.naive_bytes << " bytes";
+  BuildExecutionPlan();
+
+  graph_state_ = GraphState::Complete;
+}
+
+void RuntimeGraph::Forward(bool debug) {
+  CHECK(graph_state_ == GraphState::Complete) << "Graph need be built!";
+
+  for (ExecutionStep& step : this->execution_plan_) {
+    for (const auto& [src, dst] : step.reorders) {
+      TensorReorder(*src, *dst);
+    }
+    if (step.layer == nullptr) {
+      continue;
+    }
+    const auto forward_step = [&step]() {
+      StatusCode status = step.layer->Forward(step.inputs, step.outputs);
+      CHECK(status == StatusCode::kSuccess)
+          << step.layer->layer_name() << " layer forward failed, error code: " << int32_t(status);
+    };
+    if (!debug) {
+      forward_step();
+      continue;
+    }
+    // 只在调试时计时, 正常推理不读时钟
+    const auto start = std::chrono::steady_clock::now();
+    forward_step();
+    const auto end = std::chrono::steady_clock::now();
+    LOG(INFO) << step.op->type << " " << step.op->name << " cost "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+              << "us";
+  }
+}
+
+void RuntimeGraph::set_inputs(const std::string& input_name, const std::vector<sftensor>& inputs) {
+  CHECK(graph_state_ == GraphState::Complete) << "Graph need be built!";
+  std::shared_ptr<RuntimeOperator> input_op;
+  for (const auto& op : this->input_ops_) {
+    if (op->name == input_name) {
+      input_op = op;
+      break;
+    }
+  }
+  CHECK(input_op != nullptr) << "Can not find the input operator: " << input_name;
+  CHECK(input_op->output_operands != nullptr);
+
+  // 输入张量在 Build 时已经绑定到下游算子, 这里只拷贝数据
+  const std::vector<sftensor>& input_datas = input_op->output_operands->datas;
+  CHECK_EQ(input_datas.size(), inputs.size());
+  for (uint32_t i = 0; i < inputs.size(); ++i) {
+    const sftensor& input = inputs.at(i);
+    const sftensor& input_data = input_datas.at(i);
+    CHECK(input != nullptr && input_data != nullptr);
+    CHECK(input->shapes() == input_data->shapes());
+    if (input.get() == input_data.get()) {
+      continue;
+    }
+    if (input->layout() == input_data->layout()) {
+      std::copy(input->raw_ptr(), input->raw_ptr() + input->size(), input_data->raw_ptr());
+    } else {
+      ftensor converted(*input);
+      converted.convert_layout(input_data->layout());
+      std::copy(converted.raw_ptr(), converted.raw_ptr() + converted.size(), input_data->raw_ptr());
+    }
+  }
+}
+
+std::vector<sftensor> RuntimeGraph::get_outputs(const std::string& output_name) const {
+  for (const auto& op : this->output_ops_) {
+    if (op->name == output_name) {
+      std::vector<sftensor> outputs;
+      for (const auto& input_operand : op->input_operands_seq) {
+        outputs.insert(outputs.end(), input_operand->datas.begin(), input_operand->datas.end());
+      }
+      return outputs;
+    }
+  }
+  LOG(FATAL) << "Can not find the output operator: " << output_name;
+  return {};
+}
+
+bool RuntimeGraph::is_input_op(const std::string& op_name) const {
+  for (const auto& op : this->input_ops_) {
+    if (op->name == op_name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RuntimeGraph::is_output_op(const std::string& op_name) const {
+  for (const auto& op : this->output_ops_) {
+    if (op->name == op_name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace kuiper_infer
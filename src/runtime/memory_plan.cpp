@@ -0,0 +1,78 @@
+#include "runtime/memory_plan.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+
+namespace kuiper_infer {
+
+static size_t AlignSize(size_t size) {
+  return (size + kArenaAlignment - 1) / kArenaAlignment * kArenaAlignment;
+}
+
+static bool IsOverlapped(const TensorLifetime& lifetime1, const TensorLifetime& lifetime2) {
+  return !(lifetime1.end_time < lifetime2.start_time || lifetime2.end_time < lifetime1.start_time);
+}
+
+size_t PlanMemoryOffsets(std::vector<TensorLifetime>& lifetimes) {
+  std::vector<uint32_t> order(lifetimes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&lifetimes](uint32_t i, uint32_t j) {
+    return lifetimes.at(i).size > lifetimes.at(j).size;
+  });
+
+  size_t arena_size = 0;
+  std::vector<uint32_t> placed;
+  placed.reserve(lifetimes.size());
+  for (uint32_t index : order) {
+    TensorLifetime& lifetime = lifetimes.at(index);
+    CHECK_LE(lifetime.start_time, lifetime.end_time);
+    const size_t size = AlignSize(lifetime.size);
+
+    // 与当前张量同时存活的已分配张量, 按偏移排序
+    std::vector<const TensorLifetime*> live;
+    for (uint32_t placed_index : placed) {
+      const TensorLifetime& other = lifetimes.at(placed_index);
+      if (IsOverlapped(lifetime, other)) {
+        live.push_back(&other);
+      }
+    }
+    std::sort(live.begin(), live.end(), [](const TensorLifetime* a, const TensorLifetime* b) {
+      return a->offset < b->offset;
+    });
+
+    // best fit: 选能放下的最小空隙
+    size_t best_offset = 0;
+    size_t best_gap = SIZE_MAX;
+    size_t current = 0;
+    for (const TensorLifetime* other : live) {
+      if (other->offset >= current) {
+        const size_t gap = other->offset - current;
+        if (gap >= size && gap < best_gap) {
+          best_gap = gap;
+          best_offset = current;
+        }
+      }
+      current = std::max(current, other->offset + AlignSize(other->size));
+    }
+    if (best_gap == SIZE_MAX) {
+      best_offset = current;
+    }
+
+    lifetime.offset = best_offset;
+    arena_size = std::max(arena_size, best_offset + size);
+    placed.push_back(index);
+  }
+  return arena_size;
+}
+
+std::shared_ptr<float> CreateArena(size_t size) {
+  const size_t bytes = std::max(AlignSize(size), kArenaAlignment) * sizeof(float);
+  float* arena = static_cast<float*>(std::aligned_alloc(kArenaAlignment * sizeof(float), bytes));
+  CHECK(arena != nullptr) << "Allocate activation arena failed, bytes: " << bytes;
+  std::memset(arena, 0, bytes);
+  return std::shared_ptr<float>(arena, [](float* ptr) { std::free(ptr); });
+}
+
+}  // namespace kuiper_infer
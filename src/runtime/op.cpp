@@ -1,5 +1,7 @@
 #include "runtime/op.h"
+#include <unordered_map>
 #include "data/tensor_util.h"
+#include "layer/cat.h"
 
 namespace kuiper_infer {
     void RuntimeOperatorUtils<float>::InitOperatorInput(
@@ -33,7 +35,7 @@ namespace kuiper_infer {
             << "Unsupported tensor shape sizes: " << input_operand_shape.size();
 
         if (!input_datas.empty()) {
-          CHECK_EQ(input_datas.size(), batch);
+          CHECK_EQ(input_datas.size(), size_t(batch));
         } else {
           input_datas.resize(batch);
         }
@@ -42,22 +44,43 @@ namespace kuiper_infer {
   }
 }
 
-static sftensor CreateTensor(const std::vector<int32_t>& operand_shapes) {
+static sftensor CreateTensor(const std::shared_ptr<float>& owner, float* raw_ptr,
+                            const std::vector<int32_t>& operand_shapes, TensorLayout layout) {
+  CHECK(layout == TensorLayout::kColMajor || operand_shapes.size() == 4)
+      << "Only 4-d operands can be stored in a non-default layout";
+  ftensor* tensor = nullptr;
   switch (operand_shapes.size()) {
     case 4:
-      return TensorCreate<float>(operand_shapes[1], operand_shapes[2], operand_shapes[3]);
+      tensor = new ftensor(raw_ptr,
+                           std::vector<uint32_t>{(uint32_t)operand_shapes[1],
+                                                 (uint32_t)operand_shapes[2],
+                                                 (uint32_t)operand_shapes[3]},
+                           layout);
+      break;
     case 3:
-      return TensorCreate<float>(operand_shapes[1], operand_shapes[2]);
+      tensor = new ftensor(raw_ptr, operand_shapes[1], operand_shapes[2]);
+      break;
     case 2:
-      return TensorCreate<float>(operand_shapes[1]);
+      tensor = new ftensor(raw_ptr, operand_shapes[1]);
+      break;
     default:
       LOG(FATAL) << "Unknown output operand shape length: " << operand_shapes.size();
       return nullptr;
   }
+  // 视图持有所在的内存池, 图销毁或重新规划后取出的输出仍然有效
+  return sftensor(tensor, [owner](ftensor* view) { delete view; });
 }
 
 static void CheckAndReshapeTensor(sftensor& output_tensor,
                                   const std::vector<int32_t>& operand_shapes) {
+  if (output_tensor->block_size() > 1) {
+    // 分块布局的张量不能改变形状
+    CHECK(operand_shapes.size() == 4);
+    CHECK(output_tensor->shapes() ==
+          std::vector<uint32_t>({(uint32_t)operand_shapes[1], (uint32_t)operand_shapes[2],
+                                 (uint32_t)operand_shapes[3]}));
+    return;
+  }
   switch (operand_shapes.size()) {
     case 4:
       output_tensor->reshape(
@@ -75,11 +98,73 @@ static void CheckAndReshapeTensor(sftensor& output_tensor,
   }
 }
 
-void RuntimeOperatorUtils<float>::InitOperatorOutput(
+// 生产者输出在拼接算子输出中的位置
+struct ConcatSlice {
+  /// 拼接算子的下标, -1表示输出单独分配
+  int32_t target = -1;
+
+  /// 输出在拼接结果中的起始通道
+  uint32_t channel_offset = 0;
+};
+
+// 沿通道拼接时, 只被拼接算子使用且布局相同的生产者直接写入拼接输出的通道段
+static std::vector<ConcatSlice> PlanConcatSlices(
     const std::vector<pnnx::Operator*>& pnnx_operators,
     const std::vector<std::shared_ptr<RuntimeOperator>>& operators) {
+  std::vector<ConcatSlice> slices(operators.size());
+  std::unordered_map<const pnnx::Operator*, uint32_t> indices;
+  for (uint32_t i = 0; i < pnnx_operators.size(); ++i) {
+    indices.insert({pnnx_operators.at(i), i});
+  }
+
+  for (uint32_t k = 0; k < pnnx_operators.size(); ++k) {
+    const pnnx::Operator* cat = pnnx_operators.at(k);
+    const auto& cat_op = operators.at(k);
+    if (cat->type != "torch.cat" || !cat->has_param("dim") || cat->params.at("dim").type != 2 ||
+        cat->outputs.size() != 1 || cat->outputs.front()->shape.size() != 4 ||
+        cat_op->layer == nullptr || cat_op->output_operands != nullptr) {
+      continue;
+    }
+    CatLayer::Axis axis = CatLayer::Axis::kChannel;
+    if (CatLayer::OperandDimToAxis(cat->params.at("dim").i, 4, axis) != StatusCode::kSuccess ||
+        axis != CatLayer::Axis::kChannel || !cat_op->layer->IsLayoutSupported(cat_op->layout)) {
+      continue;
+    }
+
+    uint32_t channel_offset = 0;
+    for (const pnnx::Operand* operand : cat->inputs) {
+      const auto& producer = indices.find(operand->producer);
+      if (producer != indices.end() && operand->consumers.size() == 1 &&
+          operand->shape.size() == 4 && operand->producer->outputs.size() == 1) {
+        const auto& producer_op = operators.at(producer->second);
+        // 图的输入由外部拷入, 不参与别名
+        if (producer_op->layer != nullptr && producer_op->output_operands == nullptr &&
+            producer_op->layout == cat_op->layout && producer_op->start_time >= 0) {
+          slices.at(producer->second) = {int32_t(k), channel_offset};
+        }
+      }
+      channel_offset += operand->shape.at(1);
+    }
+  }
+  return slices;
+}
+
+void RuntimeOperatorUtils<float>::InitOperatorOutput(
+    const std::vector<pnnx::Operator*>& pnnx_operators,
+    const std::vector<std::shared_ptr<RuntimeOperator>>& operators,
+    RuntimeMemoryPlan& memory_plan) {
   CHECK(!pnnx_operators.empty() && !operators.empty() && pnnx_operators.size() == operators.size());
   CHECK(pnnx_operators.size() == operators.size());
+  const int32_t last_time = int32_t(operators.size());
+
+  const std::vector<ConcatSlice> slices = PlanConcatSlices(pnnx_operators, operators);
+  std::vector<TensorLifetime> lifetimes;
+  std::vector<int32_t> lifetime_indices(operators.size(), -1);
+  std::vector<uint32_t> planned_operators;
+  std::vector<std::vector<int32_t>> planned_shapes;
+  std::vector<uint32_t> sliced_operators;
+  std::vector<std::vector<int32_t>> sliced_shapes;
+  size_t sliced_size = 0;
   for (uint32_t i = 0; i < pnnx_operators.size(); ++i) {
     const std::vector<pnnx::Operand*> operands = pnnx_operators[i]->outputs;
     if (operands.empty()) continue;
@@ -100,65 +185,130 @@ void RuntimeOperatorUtils<float>::InitOperatorOutput(
 
     size_t operand_size =
         std::accumulate(operand_shapes.begin(), operand_shapes.end(), 1, std::multiplies());
+    const uint32_t block_size = TensorLayoutBlockSize(runtime_op->layout);
+    if (block_size > 1) {
+      // 分块布局按块补齐通道
+      const size_t channels = operand_shapes.at(1);
+      operand_size = operand_size / channels * ((channels + block_size - 1) / block_size * block_size);
+    }
 
     const int32_t batch = operand_shapes[0];
     CHECK_EQ(operand->type, 1) << "The type of pnnx operand is not float32";
-    if (!output_tensors) {
-      bool has_found = false;
-      for (uint32_t j = 0; j < i; ++j) {
-        if (has_found) {
-          break;
-        }
-
-        const auto& prev_runtime_op = operators.at(j);
-        if (!prev_runtime_op->output_operands || prev_runtime_op->occur_end_time != -1) {
-          continue;
-        }
+    if (!output_tensors && slices.at(i).target >= 0) {
+      sliced_operators.push_back(i);
+      sliced_shapes.push_back(operand_shapes);
+      sliced_size += operand_size;
+    } else if (!output_tensors) {
+      // 未排序的算子不参与复用, 一直存活到最后
+      TensorLifetime lifetime;
+      lifetime.size = operand_size;
+      lifetime.start_time = runtime_op->start_time >= 0 ? runtime_op->start_time : int32_t(i);
+      lifetime.end_time = runtime_op->end_time >= 0 ? runtime_op->end_time : last_time;
 
-        if (runtime_op->start_time > prev_runtime_op->occur_end_time) {
-          prev_runtime_op->occur_end_time = -1;
-        }
-
-        if (runtime_op->start_time > prev_runtime_op->end_time) {
-          if (prev_runtime_op->output_operands->size() == operand_size) {
-            has_found = true;
-            const auto& prev_output_operand = prev_runtime_op->output_operands;
-            runtime_op->output_operands = std::make_shared<RuntimeOperand>(
-                prev_output_operand->name + "_output", operand_shapes, batch,
-                RuntimeDataType::kTypeFloat32);
-            const auto& prev_runtime_op_tensors = prev_output_operand->datas;
-            for (uint32_t b = 0; b < batch; ++b) {
-              sftensor prev_output_tensor = prev_runtime_op_tensors.at(b);
-              sftensor output_tensor = std::make_shared<ftensor>(prev_output_tensor->raw_ptr(),
-                                                                 prev_output_tensor->shapes());
-              CheckAndReshapeTensor(output_tensor, operand_shapes);
-              output_tensors->datas[b] = output_tensor;
-            }
-            prev_runtime_op->occur_end_time = runtime_op->end_time;
-          }
-        }
+      // 图的输入和输出对外可见, 不与其他张量共享内存
+      if (runtime_op->type == "pnnx.Input") {
+        lifetime.end_time = last_time;
       }
-
-      if (!has_found) {
-        std::vector<sftensor> output_operand_datas;
-        for (uint32_t j = 0; j < batch; ++j) {
-          output_operand_datas.push_back(CreateTensor(operand_shapes));
+      for (const auto& [_, output_op] : runtime_op->output_operators) {
+        if (output_op->type == "pnnx.Output") {
+          lifetime.start_time = 0;
+          lifetime.end_time = last_time;
         }
-        runtime_op->output_operands =
-            std::make_shared<RuntimeOperand>(operand->name + "_output", operand_shapes,
-                                             output_operand_datas, RuntimeDataType::kTypeFloat32);
       }
+
+      lifetime_indices.at(i) = int32_t(lifetimes.size());
+      lifetimes.push_back(lifetime);
+      planned_operators.push_back(i);
+      planned_shapes.push_back(operand_shapes);
     } else {
-      CHECK(batch == output_tensors->datas.size());
+      CHECK(size_t(batch) == output_tensors->datas.size());
       CHECK(output_tensors->type == RuntimeDataType::kTypeFloat32);
       CHECK(output_tensors->shapes == operand_shapes);
-      for (uint32_t b = 0; b < batch; ++b) {
+      for (int32_t b = 0; b < batch; ++b) {
         sftensor output_tensor = output_tensors->datas[b];
+        CHECK(output_tensor->layout() == runtime_op->layout);
         CheckAndReshapeTensor(output_tensor, operand_shapes);
       }
     }
   }
-}
 
+  if (lifetimes.empty()) {
+    return;
+  }
+
+  // 拼接输出从最早写入它的生产者开始存活, 可能经过多层拼接
+  for (uint32_t i : sliced_operators) {
+    uint32_t root = i;
+    while (slices.at(root).target >= 0) {
+      root = slices.at(root).target;
+    }
+    CHECK_GE(lifetime_indices.at(root), 0) << "Concat output " << operators.at(root)->name
+                                          << " is not planned";
+    TensorLifetime& lifetime = lifetimes.at(lifetime_indices.at(root));
+    lifetime.start_time = std::min(lifetime.start_time, operators.at(i)->start_time);
+  }
+
+  const size_t arena_size = PlanMemoryOffsets(lifetimes);
+  memory_plan.arena = CreateArena(arena_size);
+  memory_plan.planned_bytes = arena_size * sizeof(float);
+  memory_plan.naive_bytes = sliced_size * sizeof(float);
+  memory_plan.concat_slices = sliced_operators.size();
+  for (const TensorLifetime& lifetime : lifetimes) {
+    memory_plan.naive_bytes += lifetime.size * sizeof(float);
+  }
+
+  for (uint32_t k = 0; k < planned_operators.size(); ++k) {
+    const auto& runtime_op = operators.at(planned_operators.at(k));
+    const std::vector<int32_t>& operand_shapes = planned_shapes.at(k);
+    const TensorLifetime& lifetime = lifetimes.at(k);
+    const int32_t batch = operand_shapes[0];
+    const size_t sample_size = lifetime.size / batch;
+
+    // 整个批次在内存池中连续存放, 每个样本是其中的一个视图
+    std::shared_ptr<float> batch_data(memory_plan.arena, memory_plan.arena.get() + lifetime.offset);
+    std::vector<sftensor> output_operand_datas;
+    for (int32_t b = 0; b < batch; ++b) {
+      output_operand_datas.push_back(
+          CreateTensor(batch_data, batch_data.get() + b * sample_size, operand_shapes,
+                       runtime_op->layout));
+    }
+    runtime_op->output_operands =
+        std::make_shared<RuntimeOperand>(runtime_op->name + "_output", operand_shapes,
+                                         output_operand_datas, RuntimeDataType::kTypeFloat32);
+    runtime_op->output_operands->batch_data = std::move(batch_data);
+    runtime_op->output_operands->sample_size = sample_size;
+  }
+
+  // 先执行的生产者写入后执行的拼接算子, 倒序保证拼接输出先创建
+  std::vector<uint32_t> order(sliced_operators.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return operators.at(sliced_operators.at(a))->start_time >
+           operators.at(sliced_operators.at(b))->start_time;
+  });
+  for (uint32_t k : order) {
+    const auto& runtime_op = operators.at(sliced_operators.at(k));
+    const std::vector<int32_t>& operand_shapes = sliced_shapes.at(k);
+    const ConcatSlice& slice = slices.at(sliced_operators.at(k));
+    const auto& cat_output = operators.at(slice.target)->output_operands;
+    CHECK(cat_output != nullptr && cat_output->batch_data != nullptr)
+        << "Concat output " << operators.at(slice.target)->name << " is not created";
+
+    // 每个样本的通道段在拼接输出的对应样本中, 样本间隔与拼接输出相同
+    const size_t offset = size_t(slice.channel_offset) * operand_shapes.at(2) * operand_shapes.at(3);
+    std::shared_ptr<float> batch_data(cat_output->batch_data, cat_output->batch_data.get() + offset);
+    std::vector<sftensor> output_operand_datas;
+    for (uint32_t b = 0; b < uint32_t(operand_shapes[0]); ++b) {
+      output_operand_datas.push_back(CreateTensor(batch_data,
+                                                  batch_data.get() + b * cat_output->sample_size,
+                                                  operand_shapes, runtime_op->layout));
+    }
+    runtime_op->output_operands =
+        std::make_shared<RuntimeOperand>(runtime_op->name + "_output", operand_shapes,
+                                         output_operand_datas, RuntimeDataType::kTypeFloat32);
+    runtime_op->output_operands->batch_data = std::move(batch_data);
+    runtime_op->output_operands->sample_size = cat_output->sample_size;
+  }
 }
 
+}
\ No newline at end of file
@@ -1,13 +1,18 @@
 #include "runtime/pnnx/ir.h"
+#include "runtime/pnnx/store_zip.h"
 
 #include <limits.h>
 #include <stdint.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <stack>
+#include <thread>
 
 
 namespace pnnx {
@@ -207,24 +212,134 @@ static size_t type_to_elemsize(int type)
     return 0; // null
 }
 
-static int string_to_type(const char* s)
-{
-    if (strcmp(s, "f32") == 0) return 1;
-    if (strcmp(s, "f64") == 0) return 2;
-    if (strcmp(s, "f16") == 0) return 3;
-    if (strcmp(s, "i32") == 0) return 4;
-    if (strcmp(s, "i64") == 0) return 5;
-    if (strcmp(s, "i16") == 0) return 6;
-    if (strcmp(s, "i8") == 0) return 7;
-    if (strcmp(s, "u8") == 0) return 8;
-    if (strcmp(s, "bool") == 0) return 9;
-    if (strcmp(s, "c64") == 0) return 10;
-    if (strcmp(s, "c128") == 0) return 11;
-    if (strcmp(s, "c32") == 0) return 12;
-    if (strcmp(s, "bf16") == 0) return 13;
+static int string_to_type(std::string_view s)
+{
+    if (s == "f32") return 1;
+    if (s == "f64") return 2;
+    if (s == "f16") return 3;
+    if (s == "i32") return 4;
+    if (s == "i64") return 5;
+    if (s == "i16") return 6;
+    if (s == "i8") return 7;
+    if (s == "u8") return 8;
+    if (s == "bool") return 9;
+    if (s == "c64") return 10;
+    if (s == "c128") return 11;
+    if (s == "c32") return 12;
+    if (s == "bf16") return 13;
     return 0; // null
 }
 
+// the param text is tokenized in place, every token is a view into the
+// buffer and numbers are converted with from_chars, so no stream or
+// temporary string is created per line or per token
+
+static bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// cuts the next line off text, without the line break
+static bool next_line(std::string_view& text, std::string_view& line)
+{
+    if (text.empty())
+        return false;
+
+    size_t end = text.find('\n');
+    if (end == std::string_view::npos)
+    {
+        line = text;
+        text = std::string_view();
+        return true;
+    }
+
+    line = text.substr(0, end);
+    text.remove_prefix(end + 1);
+    return true;
+}
+
+// cuts the next blank separated token off line, empty at the end of the line
+static std::string_view next_token(std::string_view& line)
+{
+    size_t begin = 0;
+    while (begin < line.size() && is_blank(line[begin]))
+        begin++;
+
+    size_t end = begin;
+    while (end < line.size() && !is_blank(line[end]))
+        end++;
+
+    std::string_view token = line.substr(begin, end - begin);
+    line.remove_prefix(end);
+    return token;
+}
+
+// cuts the next comma separated element off list, false once list is used up
+// a trailing comma yields a last empty element
+static bool next_element(std::string_view& list, std::string_view& elem, bool& done)
+{
+    if (done)
+        return false;
+
+    size_t end = list.find(',');
+    if (end == std::string_view::npos)
+    {
+        elem = list;
+        done = true;
+        return true;
+    }
+
+    elem = list.substr(0, end);
+    list.remove_prefix(end + 1);
+    return true;
+}
+
+static int parse_int(std::string_view s)
+{
+    int v = 0;
+    std::from_chars(s.data(), s.data() + s.size(), v);
+    return v;
+}
+
+static float parse_float(std::string_view s)
+{
+    float v = 0.f;
+    std::from_chars(s.data(), s.data() + s.size(), v);
+    return v;
+}
+
+// text of a (...)type annotation: the list between the parentheses and the type after them
+static void split_annotation(std::string_view value, std::string_view& list, std::string_view& typestr)
+{
+    size_t close = value.find_last_of(')');
+    if (close == std::string_view::npos || value.empty())
+    {
+        list = std::string_view();
+        typestr = std::string_view();
+        return;
+    }
+
+    list = value.substr(1, close - 1);
+    typestr = value.substr(close + 1);
+}
+
+// numeric tokens start with a digit, or a minus and a digit
+static bool is_numeric(std::string_view s)
+{
+    if (s.empty())
+        return false;
+
+    if (s[0] == '-')
+        return s.size() > 1 && s[1] >= '0' && s[1] <= '9';
+
+    return s[0] >= '0' && s[0] <= '9';
+}
+
+static bool is_floating(std::string_view s)
+{
+    return s.find('.') != std::string_view::npos || s.find('e') != std::string_view::npos;
+}
+
 bool operator==(const Parameter& lhs, const Parameter& rhs)
 {
     if (lhs.type != rhs.type)
@@ -294,18 +409,28 @@ int Attribute::elemcount() const
     return size;
 }
 
+const char* Attribute::raw_data() const
+{
+    return mapped_data ? mapped_data.get() : data.data();
+}
+
+size_t Attribute::raw_size() const
+{
+    return mapped_data ? mapped_size : data.size();
+}
+
 std::vector<float> Attribute::get_float32_data() const
 {
     std::vector<float> v(elemcount());
 
     if (type == 1)
     {
-        memcpy((void*)v.data(), (const void*)data.data(), data.size());
+        memcpy((void*)v.data(), (const void*)raw_data(), raw_size());
     }
     else if (type == 2)
     {
         // f64
-        const double* p = (const double*)data.data();
+        const double* p = (const double*)raw_data();
         for (size_t i = 0; i < v.size(); i++)
         {
             v[i] = float(p[i]);
@@ -314,7 +439,7 @@ std::vector<float> Attribute::get_float32_data() const
     else if (type == 3)
     {
         // f16
-        const unsigned short* p = (const unsigned short*)data.data();
+        const unsigned short* p = (const unsigned short*)raw_data();
         for (size_t i = 0; i < v.size(); i++)
         {
             v[i] = float16_to_float32(p[i]);
@@ -330,6 +455,10 @@ std::vector<float> Attribute::get_float32_data() const
 
 void Attribute::set_float32_data(const std::vector<float>& newdata)
 {
+    // the mapped payload is read-only, the new data is owned
+    mapped_data.reset();
+    mapped_size = 0;
+
     data.resize(newdata.size() * elemsize());
 
     if (type == 1)
@@ -371,7 +500,7 @@ bool operator==(const Attribute& lhs, const Attribute& rhs)
     if (lhs.shape != rhs.shape)
         return false;
 
-    if (lhs.data != rhs.data)
+    if (lhs.raw_size() != rhs.raw_size() || memcmp(lhs.raw_data(), rhs.raw_data(), lhs.raw_size()) != 0)
         return false;
 
     return true;
@@ -406,20 +535,20 @@ Attribute operator+(const Attribute& a, const Attribute& b)
     c.shape = a.shape;
     c.shape[0] += b.shape[0]; // concat the first dim
 
-    c.data.resize(a.data.size() + b.data.size());
-    memcpy(c.data.data(), a.data.data(), a.data.size());
-    memcpy(c.data.data() + a.data.size(), b.data.data(), b.data.size());
+    c.data.resize(a.raw_size() + b.raw_size());
+    memcpy(c.data.data(), a.raw_data(), a.raw_size());
+    memcpy(c.data.data() + a.raw_size(), b.raw_data(), b.raw_size());
 
     return c;
 }
 
-Parameter Parameter::parse_from_string(const std::string& value)
+static Parameter parse_parameter(std::string_view value)
 {
-    if (value.find('%') != std::string::npos)
+    if (value.find('%') != std::string_view::npos)
     {
         Parameter p;
         p.type = 4;
-        p.s = value;
+        p.s = std::string(value);
         return p;
     }
 
@@ -439,61 +568,63 @@ Parameter Parameter::parse_from_string(const std::string& value)
         return p;
     }
 
-    if (value[0] == '(' || value[0] == '[')
+    if (!value.empty() && (value[0] == '(' || value[0] == '['))
     {
         // list
-        std::string lc = value.substr(1, value.size() - 2);
-        std::istringstream lcss(lc);
-
-        while (!lcss.eof())
+        std::string_view lc = value.substr(1, value.size() - 2);
+        std::string_view elem;
+        bool done = false;
+        while (next_element(lc, elem, done))
         {
-            std::string elem;
-            std::getline(lcss, elem, ',');
-
-            if ((elem[0] != '-' && (elem[0] < '0' || elem[0] > '9')) || (elem[0] == '-' && (elem[1] < '0' || elem[1] > '9')))
+            if (!is_numeric(elem))
             {
                 // string
                 p.type = 7;
-                p.as.push_back(elem);
+                p.as.push_back(std::string(elem));
             }
-            else if (elem.find('.') != std::string::npos || elem.find('e') != std::string::npos)
+            else if (is_floating(elem))
             {
                 // float
                 p.type = 6;
-                p.af.push_back(std::stof(elem));
+                p.af.push_back(parse_float(elem));
             }
             else
             {
                 // integer
                 p.type = 5;
-                p.ai.push_back(std::stoi(elem));
+                p.ai.push_back(parse_int(elem));
             }
         }
         return p;
     }
 
-    if ((value[0] != '-' && (value[0] < '0' || value[0] > '9')) || (value[0] == '-' && (value[1] < '0' || value[1] > '9')))
+    if (!is_numeric(value))
     {
         // string
         p.type = 4;
-        p.s = value;
+        p.s = std::string(value);
         return p;
     }
 
-    if (value.find('.') != std::string::npos || value.find('e') != std::string::npos)
+    if (is_floating(value))
     {
         // float
         p.type = 3;
-        p.f = std::stof(value);
+        p.f = parse_float(value);
         return p;
     }
 
     // integer
     p.type = 2;
-    p.i = std::stoi(value);
+    p.i = parse_int(value);
     return p;
 }
 
+Parameter Parameter::parse_from_string(const std::string& value)
+{
+    return parse_parameter(value);
+}
+
 std::string Parameter::encode_to_string(const Parameter& param)
 {
     if (param.type == 0)
@@ -646,12 +777,12 @@ Graph& Graph::operator=(const Graph& /*rhs*/)
     return *this;
 }
 
-static void load_parameter(Operator* op, const std::string& key, const std::string& value)
+static void load_parameter(Operator* op, std::string_view key, std::string_view value)
 {
-    op->params[key] = Parameter::parse_from_string(value);
+    op->params[std::string(key)] = parse_parameter(value);
 }
 
-static void load_input_key(Operator* op, const std::string& key, const std::string& value)
+static void load_input_key(Operator* op, std::string_view key, std::string_view value)
 {
     op->inputnames.resize(op->inputs.size());
 
@@ -660,27 +791,50 @@ static void load_input_key(Operator* op, const std::string& key, const std::stri
         const Operand* oprand = op->inputs[i];
         if (oprand->name == value)
         {
-            op->inputnames[i] = key;
+            op->inputnames[i] = std::string(key);
             break;
         }
     }
 }
 
-static void load_shape(Operator* op, const std::string& key, const std::string& value)
+// shape list of an operand or attribute annotation, ? is dynamic and %abc symbolic
+static void load_shape_list(std::string_view lc, std::vector<int>& shape, std::map<std::string, Parameter>& params)
 {
-    Operand* operand = 0;
-    for (auto r : op->inputs)
+    shape.clear();
+    if (lc.empty())
+        return;
+
+    std::string_view elem;
+    bool done = false;
+    while (next_element(lc, elem, done))
     {
-        if (r->name == key)
+        if (elem == "?")
         {
-            operand = r;
-            break;
+            shape.push_back(-1);
+        }
+        else if (!elem.empty() && elem[0] == '%')
+        {
+            // encode %abc as symbolic tag
+            shape.push_back(-233);
+            int index = shape.size() - 1;
+            params[std::string("__shape__") + std::to_string(index)] = std::string(elem.substr(1));
+        }
+        else
+        {
+            shape.push_back(parse_int(elem));
         }
     }
+}
 
-    if (!operand)
+static void load_shape(Graph& graph, Operator* op, const std::string& key, std::string_view value)
+{
+    // the operator of the line being parsed is the producer or the latest consumer of its operands,
+    // scan the operator only when the index points elsewhere
+    Operand* operand = graph.get_operand(key);
+    if (operand && operand->producer != op && (operand->consumers.empty() || operand->consumers.back() != op))
     {
-        for (auto r : op->outputs)
+        operand = 0;
+        for (auto r : op->inputs)
         {
             if (r->name == key)
             {
@@ -688,6 +842,11 @@ static void load_shape(Operator* op, const std::string& key, const std::string&
                 break;
             }
         }
+        for (size_t i = 0; !operand && i < op->outputs.size(); i++)
+        {
+            if (op->outputs[i]->name == key)
+                operand = op->outputs[i];
+        }
     }
 
     if (!operand)
@@ -696,63 +855,46 @@ static void load_shape(Operator* op, const std::string& key, const std::string&
         return;
     }
 
+    std::string_view lc;
+    std::string_view typestr;
+    split_annotation(value, lc, typestr);
+
     // type
-    std::string typestr = value.substr(value.find_last_of(')') + 1);
-    operand->type = string_to_type(typestr.c_str());
+    operand->type = string_to_type(typestr);
 
     // shape
-    std::string lc = value.substr(1, value.find_last_of(')') - 1);
-    std::istringstream lcss(lc);
-
-    operand->shape.clear();
-    while (!lcss.eof())
-    {
-        std::string elem;
-        std::getline(lcss, elem, ',');
-
-        if (elem == "?")
-        {
-            operand->shape.push_back(-1);
-        }
-        else if (elem[0] == '%')
-        {
-            // encode %abc as symbolic tag
-            operand->shape.push_back(-233);
-            int index = operand->shape.size() - 1;
-            std::string key = elem.substr(1);
-            operand->params[std::string("__shape__") + std::to_string(index)] = key;
-        }
-        else
-        {
-            int i = std::stoi(elem);
-            operand->shape.push_back(i);
-        }
-    }
+    load_shape_list(lc, operand->shape, operand->params);
 }
 
-static void load_attribute(Operator* op, const std::string& key, const std::string& value, StoreZipReader& szr)
+// attribute data read after the whole graph is parsed
+struct AttributeLoad
 {
-    Attribute& a = op->attrs[key];
+    Attribute* attribute;
+    std::string filename;
+    size_t bytesize;
+};
+
+static void load_attribute(Operator* op, std::string_view key, std::string_view value, const StoreZipReader& szr, std::vector<AttributeLoad>& loads)
+{
+    Attribute& a = op->attrs[std::string(key)];
+
+    std::string_view lc;
+    std::string_view typestr;
+    split_annotation(value, lc, typestr);
 
     // type
-    std::string typestr = value.substr(value.find_last_of(')') + 1);
-    a.type = string_to_type(typestr.c_str());
+    a.type = string_to_type(typestr);
 
     if (a.type == 0)
         return;
 
     // shape
-    std::string lc = value.substr(1, value.find_last_of(')') - 1);
-    std::istringstream lcss(lc);
-
     a.shape.clear();
-    while (!lcss.eof())
+    std::string_view elem;
+    bool done = lc.empty();
+    while (next_element(lc, elem, done))
     {
-        std::string elem;
-        std::getline(lcss, elem, ',');
-
-        int i = std::stoi(elem);
-        a.shape.push_back(i);
+        a.shape.push_back(parse_int(elem));
     }
 
     if (a.shape.empty())
@@ -767,7 +909,7 @@ static void load_attribute(Operator* op, const std::string& key, const std::stri
 
     size_t bytesize = size * type_to_elemsize(a.type);
 
-    std::string filename = op->name + "." + key;
+    std::string filename = op->name + "." + std::string(key);
 
     size_t filesize = szr.get_file_size(filename);
 
@@ -782,106 +924,193 @@ static void load_attribute(Operator* op, const std::string& key, const std::stri
         fprintf(stderr, "file size not match expect %lu but got %lu\n", bytesize, filesize);
     }
 
-    a.data.resize(bytesize);
-    szr.read_file(filename, (char*)a.data.data());
+    AttributeLoad load;
+    load.attribute = &a;
+    load.filename = filename;
+    load.bytesize = bytesize;
+    loads.push_back(load);
 }
 
-int Graph::load(const std::string& parampath, const std::string& binpath)
+static int load_attribute_data(const AttributeLoad& load, const StoreZipReader& szr)
 {
-    std::ifstream is(parampath, std::ios::in | std::ios::binary);
-    if (!is.good())
+    Attribute& a = *load.attribute;
+
+    if (szr.get_file_size(load.filename) >= load.bytesize)
     {
-        fprintf(stderr, "open failed\n");
-        return -1;
+        // use the stored payload in place, no copy, and let the kernel read it ahead
+        a.mapped_data = szr.map_file(load.filename);
+        if (a.mapped_data)
+        {
+            a.mapped_size = load.bytesize;
+            szr.prefetch_file(load.filename);
+            return 0;
+        }
     }
 
-    StoreZipReader szr;
-    if (szr.open(binpath) != 0)
+    a.data.resize(load.bytesize);
+    return szr.read_file(load.filename, (char*)a.data.data());
+}
+
+// reads all attribute data from a pool of threads, the reads are positional
+// and the attributes already exist, so the threads share nothing but the index
+// and the failure flag, returns -1 if any read failed
+static int load_attributes_data(const std::vector<AttributeLoad>& loads, const StoreZipReader& szr)
+{
+    const size_t max_thread_count = 16;
+    size_t thread_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), max_thread_count);
+    thread_count = std::min(thread_count, loads.size());
+#if defined(_WIN32)
+    // the fallback read shares one file cursor
+    thread_count = std::min<size_t>(thread_count, 1);
+#endif
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    auto worker = [&]() {
+        for (size_t i = next++; i < loads.size() && !failed; i = next++)
+        {
+            if (load_attribute_data(loads[i], szr) != 0)
+                failed = true;
+        }
+    };
+
+    if (thread_count <= 1)
     {
-        fprintf(stderr, "open failed\n");
-        return -1;
+        worker();
+        return failed ? -1 : 0;
     }
 
-    int magic = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; i++)
     {
-        std::string line;
-        std::getline(is, line);
-        std::istringstream iss(line);
+        threads.emplace_back(worker);
+    }
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
 
-        iss >> magic;
+    return failed ? -1 : 0;
+}
+
+// attribute of Graph::parse, only declared, its data is not loaded
+static void load_attribute_declaration(Operator* op, std::string_view key, std::string_view value)
+{
+    Attribute& attr = op->attrs[std::string(key)];
+    attr = Attribute();
+
+    attr.type = 0;
+    if (value.empty())
+        return;
+
+    if (value[0] == '%')
+    {
+        // @data=%op1.data
+        attr.data = std::vector<char>(value.begin(), value.end());
+    }
+
+    if (value[0] == '(')
+    {
+        // @data=(1,%c,?,4)f32
+        std::string_view lc;
+        std::string_view typestr;
+        split_annotation(value, lc, typestr);
+
+        // type
+        attr.type = string_to_type(typestr);
+
+        // shape
+        load_shape_list(lc, attr.shape, attr.params);
+    }
+}
+
+// parses the param text into graph, attribute data is read from szr into
+// loads when szr is given, otherwise attributes are only declared
+static int load_param(Graph& graph, std::string_view text, const StoreZipReader* szr, std::vector<AttributeLoad>* loads)
+{
+    std::string_view line;
+
+    int magic = 0;
+    if (next_line(text, line))
+    {
+        magic = parse_int(next_token(line));
     }
+    (void)magic;
 
     int operator_count = 0;
     int operand_count = 0;
+    if (next_line(text, line))
     {
-        std::string line;
-        std::getline(is, line);
-        std::istringstream iss(line);
-
-        iss >> operator_count >> operand_count;
+        operator_count = parse_int(next_token(line));
+        operand_count = parse_int(next_token(line));
     }
+    (void)operand_count;
+
+    // reused for operand lookups, keeps its capacity across lines
+    std::string operand_name;
+    operand_name.reserve(64);
 
     for (int i = 0; i < operator_count; i++)
     {
-        std::string line;
-        std::getline(is, line);
-        std::istringstream iss(line);
-
-        std::string type;
-        std::string name;
-        int input_count = 0;
-        int output_count = 0;
+        if (!next_line(text, line))
+        {
+            fprintf(stderr, "expect %d operators but got %d\n", operator_count, i);
+            return -1;
+        }
 
-        iss >> type >> name >> input_count >> output_count;
+        std::string_view type = next_token(line);
+        std::string_view name = next_token(line);
+        int input_count = parse_int(next_token(line));
+        int output_count = parse_int(next_token(line));
 
-        Operator* op = new_operator(type, name);
+        Operator* op = graph.new_operator(std::string(type), std::string(name));
 
         for (int j = 0; j < input_count; j++)
         {
-            std::string operand_name;
-            iss >> operand_name;
+            operand_name.assign(next_token(line));
 
-            Operand* r = get_operand(operand_name);
+            Operand* r = graph.get_operand(operand_name);
+            if (!r)
+            {
+                fprintf(stderr, "no such operand %s for operator %s\n", operand_name.c_str(), op->name.c_str());
+                return -1;
+            }
             r->consumers.push_back(op);
             op->inputs.push_back(r);
         }
 
         for (int j = 0; j < output_count; j++)
         {
-            std::string operand_name;
-            iss >> operand_name;
-
-            Operand* r = new_operand(operand_name);
+            Operand* r = graph.new_operand(std::string(next_token(line)));
             r->producer = op;
             op->outputs.push_back(r);
         }
 
         // key=value
-        while (!iss.eof())
+        for (std::string_view param = next_token(line); !param.empty(); param = next_token(line))
         {
-            std::string param;
-            iss >> param;
-
-            std::string key;
-            std::string value;
-            std::istringstream pss(param);
-            std::getline(pss, key, '=');
-            std::getline(pss, value);
+            size_t eq = param.find('=');
+            std::string_view key = param.substr(0, eq);
+            std::string_view value = eq == std::string_view::npos ? std::string_view() : param.substr(eq + 1);
 
-            if (key[0] == '@')
+            if (!key.empty() && key[0] == '@')
             {
                 // attribute
-                load_attribute(op, key.substr(1), value, szr);
+                if (szr)
+                    load_attribute(op, key.substr(1), value, *szr, *loads);
+                else
+                    load_attribute_declaration(op, key.substr(1), value);
             }
-            else if (key[0] == '$')
+            else if (!key.empty() && key[0] == '$')
             {
                 // operand input key
                 load_input_key(op, key.substr(1), value);
             }
-            else if (key[0] == '#')
+            else if (!key.empty() && key[0] == '#')
             {
                 // operand shape
-                load_shape(op, key.substr(1), value);
+                operand_name.assign(key.substr(1));
+                load_shape(graph, op, operand_name, value);
             }
             else
             {
@@ -894,6 +1123,54 @@ int Graph::load(const std::string& parampath, const std::string& binpath)
     return 0;
 }
 
+int Graph::load(const std::string& parampath, const std::string& binpath)
+{
+    // the whole param file in one buffer, tokenized in place
+    std::string param;
+    {
+        FILE* fp = fopen(parampath.c_str(), "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "open failed\n");
+            return -1;
+        }
+
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        param.resize(size > 0 ? size : 0);
+        size_t nread = param.empty() ? 0 : fread((char*)param.data(), 1, param.size(), fp);
+        fclose(fp);
+
+        if (nread != param.size())
+        {
+            fprintf(stderr, "read %s failed\n", parampath.c_str());
+            return -1;
+        }
+    }
+
+    StoreZipReader szr;
+    if (szr.open(binpath) != 0)
+    {
+        fprintf(stderr, "open failed\n");
+        return -1;
+    }
+
+    // parse the graph first, then read all attribute data at once
+    std::vector<AttributeLoad> attribute_loads;
+    int ret = load_param(*this, param, &szr, &attribute_loads);
+    if (ret != 0)
+        return ret;
+
+    if (load_attributes_data(attribute_loads, szr) != 0)
+    {
+        fprintf(stderr, "load attribute data failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
 int Graph::save(const std::string& parampath, const std::string& binpath)
 {
     FILE* paramfp = fopen(parampath.c_str(), "wb");
@@ -956,7 +1233,7 @@ int Graph::save(const std::string& parampath, const std::string& binpath)
             fprintf(paramfp, type_to_string(attr.type));
 
             std::string filename = op->name + "." + it.first;
-            szw.write_file(filename, attr.data.data(), attr.data.size());
+            szw.write_file(filename, attr.raw_data(), attr.raw_size());
         }
 
         if (op->inputnames.size() == op->inputs.size())
@@ -2737,154 +3014,7 @@ int Graph::python(const std::string& pypath, const std::string& pnnxbinpath)
 
 int Graph::parse(const std::string& param)
 {
-    std::istringstream is(param);
-    if (!is.good())
-    {
-        fprintf(stderr, "open failed\n");
-        return -1;
-    }
-
-    int magic = 0;
-    {
-        std::string line;
-        std::getline(is, line);
-        std::istringstream iss(line);
-
-        iss >> magic;
-    }
-
-    int operator_count = 0;
-    int operand_count = 0;
-    {
-        std::string line;
-        std::getline(is, line);
-        std::istringstream iss(line);
-
-        iss >> operator_count >> operand_count;
-    }
-
-    for (int i = 0; i < operator_count; i++)
-    {
-        std::string line;
-        std::getline(is, line);
-        std::istringstream iss(line);
-
-        std::string type;
-        std::string name;
-        int input_count = 0;
-        int output_count = 0;
-
-        iss >> type >> name >> input_count >> output_count;
-
-        Operator* op = new_operator(type, name);
-
-        for (int j = 0; j < input_count; j++)
-        {
-            std::string operand_name;
-            iss >> operand_name;
-
-            Operand* r = get_operand(operand_name);
-            r->consumers.push_back(op);
-            op->inputs.push_back(r);
-        }
-
-        for (int j = 0; j < output_count; j++)
-        {
-            std::string operand_name;
-            iss >> operand_name;
-
-            Operand* r = new_operand(operand_name);
-            r->producer = op;
-            op->outputs.push_back(r);
-        }
-
-        // key=value
-        while (!iss.eof())
-        {
-            std::string param;
-            iss >> param;
-
-            std::string key;
-            std::string value;
-            std::istringstream pss(param);
-            std::getline(pss, key, '=');
-            std::getline(pss, value);
-
-            if (key[0] == '@')
-            {
-                // attribute
-                //                 load_attribute(op, key.substr(1), value, szr);
-                op->attrs[key.substr(1)] = Attribute();
-
-                Attribute& attr = op->attrs[key.substr(1)];
-
-                attr.type = 0;
-                if (value.empty())
-                    continue;
-
-                if (value[0] == '%')
-                {
-                    // @data=%op1.data
-                    attr.data = std::vector<char>(value.begin(), value.end());
-                }
-
-                if (value[0] == '(')
-                {
-                    // @data=(1,%c,?,4)f32
-
-                    // type
-                    std::string typestr = value.substr(value.find_last_of(')') + 1);
-                    attr.type = string_to_type(typestr.c_str());
-
-                    // shape
-                    std::string lc = value.substr(1, value.find_last_of(')') - 1);
-                    std::istringstream lcss(lc);
-
-                    attr.shape.clear();
-                    while (!lcss.eof())
-                    {
-                        std::string elem;
-                        std::getline(lcss, elem, ',');
-
-                        if (elem == "?")
-                        {
-                            attr.shape.push_back(-1);
-                        }
-                        else if (elem[0] == '%')
-                        {
-                            // encode %abc as symbolic tag
-                            attr.shape.push_back(-233);
-                            int index = attr.shape.size() - 1;
-                            std::string key = elem.substr(1);
-                            attr.params[std::string("__shape__") + std::to_string(index)] = key;
-                        }
-                        else
-                        {
-                            int i = std::stoi(elem);
-                            attr.shape.push_back(i);
-                        }
-                    }
-                }
-            }
-            else if (key[0] == '$')
-            {
-                // operand input key
-                load_input_key(op, key.substr(1), value);
-            }
-            else if (key[0] == '#')
-            {
-                // operand shape
-                load_shape(op, key.substr(1), value);
-            }
-            else
-            {
-                // parameter
-                load_parameter(op, key, value);
-            }
-        }
-    }
-
-    return 0;
+    return load_param(*this, param, 0, 0);
 }
 
 void Operand::remove_consumer(const Operator* c)
@@ -2925,30 +3055,70 @@ Operand* Graph::new_operand(const std::string& name)
 {
     Operand* r = new Operand;
     r->name = name;
+    operand_index.emplace(name, operands.size());
     operands.push_back(r);
     return r;
 }
 
 Operand* Graph::get_operand(const std::string& name)
 {
-    for (Operand* r : operands)
+    size_t i = operand_position(name);
+    return i < operands.size() ? operands[i] : 0;
+}
+
+const Operand* Graph::get_operand(const std::string& name) const
+{
+    size_t i = operand_position(name);
+    return i < operands.size() ? operands[i] : 0;
+}
+
+void Graph::delete_operand(Operand* r)
+{
+    size_t i = operand_position(r->name);
+    if (i >= operands.size() || operands[i] != r)
     {
-        if (r->name == name)
-            return r;
+        // an operand sharing its name with an earlier one is not indexed
+        i = std::find(operands.begin(), operands.end(), r) - operands.begin();
+    }
+    else
+    {
+        operand_index.erase(r->name);
     }
 
-    return 0;
+    if (i < operands.size())
+    {
+        // move the last operand into the hole
+        Operand* last = operands.back();
+        operands[i] = last;
+        operands.pop_back();
+        if (last != r)
+        {
+            std::unordered_map<std::string, size_t>::iterator it = operand_index.find(last->name);
+            if (it != operand_index.end() && it->second == operands.size())
+                it->second = i;
+        }
+    }
+
+    delete r;
 }
 
-const Operand* Graph::get_operand(const std::string& name) const
+size_t Graph::operand_position(const std::string& name) const
 {
-    for (const Operand* r : operands)
+    std::unordered_map<std::string, size_t>::const_iterator it = operand_index.find(name);
+    if (it != operand_index.end() && it->second < operands.size() && operands[it->second]->name == name)
+        return it->second;
+
+    // operands pushed to or erased from operands directly invalidate their entries
+    for (size_t i = 0; i < operands.size(); i++)
     {
-        if (r->name == name)
-            return r;
+        if (operands[i]->name == name)
+        {
+            operand_index[name] = i;
+            return i;
+        }
     }
 
-    return 0;
+    return operands.size();
 }
 
 } // namespace pnnx
\ No newline at end of file
@@ -2,10 +2,16 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
-#include "runtime/pnnx/store_zip.h"
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace pnnx {
 
@@ -119,6 +125,7 @@ static uint32_t CRC32_buffer(const unsigned char* data, uint64_t len)
 StoreZipReader::StoreZipReader()
 {
     fp = 0;
+    mapping_size = 0;
 }
 
 StoreZipReader::~StoreZipReader()
@@ -137,6 +144,21 @@ int StoreZipReader::open(const std::string& path)
         return -1;
     }
 
+#if !defined(_WIN32)
+    // stored entries are uncompressed, map the archive so they can be used in place
+    struct stat st;
+    if (fstat(fileno(fp), &st) == 0 && st.st_size > 0)
+    {
+        const size_t mapsize = st.st_size;
+        void* ptr = mmap(0, mapsize, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+        if (ptr != MAP_FAILED)
+        {
+            mapping = std::shared_ptr<const char>((const char*)ptr, [mapsize](const char* p) { munmap((void*)p, mapsize); });
+            mapping_size = mapsize;
+        }
+    }
+#endif
+
     while (!feof(fp))
     {
         // peek signature
@@ -183,8 +205,8 @@ int StoreZipReader::open(const std::string& path)
                     if (extra_id != 0x0001)
                     {
                         // skip this extra field block
-                        fseek(fp, extra_size - 4, SEEK_CUR);
-                        extra_offset += extra_size;
+                        fseek(fp, extra_size, SEEK_CUR);
+                        extra_offset += 4 + extra_size;
                         continue;
                     }
 
@@ -197,8 +219,12 @@ int StoreZipReader::open(const std::string& path)
 
                     // skip remaining extra field blocks
                     fseek(fp, lfh.extra_field_length - extra_offset - 4 - sizeof(zip64_eef), SEEK_CUR);
+                    extra_offset = lfh.extra_field_length;
                     break;
                 }
+
+                if (extra_offset < lfh.extra_field_length)
+                    fseek(fp, lfh.extra_field_length - extra_offset, SEEK_CUR);
             }
             else
             {
@@ -283,25 +309,93 @@ uint64_t StoreZipReader::get_file_size(const std::string& name) const
     return filemetas.at(name).size;
 }
 
-int StoreZipReader::read_file(const std::string& name, char* data)
+int StoreZipReader::read_file(const std::string& name, char* data) const
 {
-    if (filemetas.find(name) == filemetas.end())
+    std::map<std::string, StoreZipMeta>::const_iterator it = filemetas.find(name);
+    if (it == filemetas.end())
     {
         fprintf(stderr, "no such file %s\n", name.c_str());
         return -1;
     }
 
-    uint64_t offset = filemetas[name].offset;
-    uint64_t size = filemetas[name].size;
+    uint64_t offset = it->second.offset;
+    uint64_t size = it->second.size;
+
+    if (mapping)
+    {
+        if (offset > mapping_size || size > mapping_size - offset)
+        {
+            fprintf(stderr, "file %s is out of the archive\n", name.c_str());
+            return -1;
+        }
+
+        memcpy(data, mapping.get() + offset, size);
+        return 0;
+    }
 
+#if !defined(_WIN32)
+    // pread leaves the shared file cursor alone
+    uint64_t nread = 0;
+    while (nread < size)
+    {
+        ssize_t n = pread(fileno(fp), data + nread, size - nread, offset + nread);
+        if (n <= 0)
+        {
+            fprintf(stderr, "read %s failed\n", name.c_str());
+            return -1;
+        }
+        nread += n;
+    }
+#else
     fseek(fp, offset, SEEK_SET);
-    fread(data, size, 1, fp);
+    if (size > 0 && fread(data, size, 1, fp) != 1)
+    {
+        fprintf(stderr, "read %s failed\n", name.c_str());
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+
+std::shared_ptr<const char> StoreZipReader::map_file(const std::string& name) const
+{
+    std::map<std::string, StoreZipMeta>::const_iterator it = filemetas.find(name);
+    if (!mapping || it == filemetas.end())
+        return std::shared_ptr<const char>();
+
+    if (it->second.offset > mapping_size || it->second.size > mapping_size - it->second.offset)
+    {
+        fprintf(stderr, "file %s is out of the archive\n", name.c_str());
+        return std::shared_ptr<const char>();
+    }
+
+    return std::shared_ptr<const char>(mapping, mapping.get() + it->second.offset);
+}
+
+int StoreZipReader::prefetch_file(const std::string& name) const
+{
+    std::map<std::string, StoreZipMeta>::const_iterator it = filemetas.find(name);
+    if (!mapping || it == filemetas.end())
+        return -1;
+
+#if !defined(_WIN32)
+    // madvise wants a page aligned start, the mapping itself starts on a page
+    const uint64_t pagesize = sysconf(_SC_PAGESIZE);
+    const uint64_t begin = it->second.offset / pagesize * pagesize;
+    const uint64_t end = std::min(it->second.offset + it->second.size, mapping_size);
+    if (end > begin)
+        madvise((void*)(mapping.get() + begin), end - begin, MADV_WILLNEED);
+#endif
 
     return 0;
 }
 
 int StoreZipReader::close()
 {
+    mapping.reset();
+    mapping_size = 0;
+
     if (!fp)
         return 0;
 
@@ -314,6 +408,7 @@ int StoreZipReader::close()
 StoreZipWriter::StoreZipWriter()
 {
     fp = 0;
+    alignment = 0;
 
     CRC32_TABLE_INIT();
 }
@@ -323,10 +418,12 @@ StoreZipWriter::~StoreZipWriter()
     close();
 }
 
-int StoreZipWriter::open(const std::string& path)
+int StoreZipWriter::open(const std::string& path, int _alignment)
 {
     close();
 
+    alignment = _alignment;
+
     fp = fopen(path.c_str(), "wb");
     if (!fp)
     {
@@ -369,6 +466,19 @@ int StoreZipWriter::write_file(const std::string& name, const char* data, uint64
 
     lfh.extra_field_length = sizeof(extra_id) + sizeof(extra_size) + sizeof(zip64_eef);
 
+    // pad with one more extra field block so that the data starts aligned
+    // the block takes at least its 4 byte header, a shorter gap grows by one alignment
+    uint16_t padding = 0;
+    if (alignment > 1)
+    {
+        uint64_t data_offset = offset + sizeof(signature) + sizeof(lfh) + name.size() + lfh.extra_field_length;
+        padding = (alignment - data_offset % alignment) % alignment;
+        while (padding > 0 && padding < 4)
+            padding += alignment;
+
+        lfh.extra_field_length += padding;
+    }
+
     fwrite((char*)&lfh, sizeof(lfh), 1, fp);
 
     fwrite((char*)name.c_str(), name.size(), 1, fp);
@@ -377,6 +487,23 @@ int StoreZipWriter::write_file(const std::string& name, const char* data, uint64
     fwrite((char*)&extra_size, sizeof(extra_size), 1, fp);
     fwrite((char*)&zip64_eef, sizeof(zip64_eef), 1, fp);
 
+    if (padding > 0)
+    {
+        // same block id as zipalign, the data holds the alignment followed by zeros
+        uint16_t padding_id = 0xd935;
+        uint16_t padding_size = padding - 4;
+        std::vector<char> padding_data(padding_size, 0);
+        if (padding_size >= sizeof(uint16_t))
+        {
+            uint16_t padding_alignment = alignment;
+            memcpy(padding_data.data(), &padding_alignment, sizeof(padding_alignment));
+        }
+
+        fwrite((char*)&padding_id, sizeof(padding_id), 1, fp);
+        fwrite((char*)&padding_size, sizeof(padding_size), 1, fp);
+        fwrite(padding_data.data(), padding_data.size(), 1, fp);
+    }
+
     fwrite(data, size, 1, fp);
 
     StoreZipMeta szm;
@@ -0,0 +1,129 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include "data/activation.h"
+#include "layer/activation.h"
+#include "layer/layer_factory.h"
+
+namespace {
+double ReferenceActivation(kuiper_infer::ActivationType type, double x, double alpha,
+                           double beta) {
+  using kuiper_infer::ActivationType;
+  switch (type) {
+    case ActivationType::kRelu:
+      return std::max(x, 0.);
+    case ActivationType::kLeakyRelu:
+      return x >= 0. ? x : alpha * x;
+    case ActivationType::kSigmoid:
+      return 1. / (1. + std::exp(-x));
+    case ActivationType::kTanh:
+      return std::tanh(x);
+    case ActivationType::kSilu:
+      return x / (1. + std::exp(-x));
+    case ActivationType::kGelu:
+      return 0.5 * x * (1. + std::erf(x / std::sqrt(2.)));
+    case ActivationType::kGeluTanh:
+      return 0.5 * x * (1. + std::tanh(std::sqrt(2. / M_PI) * (x + 0.044715 * x * x * x)));
+    case ActivationType::kHardSwish:
+      return x * std::min(std::max(x + 3., 0.), 6.) / 6.;
+    case ActivationType::kClip:
+      return std::min(std::max(x, alpha), beta);
+    default:
+      return x;
+  }
+}
+}  // namespace
+
+TEST(test_activation, error_bounds) {
+  using namespace kuiper_infer;
+  // 奇数长度, 覆盖向量部分和标量尾部
+  std::vector<float> inputs;
+  for (float x = -20.f; x <= 20.f; x += 0.0013f) {
+    inputs.push_back(x);
+  }
+  inputs.push_back(0.f);
+  std::vector<float> outputs(inputs.size());
+
+  const float alpha = 0.1f;
+  const float beta = 6.f;
+  struct Bound {
+    ActivationType type;
+    double abs_error;
+    bool scaled;
+  };
+  const std::vector<Bound> bounds = {
+      {ActivationType::kRelu, 0., false},       {ActivationType::kLeakyRelu, 1e-6, true},
+      {ActivationType::kSigmoid, 2e-7, false},  {ActivationType::kTanh, 2e-6, false},
+      {ActivationType::kSilu, 1e-6, true},      {ActivationType::kGelu, 1e-6, true},
+      {ActivationType::kGeluTanh, 2e-6, true},  {ActivationType::kHardSwish, 1e-6, true},
+      {ActivationType::kClip, 0., false},
+  };
+  for (const Bound& bound : bounds) {
+    ActivationForward(bound.type, inputs.data(), outputs.data(), inputs.size(), alpha, beta);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      const double x = inputs.at(i);
+      const double expected = ReferenceActivation(bound.type, x, alpha, beta);
+      const double tolerance =
+          bound.scaled ? bound.abs_error * std::max(1., std::abs(x)) : bound.abs_error;
+      ASSERT_LE(std::abs(outputs.at(i) - expected), tolerance)
+          << "activation " << int(bound.type) << " at " << x;
+    }
+  }
+}
+
+TEST(test_activation, in_place_tensor) {
+  using namespace kuiper_infer;
+  const auto& tensor = std::make_shared<ftensor>(3, 7, 5);
+  tensor->randn();
+  const ftensor source(*tensor);
+  ActivationForward(ActivationType::kRelu, tensor, tensor);
+  for (uint32_t i = 0; i < tensor->size(); ++i) {
+    ASSERT_EQ(tensor->index(i), std::max(source.index(i), 0.f));
+  }
+}
+
+TEST(test_activation, residual) {
+  using namespace kuiper_infer;
+  const size_t size = 40000 + 3;
+  std::vector<float> input(size);
+  std::vector<float> residual(size);
+  for (size_t i = 0; i < size; ++i) {
+    input.at(i) = std::sin(float(i) * 0.37f) * 4.f;
+    residual.at(i) = std::cos(float(i) * 0.11f) * 3.f;
+  }
+  std::vector<float> output(size);
+  for (ActivationType type : {ActivationType::kNone, ActivationType::kSilu,
+                              ActivationType::kClip}) {
+    ResidualActivationForward(type, input.data(), residual.data(), output.data(), size, 0.f, 6.f);
+    for (size_t i = 0; i < size; ++i) {
+      const double x = double(input.at(i)) + residual.at(i);
+      ASSERT_NEAR(output.at(i), ReferenceActivation(type, x, 0., 6.), 1e-5 * std::max(1., x));
+    }
+  }
+}
+
+TEST(test_activation, layer_from_operator) {
+  using namespace kuiper_infer;
+  std::shared_ptr<RuntimeOperator> op = std::make_shared<RuntimeOperator>();
+  op->name = "clamp";
+  op->type = "torch.clamp";
+  op->params.insert({"min", std::make_shared<RuntimeParameterFloat>(-0.5f)});
+  op->params.insert({"max", std::make_shared<RuntimeParameter>()});
+  ASSERT_TRUE(LayerRegisterer::IsRegistered("torch.clamp"));
+  std::shared_ptr<Layer<float>> layer = LayerRegisterer::CreateLayer(op);
+
+  std::vector<sftensor> inputs{std::make_shared<ftensor>(2, 3, 4)};
+  inputs.front()->randn();
+  std::vector<sftensor> outputs{std::make_shared<ftensor>(2, 3, 4)};
+  ASSERT_EQ(layer->Forward(inputs, outputs), StatusCode::kSuccess);
+  for (uint32_t i = 0; i < inputs.front()->size(); ++i) {
+    ASSERT_EQ(outputs.front()->index(i), std::max(inputs.front()->index(i), -0.5f));
+  }
+
+  op->type = "F.gelu";
+  op->params.clear();
+  op->params.insert({"approximate", std::make_shared<RuntimeParameterString>("fast")});
+  std::shared_ptr<Layer<float>> gelu_layer;
+  ASSERT_EQ(ActivationLayer::CreateInstance(op, gelu_layer), StatusCode::kParseParameterError);
+}
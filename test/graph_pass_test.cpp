@@ -0,0 +1,461 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include "runtime/graph_pass.h"
+#include "runtime/ir.h"
+#include "runtime/pnnx/store_zip.h"
+#include "test_util.h"
+
+using namespace kuiper_infer;
+
+namespace {
+
+struct BatchNormValues {
+  std::vector<float> mean;
+  std::vector<float> var;
+  std::vector<float> gamma;
+  std::vector<float> beta;
+
+  explicit BatchNormValues(uint32_t channels)
+      : mean(TestValues(channels, 0.5f, 0.1f)),
+        var(TestValues(channels, 0.4f, 0.7f)),
+        gamma(TestValues(channels, 1.5f, 1.9f)),
+        beta(TestValues(channels, 0.8f, 2.3f)) {
+    for (float& v : var) {
+      v = std::abs(v) + 0.1f;
+    }
+  }
+
+  float operator()(float x, uint32_t c) const {
+    return (x - mean.at(c)) / std::sqrt(var.at(c) + 1e-5f) * gamma.at(c) + beta.at(c);
+  }
+
+  void Write(pnnx::StoreZipWriter& szw, const std::string& name) const {
+    szw.write_file(name + ".running_mean", (const char*)mean.data(), mean.size() * sizeof(float));
+    szw.write_file(name + ".running_var", (const char*)var.data(), var.size() * sizeof(float));
+    szw.write_file(name + ".weight", (const char*)gamma.data(), gamma.size() * sizeof(float));
+    szw.write_file(name + ".bias", (const char*)beta.data(), beta.size() * sizeof(float));
+  }
+};
+}  // namespace
+
+TEST(test_graph_pass, fold_conv_batchnorm) {
+  const std::string param_path = "./tmp_fold_conv_bn.pnnx.param";
+  const std::string bin_path = "./tmp_fold_conv_bn.pnnx.bin";
+  const uint32_t in_channels = 3;
+  const uint32_t channels = 4;
+  const std::vector<float> weights = TestValues(channels * in_channels * 9, 0.3f, 0.2f);
+  const BatchNormValues bn(channels);
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "4 3\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,3,6,6)f32\n"
+               << "nn.Conv2d conv 1 1 0 1 bias=False dilation=(1,1) groups=1 in_channels=3 "
+               << "kernel_size=(3,3) out_channels=4 padding=(1,1) padding_mode=zeros "
+               << "stride=(1,1) @weight=(4,3,3,3)f32 #0=(1,3,6,6)f32 #1=(1,4,6,6)f32\n"
+               << "nn.BatchNorm2d bn 1 1 1 2 affine=True eps=1.000000e-05 num_features=4 "
+               << "@running_mean=(4)f32 @running_var=(4)f32 @weight=(4)f32 @bias=(4)f32 "
+               << "#1=(1,4,6,6)f32 #2=(1,4,6,6)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 2 #2=(1,4,6,6)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("conv.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    bn.Write(szw, "bn");
+    szw.close();
+  }
+
+  {
+    pnnx::Graph graph;
+    ASSERT_EQ(graph.load(param_path, bin_path), 0);
+    ASSERT_EQ(FoldBatchNorm(graph), 1);
+    ASSERT_EQ(graph.ops.size(), 3);
+    ASSERT_EQ(graph.operands.size(), 2);
+    const pnnx::Operator* conv = graph.ops.at(1);
+    ASSERT_EQ(conv->name, "conv");
+    ASSERT_TRUE(conv->params.at("bias").b);
+    ASSERT_TRUE(conv->has_attr("bias"));
+    ASSERT_EQ(conv->outputs.front()->name, "2");
+    ASSERT_EQ(conv->outputs.front()->consumers.front()->name, "pnnx_output_0");
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  sftensor input = std::make_shared<ftensor>(in_channels, 6, 6);
+  const std::vector<float> values = TestValues(input->size(), 1.f, 0.f);
+  std::copy(values.begin(), values.end(), input->raw_ptr());
+  graph.set_inputs("pnnx_input_0", {input});
+  graph.Forward();
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 1);
+
+  for (uint32_t c = 0; c < channels; ++c) {
+    for (int32_t h = 0; h < 6; ++h) {
+      for (int32_t w = 0; w < 6; ++w) {
+        float sum = 0.f;
+        for (uint32_t ic = 0; ic < in_channels; ++ic) {
+          for (int32_t kh = 0; kh < 3; ++kh) {
+            for (int32_t kw = 0; kw < 3; ++kw) {
+              const int32_t ih = h + kh - 1;
+              const int32_t iw = w + kw - 1;
+              if (ih >= 0 && iw >= 0 && ih < 6 && iw < 6) {
+                sum += weights.at(((c * in_channels + ic) * 3 + kh) * 3 + kw) *
+                       input->at(ic, ih, iw);
+              }
+            }
+          }
+        }
+        ASSERT_NEAR(outputs.front()->at(c, h, w), bn(sum, c), 1e-4f);
+      }
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_graph_pass, fold_linear_batchnorm) {
+  const std::string param_path = "./tmp_fold_linear_bn.pnnx.param";
+  const std::string bin_path = "./tmp_fold_linear_bn.pnnx.bin";
+  const uint32_t in_features = 5;
+  const uint32_t out_features = 3;
+  const std::vector<float> weights = TestValues(in_features * out_features, 0.5f, 0.4f);
+  const std::vector<float> bias = TestValues(out_features, 1.f, 0.9f);
+  const BatchNormValues bn(out_features);
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "4 3\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,5)f32\n"
+               << "nn.Linear linear 1 1 0 1 bias=True in_features=5 out_features=3 "
+               << "@bias=(3)f32 @weight=(3,5)f32 #0=(2,5)f32 #1=(2,3)f32\n"
+               << "nn.BatchNorm1d bn 1 1 1 2 affine=True eps=1.000000e-05 num_features=3 "
+               << "@running_mean=(3)f32 @running_var=(3)f32 @weight=(3)f32 @bias=(3)f32 "
+               << "#1=(2,3)f32 #2=(2,3)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 2 #2=(2,3)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("linear.bias", (const char*)bias.data(), bias.size() * sizeof(float));
+    szw.write_file("linear.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    bn.Write(szw, "bn");
+    szw.close();
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  std::vector<sftensor> inputs;
+  for (uint32_t b = 0; b < 2; ++b) {
+    sftensor input = std::make_shared<ftensor>(1, 1, in_features);
+    const std::vector<float> values = TestValues(in_features, 1.f, float(b));
+    std::copy(values.begin(), values.end(), input->raw_ptr());
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward();
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 2);
+  for (uint32_t b = 0; b < 2; ++b) {
+    for (uint32_t o = 0; o < out_features; ++o) {
+      float sum = bias.at(o);
+      for (uint32_t i = 0; i < in_features; ++i) {
+        sum += weights.at(o * in_features + i) * inputs.at(b)->index(i);
+      }
+      ASSERT_NEAR(outputs.at(b)->index(o), bn(sum, o), 1e-4f);
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_graph_pass, keep_unfoldable_batchnorm) {
+  const std::string param_path = "./tmp_keep_bn.pnnx.param";
+  const std::string bin_path = "./tmp_keep_bn.pnnx.bin";
+  const BatchNormValues bn(4);
+  const std::vector<float> weights = TestValues(3 * 5, 0.5f, 0.4f);
+  {
+    // 三维输入时BatchNorm1d归一化的是第1维而不是输出特征
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "4 3\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,4,5)f32\n"
+               << "nn.Linear linear 1 1 0 1 bias=False in_features=5 out_features=3 "
+               << "@weight=(3,5)f32 #0=(2,4,5)f32 #1=(2,4,3)f32\n"
+               << "nn.BatchNorm1d bn 1 1 1 2 affine=True eps=1.000000e-05 num_features=4 "
+               << "@running_mean=(4)f32 @running_var=(4)f32 @weight=(4)f32 @bias=(4)f32 "
+               << "#1=(2,4,3)f32 #2=(2,4,3)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 2 #2=(2,4,3)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("linear.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    bn.Write(szw, "bn");
+    szw.close();
+  }
+
+  pnnx::Graph graph;
+  ASSERT_EQ(graph.load(param_path, bin_path), 0);
+  ASSERT_EQ(FoldBatchNorm(graph), 0);
+  ASSERT_EQ(graph.ops.size(), 4);
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_graph_pass, fuse_conv_add_relu) {
+  const std::string param_path = "./tmp_fuse_conv_add.pnnx.param";
+  const std::string bin_path = "./tmp_fuse_conv_add.pnnx.bin";
+  const uint32_t in_channels = 3;
+  const uint32_t channels = 4;
+  const std::vector<float> weights = TestValues(channels * in_channels * 9, 0.3f, 0.2f);
+  const std::vector<float> bias = TestValues(channels, 0.5f, 1.1f);
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "6 5\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,3,6,6)f32\n"
+               << "pnnx.Input pnnx_input_1 0 1 1 #1=(1,4,6,6)f32\n"
+               << "nn.Conv2d conv 1 1 0 2 bias=True dilation=(1,1) groups=1 in_channels=3 "
+               << "kernel_size=(3,3) out_channels=4 padding=(1,1) padding_mode=zeros "
+               << "stride=(1,1) @bias=(4)f32 @weight=(4,3,3,3)f32 #0=(1,3,6,6)f32 "
+               << "#2=(1,4,6,6)f32\n"
+               << "pnnx.Expression add 2 1 2 1 3 expr=add(@0,@1) #2=(1,4,6,6)f32 "
+               << "#1=(1,4,6,6)f32 #3=(1,4,6,6)f32\n"
+               << "F.relu relu 1 1 3 4 #3=(1,4,6,6)f32 #4=(1,4,6,6)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 4 #4=(1,4,6,6)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("conv.bias", (const char*)bias.data(), bias.size() * sizeof(float));
+    szw.write_file("conv.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    szw.close();
+  }
+
+  {
+    pnnx::Graph graph;
+    ASSERT_EQ(graph.load(param_path, bin_path), 0);
+    ASSERT_EQ(FuseGemmEpilogue(graph), 2);
+    ASSERT_EQ(graph.ops.size(), 4);
+    const pnnx::Operator* conv = graph.ops.at(2);
+    ASSERT_EQ(conv->name, "conv");
+    ASSERT_EQ(conv->params.at("fused_activation").s, "F.relu");
+    ASSERT_TRUE(conv->params.at("fused_residual").b);
+    ASSERT_EQ(conv->inputs.size(), 2);
+    ASSERT_EQ(conv->inputs.at(1)->name, "1");
+    ASSERT_EQ(conv->outputs.front()->name, "4");
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  sftensor input = std::make_shared<ftensor>(in_channels, 6, 6);
+  const std::vector<float> values = TestValues(input->size(), 1.f, 0.f);
+  std::copy(values.begin(), values.end(), input->raw_ptr());
+  sftensor residual = std::make_shared<ftensor>(channels, 6, 6);
+  const std::vector<float> residual_values = TestValues(residual->size(), 1.f, 0.6f);
+  std::copy(residual_values.begin(), residual_values.end(), residual->raw_ptr());
+  graph.set_inputs("pnnx_input_0", {input});
+  graph.set_inputs("pnnx_input_1", {residual});
+  graph.Forward();
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 1);
+
+  for (uint32_t c = 0; c < channels; ++c) {
+    for (int32_t h = 0; h < 6; ++h) {
+      for (int32_t w = 0; w < 6; ++w) {
+        float sum = bias.at(c);
+        for (uint32_t ic = 0; ic < in_channels; ++ic) {
+          for (int32_t kh = 0; kh < 3; ++kh) {
+            for (int32_t kw = 0; kw < 3; ++kw) {
+              const int32_t ih = h + kh - 1;
+              const int32_t iw = w + kw - 1;
+              if (ih >= 0 && iw >= 0 && ih < 6 && iw < 6) {
+                sum += weights.at(((c * in_channels + ic) * 3 + kh) * 3 + kw) *
+                       input->at(ic, ih, iw);
+              }
+            }
+          }
+        }
+        const float expected = std::max(sum + residual->at(c, h, w), 0.f);
+        ASSERT_NEAR(outputs.front()->at(c, h, w), expected, 1e-4f);
+      }
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_graph_pass, keep_add_after_activation) {
+  const std::string param_path = "./tmp_keep_add.pnnx.param";
+  const std::string bin_path = "./tmp_keep_add.pnnx.bin";
+  const std::vector<float> weights = TestValues(3 * 5, 0.5f, 0.4f);
+  {
+    // relu(linear(x)) + r 中加法在激活之后, 只能融合激活
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "6 5\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,5)f32\n"
+               << "pnnx.Input pnnx_input_1 0 1 1 #1=(2,3)f32\n"
+               << "nn.Linear linear 1 1 0 2 bias=False in_features=5 out_features=3 "
+               << "@weight=(3,5)f32 #0=(2,5)f32 #2=(2,3)f32\n"
+               << "nn.LeakyReLU act 1 1 2 3 negative_slope=1.000000e-01 #2=(2,3)f32 "
+               << "#3=(2,3)f32\n"
+               << "pnnx.Expression add 2 1 3 1 4 expr=add(@0,@1) #3=(2,3)f32 #1=(2,3)f32 "
+               << "#4=(2,3)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 4 #4=(2,3)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("linear.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    szw.close();
+  }
+
+  pnnx::Graph graph;
+  ASSERT_EQ(graph.load(param_path, bin_path), 0);
+  ASSERT_EQ(FuseGemmEpilogue(graph), 1);
+  ASSERT_EQ(graph.ops.size(), 5);
+  const pnnx::Operator* linear = graph.ops.at(2);
+  ASSERT_EQ(linear->params.at("fused_activation").s, "nn.LeakyReLU");
+  ASSERT_FLOAT_EQ(linear->params.at("fused_activation.negative_slope").f, 0.1f);
+  ASSERT_FALSE(linear->has_param("fused_residual"));
+  ASSERT_EQ(linear->outputs.front()->consumers.front()->name, "add");
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_graph_pass, fuse_elementwise_chain) {
+  const std::string param_path = "./tmp_fuse_elementwise.pnnx.param";
+  const std::string bin_path = "./tmp_fuse_elementwise.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "7 6\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,4,5,5)f32\n"
+               << "pnnx.Input pnnx_input_1 0 1 1 #1=(1,4,5,5)f32\n"
+               << "F.sigmoid sigmoid 1 1 0 2 #0=(1,4,5,5)f32 #2=(1,4,5,5)f32\n"
+               << "pnnx.Expression mul 2 1 2 1 3 expr=mul(@0,@1) #2=(1,4,5,5)f32 "
+               << "#1=(1,4,5,5)f32 #3=(1,4,5,5)f32\n"
+               << "torch.clamp clamp 1 1 3 4 max=8.000000e-01 min=-5.000000e-01 "
+               << "#3=(1,4,5,5)f32 #4=(1,4,5,5)f32\n"
+               << "F.silu silu 1 1 4 5 #4=(1,4,5,5)f32 #5=(1,4,5,5)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 5 #5=(1,4,5,5)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  {
+    pnnx::Graph graph;
+    ASSERT_EQ(graph.load(param_path, bin_path), 0);
+    ASSERT_EQ(FuseElementwiseChains(graph), 3);
+    ASSERT_EQ(graph.ops.size(), 4);
+    ASSERT_EQ(graph.operands.size(), 3);
+    const pnnx::Operator* silu = graph.ops.at(2);
+    ASSERT_EQ(silu->name, "silu");
+    ASSERT_EQ(silu->type, "pnnx.Expression");
+    ASSERT_EQ(silu->inputs.size(), 2);
+    ASSERT_EQ(silu->inputs.at(0)->name, "0");
+    ASSERT_EQ(silu->inputs.at(1)->name, "1");
+    ASSERT_EQ(silu->params.at("expr").s, "silu(min(max(mul(sigmoid(@0),@1),-0.5),0.800000012))");
+    ASSERT_EQ(graph.operands.at(0)->consumers.size(), 1);
+    ASSERT_EQ(graph.operands.at(0)->consumers.front(), silu);
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  sftensor input0 = std::make_shared<ftensor>(4, 5, 5);
+  sftensor input1 = std::make_shared<ftensor>(4, 5, 5);
+  const std::vector<float> values0 = TestValues(input0->size(), 3.f, 0.f);
+  const std::vector<float> values1 = TestValues(input1->size(), 2.f, 0.4f);
+  std::copy(values0.begin(), values0.end(), input0->raw_ptr());
+  std::copy(values1.begin(), values1.end(), input1->raw_ptr());
+  graph.set_inputs("pnnx_input_0", {input0});
+  graph.set_inputs("pnnx_input_1", {input1});
+  graph.Forward();
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 1);
+  for (uint32_t i = 0; i < input0->size(); ++i) {
+    const float sigmoid = 1.f / (1.f + std::exp(-input0->index(i)));
+    const float clamped = std::min(std::max(sigmoid * input1->index(i), -0.5f), 0.8f);
+    const float expected = clamped / (1.f + std::exp(-clamped));
+    ASSERT_NEAR(outputs.front()->index(i), expected, 1e-5f);
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_graph_pass, keep_elementwise_with_two_consumers) {
+  const std::string param_path = "./tmp_keep_elementwise.pnnx.param";
+  const std::string bin_path = "./tmp_keep_elementwise.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "6 4\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,2,3,3)f32\n"
+               << "F.sigmoid sigmoid 1 1 0 1 #0=(1,2,3,3)f32 #1=(1,2,3,3)f32\n"
+               << "F.relu relu 1 1 1 2 #1=(1,2,3,3)f32 #2=(1,2,3,3)f32\n"
+               << "F.tanh tanh 1 1 1 3 #1=(1,2,3,3)f32 #3=(1,2,3,3)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 2 #2=(1,2,3,3)f32\n"
+               << "pnnx.Output pnnx_output_1 1 0 3 #3=(1,2,3,3)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  pnnx::Graph graph;
+  ASSERT_EQ(graph.load(param_path, bin_path), 0);
+  ASSERT_EQ(FuseElementwiseChains(graph), 0);
+  ASSERT_EQ(graph.ops.size(), 6);
+  ASSERT_EQ(graph.ops.at(2)->type, "F.relu");
+  ASSERT_EQ(graph.ops.at(3)->type, "F.tanh");
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_graph_pass, keep_elementwise_with_doubled_reference) {
+  const std::string param_path = "./tmp_doubled_elementwise.pnnx.param";
+  const std::string bin_path = "./tmp_doubled_elementwise.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "6 5\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,3,4,4)f32\n"
+               << "pnnx.Input pnnx_input_1 0 1 1 #1=(1,3,4,4)f32\n"
+               << "pnnx.Expression add 2 1 0 1 2 expr=add(@0,@1) #0=(1,3,4,4)f32 "
+               << "#1=(1,3,4,4)f32 #2=(1,3,4,4)f32\n"
+               << "F.relu relu 1 1 2 3 #2=(1,3,4,4)f32 #3=(1,3,4,4)f32\n"
+               << "pnnx.Expression square 1 1 3 4 expr=mul(@0,@0) #3=(1,3,4,4)f32 "
+               << "#4=(1,3,4,4)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 4 #4=(1,3,4,4)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  {
+    // add和relu合并, 两次读取合并结果的mul保持独立
+    pnnx::Graph graph;
+    ASSERT_EQ(graph.load(param_path, bin_path), 0);
+    ASSERT_EQ(FuseElementwiseChains(graph), 1);
+    ASSERT_EQ(graph.ops.size(), 5);
+    ASSERT_EQ(graph.ops.at(2)->name, "relu");
+    ASSERT_EQ(graph.ops.at(2)->params.at("expr").s, "relu(add(@0,@1))");
+    ASSERT_EQ(graph.ops.at(3)->name, "square");
+    ASSERT_EQ(graph.ops.at(3)->params.at("expr").s, "mul(@0,@0)");
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  sftensor input0 = std::make_shared<ftensor>(3, 4, 4);
+  sftensor input1 = std::make_shared<ftensor>(3, 4, 4);
+  const std::vector<float> values0 = TestValues(input0->size(), 2.f, 0.3f);
+  const std::vector<float> values1 = TestValues(input1->size(), 1.f, 1.7f);
+  std::copy(values0.begin(), values0.end(), input0->raw_ptr());
+  std::copy(values1.begin(), values1.end(), input1->raw_ptr());
+  graph.set_inputs("pnnx_input_0", {input0});
+  graph.set_inputs("pnnx_input_1", {input1});
+  graph.Forward();
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 1);
+  for (uint32_t i = 0; i < input0->size(); ++i) {
+    const float relu = std::max(input0->index(i) + input1->index(i), 0.f);
+    ASSERT_NEAR(outputs.front()->index(i), relu * relu, 1e-5f);
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
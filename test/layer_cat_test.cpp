@@ -0,0 +1,118 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "layer/cat.h"
+#include "runtime/ir.h"
+#include "runtime/pnnx/store_zip.h"
+#include "test_util.h"
+
+using namespace kuiper_infer;
+
+
+static void CheckCat(CatLayer::Axis axis, TensorLayout layout) {
+  const std::vector<uint32_t> extents = {2, 1, 3};
+  std::vector<sftensor> inputs;
+  std::vector<uint32_t> output_shapes = {3, 4, 5};
+  output_shapes.at(uint32_t(axis)) = 6;
+  for (uint32_t i = 0; i < extents.size(); ++i) {
+    std::vector<uint32_t> shapes = {3, 4, 5};
+    shapes.at(uint32_t(axis)) = extents.at(i);
+    inputs.push_back(TestTensor(shapes.at(0), shapes.at(1), shapes.at(2), 1.f, float(i), layout));
+  }
+  std::vector<sftensor> outputs = {
+      std::make_shared<ftensor>(output_shapes.at(0), output_shapes.at(1), output_shapes.at(2),
+                                layout)};
+
+  CatLayer layer(axis);
+  ASSERT_EQ(layer.Build(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_EQ(layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  uint32_t offset = 0;
+  for (const sftensor& input : inputs) {
+    for (uint32_t c = 0; c < input->channels(); ++c) {
+      for (uint32_t r = 0; r < input->rows(); ++r) {
+        for (uint32_t w = 0; w < input->cols(); ++w) {
+          std::vector<uint32_t> index = {c, r, w};
+          index.at(uint32_t(axis)) += offset;
+          ASSERT_EQ(outputs.front()->at(index.at(0), index.at(1), index.at(2)),
+                    input->at(c, r, w));
+        }
+      }
+    }
+    offset += input->shapes().at(uint32_t(axis));
+  }
+}
+
+TEST(test_layer, cat_axes) {
+  for (TensorLayout layout : {TensorLayout::kColMajor, TensorLayout::kRowMajor}) {
+    CheckCat(CatLayer::Axis::kChannel, layout);
+    CheckCat(CatLayer::Axis::kRow, layout);
+    CheckCat(CatLayer::Axis::kCol, layout);
+  }
+}
+
+TEST(test_layer, cat_dim_to_axis) {
+  CatLayer::Axis axis = CatLayer::Axis::kChannel;
+  ASSERT_EQ(CatLayer::OperandDimToAxis(1, 4, axis), StatusCode::kSuccess);
+  ASSERT_EQ(axis, CatLayer::Axis::kChannel);
+  ASSERT_EQ(CatLayer::OperandDimToAxis(-1, 4, axis), StatusCode::kSuccess);
+  ASSERT_EQ(axis, CatLayer::Axis::kCol);
+  ASSERT_EQ(CatLayer::OperandDimToAxis(1, 3, axis), StatusCode::kSuccess);
+  ASSERT_EQ(axis, CatLayer::Axis::kRow);
+  ASSERT_EQ(CatLayer::OperandDimToAxis(1, 2, axis), StatusCode::kSuccess);
+  ASSERT_EQ(axis, CatLayer::Axis::kCol);
+  ASSERT_EQ(CatLayer::OperandDimToAxis(0, 4, axis), StatusCode::kParseParameterError);
+  ASSERT_EQ(CatLayer::OperandDimToAxis(4, 4, axis), StatusCode::kParseParameterError);
+}
+
+TEST(test_layer, cat_graph_slices) {
+  const std::string param_path = "./tmp_cat.pnnx.param";
+  const std::string bin_path = "./tmp_cat.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "7 7\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,2,4,4)f32\n"
+               << "pnnx.Input pnnx_input_1 0 1 1 #1=(2,3,4,4)f32\n"
+               << "pnnx.Expression scale 1 1 0 2 expr=mul(@0,2.000000e+00) #0=(2,2,4,4)f32 "
+               << "#2=(2,2,4,4)f32\n"
+               << "pnnx.Expression shift 1 1 1 3 expr=add(@0,1.000000e+00) #1=(2,3,4,4)f32 "
+               << "#3=(2,3,4,4)f32\n"
+               << "torch.cat inner 2 1 2 1 4 dim=1 #2=(2,2,4,4)f32 #1=(2,3,4,4)f32 "
+               << "#4=(2,5,4,4)f32\n"
+               << "torch.cat outer 2 1 4 3 5 dim=-3 #4=(2,5,4,4)f32 #3=(2,3,4,4)f32 "
+               << "#5=(2,8,4,4)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 5 #5=(2,8,4,4)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  // scale写入inner, inner和shift写入outer; 图的输入被两个算子使用, 仍然拷贝
+  ASSERT_EQ(graph.memory_plan().concat_slices, 3);
+
+  std::vector<sftensor> inputs0 = {TestTensor(2, 4, 4, 1.f, 0.1f), TestTensor(2, 4, 4, 1.f, 0.5f)};
+  std::vector<sftensor> inputs1 = {TestTensor(3, 4, 4, 1.f, 0.9f), TestTensor(3, 4, 4, 1.f, 1.3f)};
+  graph.set_inputs("pnnx_input_0", inputs0);
+  graph.set_inputs("pnnx_input_1", inputs1);
+  graph.Forward();
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 2);
+  for (uint32_t b = 0; b < 2; ++b) {
+    for (uint32_t r = 0; r < 4; ++r) {
+      for (uint32_t w = 0; w < 4; ++w) {
+        for (uint32_t c = 0; c < 2; ++c) {
+          ASSERT_FLOAT_EQ(outputs.at(b)->at(c, r, w), inputs0.at(b)->at(c, r, w) * 2.f);
+        }
+        for (uint32_t c = 0; c < 3; ++c) {
+          ASSERT_FLOAT_EQ(outputs.at(b)->at(c + 2, r, w), inputs1.at(b)->at(c, r, w));
+          ASSERT_FLOAT_EQ(outputs.at(b)->at(c + 5, r, w), inputs1.at(b)->at(c, r, w) + 1.f);
+        }
+      }
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
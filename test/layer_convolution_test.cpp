@@ -0,0 +1,356 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include "data/tensor_layout.h"
+#include "layer/convolution.h"
+#include "runtime/ir.h"
+#include "runtime/pnnx/store_zip.h"
+#include "test_util.h"
+
+using namespace kuiper_infer;
+
+namespace {
+struct ConvParams {
+  uint32_t in_channels;
+  uint32_t out_channels;
+  uint32_t kernel_h;
+  uint32_t kernel_w;
+  uint32_t stride;
+  uint32_t padding;
+  uint32_t dilation;
+  uint32_t groups;
+  bool use_bias;
+};
+
+
+// 直接按定义计算的卷积, 作为参考结果
+sftensor ConvReference(const sftensor& input, const ConvParams& p,
+                       const std::vector<float>& weights, const std::vector<float>& bias) {
+  const uint32_t output_h = ConvolutionLayer::OutputSize(input->rows(), p.kernel_h, p.stride,
+                                                         p.padding, p.dilation);
+  const uint32_t output_w = ConvolutionLayer::OutputSize(input->cols(), p.kernel_w, p.stride,
+                                                         p.padding, p.dilation);
+  sftensor output = std::make_shared<ftensor>(p.out_channels, output_h, output_w);
+  const uint32_t group_in = p.in_channels / p.groups;
+  const uint32_t group_out = p.out_channels / p.groups;
+  for (uint32_t oc = 0; oc < p.out_channels; ++oc) {
+    const uint32_t g = oc / group_out;
+    for (uint32_t oh = 0; oh < output_h; ++oh) {
+      for (uint32_t ow = 0; ow < output_w; ++ow) {
+        double sum = p.use_bias ? bias.at(oc) : 0.;
+        for (uint32_t ic = 0; ic < group_in; ++ic) {
+          for (uint32_t kh = 0; kh < p.kernel_h; ++kh) {
+            for (uint32_t kw = 0; kw < p.kernel_w; ++kw) {
+              const int32_t ih = int32_t(oh * p.stride + kh * p.dilation) - int32_t(p.padding);
+              const int32_t iw = int32_t(ow * p.stride + kw * p.dilation) - int32_t(p.padding);
+              if (ih < 0 || iw < 0 || ih >= int32_t(input->rows()) ||
+                  iw >= int32_t(input->cols())) {
+                continue;
+              }
+              const float w =
+                  weights.at(((oc * group_in + ic) * p.kernel_h + kh) * p.kernel_w + kw);
+              sum += double(w) * input->at(g * group_in + ic, ih, iw);
+            }
+          }
+        }
+        output->at(oc, oh, ow) = float(sum);
+      }
+    }
+  }
+  return output;
+}
+
+void CheckConvolution(const ConvParams& p, uint32_t input_h, uint32_t input_w, uint32_t batch,
+                      ActivationType activation = ActivationType::kNone,
+                      ConvolutionAlgorithm algorithm = ConvolutionAlgorithm::kIm2colGemm,
+                      bool residual = false, TensorLayout layout = TensorLayout::kColMajor) {
+  ConvolutionLayer layer(p.in_channels, p.out_channels, p.kernel_h, p.kernel_w, p.stride,
+                         p.stride, p.padding, p.padding, p.dilation, p.dilation, p.groups,
+                         p.use_bias);
+  const std::vector<float> weights = TestValues(
+      size_t(p.out_channels) * p.in_channels / p.groups * p.kernel_h * p.kernel_w, 0.3f, 0.2f);
+  const std::vector<float> bias = TestValues(p.out_channels, 1.f, 1.3f);
+  ASSERT_EQ(layer.set_weights(weights), StatusCode::kSuccess);
+  if (p.use_bias) {
+    ASSERT_EQ(layer.set_bias(bias), StatusCode::kSuccess);
+  }
+  layer.set_epilogue({activation, 0.01f, 0.f, residual});
+
+  const uint32_t output_h =
+      ConvolutionLayer::OutputSize(input_h, p.kernel_h, p.stride, p.padding, p.dilation);
+  const uint32_t output_w =
+      ConvolutionLayer::OutputSize(input_w, p.kernel_w, p.stride, p.padding, p.dilation);
+  std::vector<sftensor> inputs;
+  std::vector<sftensor> outputs;
+  std::vector<sftensor> residuals;
+  for (uint32_t b = 0; b < batch; ++b) {
+    sftensor input = std::make_shared<ftensor>(p.in_channels, input_h, input_w);
+    const std::vector<float> values = TestValues(input->size(), 1.f, float(b));
+    std::copy(values.begin(), values.end(), input->raw_ptr());
+    inputs.push_back(input);
+    outputs.push_back(std::make_shared<ftensor>(p.out_channels, output_h, output_w));
+    sftensor residual_tensor = std::make_shared<ftensor>(p.out_channels, output_h, output_w);
+    const std::vector<float> residual_values =
+        TestValues(residual_tensor->size(), 0.8f, float(b) + 0.5f);
+    std::copy(residual_values.begin(), residual_values.end(), residual_tensor->raw_ptr());
+    residuals.push_back(residual_tensor);
+  }
+  if (residual) {
+    // 残差操作数的批次排在输入之后
+    inputs.insert(inputs.end(), residuals.begin(), residuals.end());
+  }
+  // 参考结果按列主序计算, 层的输入输出转换为待测的布局
+  std::vector<sftensor> layer_inputs;
+  for (const sftensor& input : inputs) {
+    layer_inputs.push_back(std::make_shared<ftensor>(*input));
+    layer_inputs.back()->convert_layout(layout);
+  }
+  for (const sftensor& output : outputs) {
+    output->convert_layout(layout);
+  }
+
+  ASSERT_EQ(layer.Build(layer_inputs, outputs), StatusCode::kSuccess);
+  ASSERT_EQ(layer.algorithm(), algorithm);
+  ASSERT_EQ(layer.Forward(layer_inputs, outputs), StatusCode::kSuccess);
+  for (uint32_t b = 0; b < batch; ++b) {
+    outputs.at(b)->convert_layout(TensorLayout::kColMajor);
+    const sftensor expected = ConvReference(inputs.at(b), p, weights, bias);
+    ASSERT_EQ(outputs.at(b)->shapes(), expected->shapes());
+    for (uint32_t i = 0; i < expected->size(); ++i) {
+      float value = expected->index(i);
+      if (residual) {
+        value += residuals.at(b)->index(i);
+      }
+      if (activation == ActivationType::kRelu) {
+        value = std::max(value, 0.f);
+      }
+      ASSERT_NEAR(outputs.at(b)->index(i), value, 1e-4f) << "at " << i;
+    }
+  }
+}
+}  // namespace
+
+TEST(test_layer, convolution_im2col) {
+  CheckConvolution({3, 8, 3, 3, 1, 1, 1, 1, true}, 9, 7, 2);
+  CheckConvolution({4, 6, 3, 3, 2, 1, 1, 1, false}, 10, 11, 1);
+  CheckConvolution({2, 4, 5, 3, 1, 2, 1, 1, true}, 8, 8, 1);
+}
+
+TEST(test_layer, convolution_pointwise) {
+  const ActivationType none = ActivationType::kNone;
+  const ConvolutionAlgorithm pointwise = ConvolutionAlgorithm::kPointwise;
+  CheckConvolution({1, 1, 1, 1, 1, 0, 1, 1, true}, 4, 5, 3, none, pointwise);
+  CheckConvolution({16, 24, 1, 1, 1, 0, 1, 1, true}, 7, 9, 2, none, pointwise);
+  CheckConvolution({8, 12, 1, 1, 1, 0, 1, 2, false}, 6, 5, 1, ActivationType::kRelu, pointwise);
+  // 有步长或填充的1x1卷积仍然需要im2col
+  CheckConvolution({8, 8, 1, 1, 2, 0, 1, 1, true}, 6, 6, 1);
+  CheckConvolution({8, 8, 1, 1, 1, 1, 1, 1, true}, 6, 6, 1);
+}
+
+TEST(test_layer, convolution_dilation_groups) {
+  CheckConvolution({4, 6, 3, 3, 1, 2, 2, 2, true}, 9, 9, 1);
+  CheckConvolution({6, 6, 3, 3, 2, 1, 1, 3, true}, 7, 6, 2);
+  CheckConvolution({3, 5, 7, 7, 3, 3, 1, 1, true}, 12, 12, 1);
+}
+
+TEST(test_layer, convolution_activation) {
+  CheckConvolution({3, 8, 3, 3, 1, 1, 1, 1, true}, 6, 6, 2, ActivationType::kRelu);
+}
+
+TEST(test_layer, convolution_winograd) {
+  const ActivationType none = ActivationType::kNone;
+  const ConvolutionAlgorithm winograd = ConvolutionAlgorithm::kWinograd;
+  // 输出尺寸不是4的倍数时边缘分块只写回有效部分
+  CheckConvolution({16, 16, 3, 3, 1, 1, 1, 1, true}, 13, 11, 2, none, winograd);
+  CheckConvolution({8, 12, 3, 3, 1, 0, 1, 1, false}, 10, 10, 1, none, winograd);
+  CheckConvolution({12, 8, 3, 3, 1, 2, 1, 1, true}, 9, 16, 1, ActivationType::kRelu, winograd);
+  // 通道太少或者输出太小时仍然使用im2col
+  CheckConvolution({4, 16, 3, 3, 1, 1, 1, 1, true}, 16, 16, 1);
+  CheckConvolution({16, 16, 3, 3, 1, 1, 1, 1, true}, 5, 5, 1);
+}
+
+TEST(test_layer, convolution_depthwise) {
+  const ActivationType none = ActivationType::kNone;
+  const ConvolutionAlgorithm depthwise = ConvolutionAlgorithm::kDepthwise;
+  // 展开的3x3和5x5, 步长1和2
+  CheckConvolution({8, 8, 3, 3, 1, 1, 1, 8, true}, 13, 11, 2, none, depthwise);
+  CheckConvolution({8, 8, 3, 3, 2, 1, 1, 8, true}, 14, 15, 1, none, depthwise);
+  CheckConvolution({6, 6, 5, 5, 1, 2, 1, 6, false}, 12, 9, 1, none, depthwise);
+  CheckConvolution({6, 6, 5, 5, 2, 2, 1, 6, true}, 17, 16, 1, ActivationType::kRelu, depthwise);
+  // 通用路径: 通道倍数, 空洞, 7x7, 输入小于卷积核
+  CheckConvolution({4, 8, 3, 3, 1, 1, 1, 4, true}, 9, 9, 1, none, depthwise);
+  CheckConvolution({4, 4, 3, 3, 1, 2, 2, 4, true}, 9, 10, 1, none, depthwise);
+  CheckConvolution({3, 3, 7, 7, 1, 3, 1, 3, true}, 5, 4, 1, none, depthwise);
+}
+
+TEST(test_layer, convolution_depthwise_blocked) {
+  const ActivationType none = ActivationType::kNone;
+  const ConvolutionAlgorithm depthwise = ConvolutionAlgorithm::kDepthwise;
+  for (TensorLayout layout : {TensorLayout::kNCHW8c, TensorLayout::kNCHW16c}) {
+    // 通道数不是块大小的倍数, 步长, 空洞和残差
+    CheckConvolution({8, 8, 3, 3, 1, 1, 1, 8, true}, 13, 11, 2, none, depthwise, false, layout);
+    CheckConvolution({12, 12, 3, 3, 2, 1, 1, 12, false}, 14, 15, 1, none, depthwise, false,
+                     layout);
+    CheckConvolution({6, 6, 5, 5, 1, 4, 2, 6, true}, 12, 9, 1, ActivationType::kRelu, depthwise,
+                     true, layout);
+    CheckConvolution({20, 20, 7, 7, 1, 3, 1, 20, true}, 5, 4, 1, none, depthwise, false, layout);
+  }
+  // 通道倍数大于1的深度卷积只支持列主序
+  ConvolutionLayer layer(4, 8, 3, 3, 1, 1, 1, 1, 1, 1, 4, false);
+  ASSERT_FALSE(layer.IsLayoutSupported(TensorLayout::kNCHW8c));
+  ASSERT_EQ(layer.PreferredLayout(), TensorLayout::kColMajor);
+}
+
+TEST(test_layer, convolution_residual) {
+  const ActivationType relu = ActivationType::kRelu;
+  CheckConvolution({3, 8, 3, 3, 1, 1, 1, 1, true}, 6, 7, 2, relu,
+                   ConvolutionAlgorithm::kIm2colGemm, true);
+  CheckConvolution({6, 6, 3, 3, 1, 1, 1, 3, false}, 7, 6, 1, ActivationType::kNone,
+                   ConvolutionAlgorithm::kIm2colGemm, true);
+  CheckConvolution({8, 12, 1, 1, 1, 0, 1, 1, true}, 6, 5, 2, relu,
+                   ConvolutionAlgorithm::kPointwise, true);
+  CheckConvolution({16, 16, 3, 3, 1, 1, 1, 1, true}, 13, 11, 1, relu,
+                   ConvolutionAlgorithm::kWinograd, true);
+  CheckConvolution({8, 8, 3, 3, 1, 1, 1, 8, true}, 13, 11, 2, relu,
+                   ConvolutionAlgorithm::kDepthwise, true);
+}
+
+TEST(test_layer, convolution_graph) {
+  const std::string param_path = "./tmp_conv.pnnx.param";
+  const std::string bin_path = "./tmp_conv.pnnx.bin";
+  const ConvParams p{2, 4, 3, 3, 1, 1, 1, 1, true};
+  const std::vector<float> weights = TestValues(4 * 2 * 3 * 3, 0.3f, 0.2f);
+  const std::vector<float> bias = TestValues(4, 1.f, 1.3f);
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "3 2\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,2,5,6)f32\n"
+               << "nn.Conv2d conv 1 1 0 1 bias=True dilation=(1,1) groups=1 in_channels=2 "
+               << "kernel_size=(3,3) out_channels=4 padding=(1,1) padding_mode=zeros "
+               << "stride=(1,1) @bias=(4)f32 @weight=(4,2,3,3)f32 #0=(2,2,5,6)f32 "
+               << "#1=(2,4,5,6)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 1 #1=(2,4,5,6)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("conv.bias", (const char*)bias.data(), bias.size() * sizeof(float));
+    szw.write_file("conv.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    szw.close();
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  ASSERT_EQ(graph.memory_plan().workspace_bytes, 2 * 3 * 3 * 5 * 6 * sizeof(float));
+  std::vector<sftensor> inputs;
+  for (uint32_t b = 0; b < 2; ++b) {
+    sftensor input = std::make_shared<ftensor>(2, 5, 6);
+    const std::vector<float> values = TestValues(input->size(), 1.f, float(b));
+    std::copy(values.begin(), values.end(), input->raw_ptr());
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward();
+
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 2);
+  for (uint32_t b = 0; b < 2; ++b) {
+    const sftensor expected = ConvReference(inputs.at(b), p, weights, bias);
+    ASSERT_EQ(outputs.at(b)->shapes(), expected->shapes());
+    for (uint32_t i = 0; i < expected->size(); ++i) {
+      ASSERT_NEAR(outputs.at(b)->index(i), expected->index(i), 1e-4f);
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_layer, convolution_blocked_graph) {
+  const std::string param_path = "./tmp_conv_blocked.pnnx.param";
+  const std::string bin_path = "./tmp_conv_blocked.pnnx.bin";
+  const ConvParams depthwise{12, 12, 3, 3, 1, 1, 1, 12, true};
+  const ConvParams dense{12, 4, 3, 3, 1, 1, 1, 1, true};
+  const std::vector<float> weights1 = TestValues(12 * 3 * 3, 0.3f, 0.2f);
+  const std::vector<float> weights2 = TestValues(12 * 3 * 3, 0.3f, 0.9f);
+  const std::vector<float> weights3 = TestValues(4 * 12 * 3 * 3, 0.2f, 1.4f);
+  const std::vector<float> bias1 = TestValues(12, 1.f, 1.3f);
+  const std::vector<float> bias2 = TestValues(12, 1.f, 0.1f);
+  const std::vector<float> bias3 = TestValues(4, 1.f, 2.1f);
+  {
+    const std::string depthwise_params =
+        "bias=True dilation=(1,1) groups=12 in_channels=12 kernel_size=(3,3) out_channels=12 "
+        "padding=(1,1) padding_mode=zeros stride=(1,1) @bias=(12)f32 @weight=(12,1,3,3)f32 ";
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "7 5\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,12,7,9)f32\n"
+               << "nn.Conv2d conv1 1 1 0 1 " << depthwise_params
+               << "#0=(2,12,7,9)f32 #1=(2,12,7,9)f32\n"
+               << "F.relu relu 1 1 1 2 #1=(2,12,7,9)f32 #2=(2,12,7,9)f32\n"
+               << "nn.Conv2d conv2 1 1 1 3 " << depthwise_params
+               << "#1=(2,12,7,9)f32 #3=(2,12,7,9)f32\n"
+               << "nn.Conv2d conv3 1 1 3 4 bias=True dilation=(1,1) groups=1 in_channels=12 "
+               << "kernel_size=(3,3) out_channels=4 padding=(1,1) padding_mode=zeros "
+               << "stride=(1,1) @bias=(4)f32 @weight=(4,12,3,3)f32 #3=(2,12,7,9)f32 "
+               << "#4=(2,4,7,9)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 4 #4=(2,4,7,9)f32\n"
+               << "pnnx.Output pnnx_output_1 1 0 2 #2=(2,12,7,9)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("conv1.bias", (const char*)bias1.data(), bias1.size() * sizeof(float));
+    szw.write_file("conv1.weight", (const char*)weights1.data(), weights1.size() * sizeof(float));
+    szw.write_file("conv2.bias", (const char*)bias2.data(), bias2.size() * sizeof(float));
+    szw.write_file("conv2.weight", (const char*)weights2.data(), weights2.size() * sizeof(float));
+    szw.write_file("conv3.bias", (const char*)bias3.data(), bias3.size() * sizeof(float));
+    szw.write_file("conv3.weight", (const char*)weights3.data(), weights3.size() * sizeof(float));
+    szw.close();
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  // 深度卷积和它们之间与布局无关的激活保持分块, 只在进出分块区域时重排
+  const TensorLayout blocked = DefaultBlockedLayout();
+  ASSERT_EQ(graph.operator_layout("pnnx_input_0"), TensorLayout::kColMajor);
+  ASSERT_EQ(graph.operator_layout("conv1"), blocked);
+  ASSERT_EQ(graph.operator_layout("relu"), blocked);
+  ASSERT_EQ(graph.operator_layout("conv2"), blocked);
+  ASSERT_EQ(graph.operator_layout("conv3"), TensorLayout::kColMajor);
+  ASSERT_EQ(graph.reorder_count("conv1"), 2);
+  ASSERT_EQ(graph.reorder_count("relu"), 0);
+  ASSERT_EQ(graph.reorder_count("conv2"), 0);
+  ASSERT_EQ(graph.reorder_count("conv3"), 2);
+  ASSERT_EQ(graph.reorder_count("pnnx_output_0"), 0);
+  ASSERT_EQ(graph.reorder_count("pnnx_output_1"), 2);
+
+  std::vector<sftensor> inputs;
+  for (uint32_t b = 0; b < 2; ++b) {
+    sftensor input = std::make_shared<ftensor>(12, 7, 9);
+    const std::vector<float> values = TestValues(input->size(), 1.f, float(b));
+    std::copy(values.begin(), values.end(), input->raw_ptr());
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward();
+
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  const std::vector<sftensor> relu_outputs = graph.get_outputs("pnnx_output_1");
+  ASSERT_EQ(outputs.size(), 2);
+  ASSERT_EQ(relu_outputs.size(), 2);
+  for (uint32_t b = 0; b < 2; ++b) {
+    const sftensor conv1 = ConvReference(inputs.at(b), depthwise, weights1, bias1);
+    const sftensor conv2 = ConvReference(conv1, depthwise, weights2, bias2);
+    const sftensor expected = ConvReference(conv2, dense, weights3, bias3);
+    ASSERT_EQ(outputs.at(b)->layout(), TensorLayout::kColMajor);
+    ASSERT_EQ(outputs.at(b)->shapes(), expected->shapes());
+    for (uint32_t i = 0; i < expected->size(); ++i) {
+      ASSERT_NEAR(outputs.at(b)->index(i), expected->index(i), 1e-4f);
+    }
+    ASSERT_EQ(relu_outputs.at(b)->layout(), TensorLayout::kColMajor);
+    for (uint32_t i = 0; i < conv1->size(); ++i) {
+      ASSERT_NEAR(relu_outputs.at(b)->index(i), std::max(conv1->index(i), 0.f), 1e-4f);
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
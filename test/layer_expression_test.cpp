@@ -0,0 +1,187 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "data/tensor_util.h"
+#include "layer/expression.h"
+#include "runtime/ir.h"
+#include "runtime/pnnx/store_zip.h"
+#include "test_util.h"
+
+using namespace kuiper_infer;
+
+
+static std::shared_ptr<ExpressionLayer> CompileExpression(const std::string& expr) {
+  ExpressionProgram program;
+  CHECK(ExpressionProgram::Compile(expr, program) == StatusCode::kSuccess) << expr;
+  return std::make_shared<ExpressionLayer>(std::move(program));
+}
+
+TEST(test_layer, expression_compile) {
+  ExpressionProgram program;
+  ASSERT_EQ(ExpressionProgram::Compile("add(mul(@0,@1),@2)", program), StatusCode::kSuccess);
+  ASSERT_EQ(program.num_inputs(), 3);
+  const std::vector<ExpressionOp> expected{ExpressionOp::kInput, ExpressionOp::kInput,
+                                           ExpressionOp::kMul, ExpressionOp::kInput,
+                                           ExpressionOp::kAdd};
+  ASSERT_EQ(program.instructions().size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(program.instructions().at(i).op, expected.at(i));
+  }
+
+  ASSERT_EQ(ExpressionProgram::Compile("sub(@1,-1.500000e+00)", program), StatusCode::kSuccess);
+  ASSERT_EQ(program.num_inputs(), 2);
+  ASSERT_FLOAT_EQ(program.instructions().at(1).value, -1.5f);
+
+  // 形状运算, 未知函数和错误的参数个数
+  ASSERT_EQ(ExpressionProgram::Compile("size(@0,1)", program), StatusCode::kParseParameterError);
+  ASSERT_EQ(ExpressionProgram::Compile("erf(@0)", program), StatusCode::kParseParameterError);
+  ASSERT_EQ(ExpressionProgram::Compile("add(@0)", program), StatusCode::kParseParameterError);
+  ASSERT_EQ(ExpressionProgram::Compile("add(@0,@1", program), StatusCode::kParseParameterError);
+}
+
+TEST(test_layer, expression_dense_batch) {
+  const uint32_t batch = 3;
+  const std::shared_ptr<ExpressionLayer> layer =
+      CompileExpression("div(add(mul(@0,@1),neg(@2)),add(square(@1),1.000000e+00))");
+  // 三个操作数的批次分别连续存放, 整个批次作为一个扁平数组计算
+  const std::vector<uint32_t> shapes{4, 17, 23};
+  const size_t sample = 4 * 17 * 23;
+  std::vector<float> storage(sample * batch * 4);
+  std::vector<sftensor> inputs;
+  std::vector<sftensor> outputs;
+  for (uint32_t i = 0; i < 3; ++i) {
+    for (uint32_t b = 0; b < batch; ++b) {
+      sftensor tensor = std::make_shared<ftensor>(storage.data() + (i * batch + b) * sample,
+                                                  shapes, TensorLayout::kColMajor);
+      const sftensor values = TestTensor(4, 17, 23, 2.f, float(i * batch + b));
+      std::copy(values->raw_ptr(), values->raw_ptr() + sample, tensor->raw_ptr());
+      inputs.push_back(tensor);
+    }
+  }
+  for (uint32_t b = 0; b < batch; ++b) {
+    outputs.push_back(std::make_shared<ftensor>(storage.data() + (3 * batch + b) * sample, shapes,
+                                                TensorLayout::kColMajor));
+  }
+  ASSERT_EQ(layer->Build(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_EQ(layer->Forward(inputs, outputs), StatusCode::kSuccess);
+  for (uint32_t b = 0; b < batch; ++b) {
+    for (size_t j = 0; j < sample; ++j) {
+      const float x = inputs.at(b)->index(j);
+      const float y = inputs.at(batch + b)->index(j);
+      const float z = inputs.at(2 * batch + b)->index(j);
+      ASSERT_NEAR(outputs.at(b)->index(j), (x * y - z) / (y * y + 1.f), 1e-5f);
+    }
+  }
+}
+
+TEST(test_layer, expression_broadcast) {
+  const std::shared_ptr<ExpressionLayer> layer =
+      CompileExpression("add(mul(@0,@1),tanh(@2))");
+  for (TensorLayout layout : {TensorLayout::kColMajor, TensorLayout::kRowMajor}) {
+    // 按通道的缩放, 完整的张量和沿行广播的偏置
+    sftensor scale = TestTensor(5, 1, 1, 2.f, 0.3f);
+    sftensor input = TestTensor(5, 300, 7, 2.f, 1.1f);
+    sftensor shift = TestTensor(1, 300, 1, 2.f, 2.7f);
+    sftensor output = std::make_shared<ftensor>(5, 300, 7);
+    input->convert_layout(layout);
+    output->convert_layout(layout);
+    std::vector<sftensor> inputs{scale, input, shift};
+    std::vector<sftensor> outputs{output};
+    ASSERT_EQ(layer->Forward(inputs, outputs), StatusCode::kSuccess);
+    for (uint32_t c = 0; c < 5; ++c) {
+      for (uint32_t r = 0; r < 300; ++r) {
+        for (uint32_t w = 0; w < 7; ++w) {
+          const float expected =
+              scale->at(c, 0, 0) * input->at(c, r, w) + std::tanh(shift->at(0, r, 0));
+          ASSERT_NEAR(output->at(c, r, w), expected, 1e-5f);
+        }
+      }
+    }
+  }
+
+  std::vector<sftensor> inputs{TestTensor(5, 3, 1, 2.f, 0.f), TestTensor(5, 2, 7, 2.f, 0.f),
+                               TestTensor(5, 3, 7, 2.f, 0.f)};
+  std::vector<sftensor> outputs{std::make_shared<ftensor>(5, 3, 7)};
+  ASSERT_EQ(layer->Forward(inputs, outputs), StatusCode::kInferDimMismatch);
+}
+
+TEST(test_layer, expression_parallel) {
+#ifdef _OPENMP
+  // 单核机器上默认只有一个线程, 强制多个线程执行并行区域
+  const int max_threads = omp_get_max_threads();
+  omp_set_num_threads(4);
+#endif
+  const std::shared_ptr<ExpressionLayer> layer = CompileExpression("add(mul(@0,@1),tanh(@2))");
+  for (TensorLayout layout : {TensorLayout::kColMajor, TensorLayout::kRowMajor}) {
+    // 超过并行阈值的完整张量和需要广播的张量
+    sftensor input = TestTensor(8, 64, 64, 2.f, 0.4f);
+    sftensor other = TestTensor(8, 64, 64, 2.f, 1.3f);
+    sftensor shift = TestTensor(1, 64, 1, 2.f, 2.2f);
+    sftensor dense = std::make_shared<ftensor>(8, 64, 64);
+    sftensor broadcast = std::make_shared<ftensor>(8, 64, 64);
+    for (const sftensor& tensor : {input, other, dense, broadcast}) {
+      tensor->convert_layout(layout);
+    }
+    std::vector<sftensor> dense_inputs{input, other, other};
+    std::vector<sftensor> dense_outputs{dense};
+    ASSERT_EQ(layer->Forward(dense_inputs, dense_outputs), StatusCode::kSuccess);
+    std::vector<sftensor> broadcast_inputs{input, other, shift};
+    std::vector<sftensor> broadcast_outputs{broadcast};
+    ASSERT_EQ(layer->Forward(broadcast_inputs, broadcast_outputs), StatusCode::kSuccess);
+    for (uint32_t c = 0; c < 8; ++c) {
+      for (uint32_t r = 0; r < 64; ++r) {
+        for (uint32_t w = 0; w < 64; ++w) {
+          const float product = input->at(c, r, w) * other->at(c, r, w);
+          ASSERT_NEAR(dense->at(c, r, w), product + std::tanh(other->at(c, r, w)), 1e-5f);
+          ASSERT_NEAR(broadcast->at(c, r, w), product + std::tanh(shift->at(0, r, 0)), 1e-5f);
+        }
+      }
+    }
+  }
+#ifdef _OPENMP
+  omp_set_num_threads(max_threads);
+#endif
+}
+
+TEST(test_layer, expression_graph) {
+  const std::string param_path = "./tmp_expression.pnnx.param";
+  const std::string bin_path = "./tmp_expression.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "4 3\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,3,4,5)f32\n"
+               << "pnnx.Input pnnx_input_1 0 1 1 #1=(1,3,1,1)f32\n"
+               << "pnnx.Expression expr 2 1 0 1 2 expr=sub(mul(@0,@1),floor(@0)) "
+               << "#0=(1,3,4,5)f32 #1=(1,3,1,1)f32 #2=(1,3,4,5)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 2 #2=(1,3,4,5)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  sftensor input = TestTensor(3, 4, 5, 2.f, 0.4f);
+  sftensor scale = TestTensor(3, 1, 1, 2.f, 1.9f);
+  graph.set_inputs("pnnx_input_0", {input});
+  graph.set_inputs("pnnx_input_1", {scale});
+  graph.Forward();
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 1);
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t r = 0; r < 4; ++r) {
+      for (uint32_t w = 0; w < 5; ++w) {
+        const float x = input->at(c, r, w);
+        ASSERT_NEAR(outputs.front()->at(c, r, w), x * scale->at(c, 0, 0) - std::floor(x), 1e-5f);
+      }
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
@@ -0,0 +1,120 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "layer/layer_factory.h"
+#include "runtime/ir.h"
+#include "runtime/pnnx/store_zip.h"
+
+using namespace kuiper_infer;
+
+namespace {
+// 通过工作区计算 y = 2 * x, 用来检查Build和工作区的分配
+class TestDoubleLayer : public Layer<float> {
+ public:
+  TestDoubleLayer() : Layer("TestDouble") {}
+
+  StatusCode Build(const std::vector<sftensor>& inputs,
+                   const std::vector<sftensor>& outputs) override {
+    if (inputs.empty() || inputs.size() != outputs.size()) {
+      return StatusCode::kInferDimMismatch;
+    }
+    build_count += 1;
+    sample_size_ = inputs.front()->size();
+    return StatusCode::kSuccess;
+  }
+
+  size_t WorkspaceSize() const override { return sample_size_; }
+
+  StatusCode Forward(const std::vector<sftensor>& inputs, std::vector<sftensor>& outputs) override {
+    if (workspace_ == nullptr) {
+      return StatusCode::kInferParameterError;
+    }
+    for (uint32_t b = 0; b < inputs.size(); ++b) {
+      for (size_t i = 0; i < sample_size_; ++i) {
+        workspace_[i] = inputs.at(b)->index(i) * 2.f;
+      }
+      std::memcpy(outputs.at(b)->raw_ptr(), workspace_, sample_size_ * sizeof(float));
+    }
+    return StatusCode::kSuccess;
+  }
+
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& layer) {
+    layer = std::make_shared<TestDoubleLayer>();
+    return StatusCode::kSuccess;
+  }
+
+  static int32_t build_count;
+
+ private:
+  size_t sample_size_ = 0;
+};
+
+int32_t TestDoubleLayer::build_count = 0;
+
+LayerRegistererWrapper kTestDoubleCreateInstance("test.Double", TestDoubleLayer::CreateInstance);
+}  // namespace
+
+TEST(test_layer_factory, registered_types) {
+  ASSERT_TRUE(LayerRegisterer::IsRegistered("nn.Linear"));
+  ASSERT_TRUE(LayerRegisterer::IsRegistered("test.Double"));
+  ASSERT_FALSE(LayerRegisterer::IsRegistered("test.Unknown"));
+  const std::vector<std::string> layer_types = LayerRegisterer::layer_types();
+  ASSERT_NE(std::find(layer_types.begin(), layer_types.end(), "nn.Linear"), layer_types.end());
+
+  const auto op = std::make_shared<RuntimeOperator>();
+  op->name = "double";
+  op->type = "test.Double";
+  const std::shared_ptr<Layer<float>> layer = LayerRegisterer::CreateLayer(op);
+  ASSERT_NE(layer, nullptr);
+  ASSERT_EQ(layer->layer_name(), "TestDouble");
+}
+
+TEST(test_layer_factory, build_and_workspace) {
+  const std::string param_path = "./tmp_layer_factory.pnnx.param";
+  const std::string bin_path = "./tmp_layer_factory.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "4 3\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,3,4,5)f32\n"
+               << "test.Double double_0 1 1 0 1 #0=(2,3,4,5)f32 #1=(2,3,4,5)f32\n"
+               << "test.Double double_1 1 1 1 2 #1=(2,3,4,5)f32 #2=(2,3,4,5)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 2 #2=(2,3,4,5)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  TestDoubleLayer::build_count = 0;
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  ASSERT_EQ(TestDoubleLayer::build_count, 2);
+  ASSERT_EQ(graph.memory_plan().workspace_bytes, 3 * 4 * 5 * sizeof(float));
+  ASSERT_NE(graph.memory_plan().workspace, nullptr);
+
+  std::vector<sftensor> inputs;
+  for (uint32_t b = 0; b < 2; ++b) {
+    sftensor input = std::make_shared<ftensor>(3, 4, 5);
+    input->fill(float(b + 1));
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward();
+  // Build只在构建时调用一次
+  graph.Forward();
+  ASSERT_EQ(TestDoubleLayer::build_count, 2);
+
+  const std::vector<sftensor> outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 2);
+  for (uint32_t b = 0; b < 2; ++b) {
+    for (uint32_t i = 0; i < outputs.at(b)->size(); ++i) {
+      ASSERT_EQ(outputs.at(b)->index(i), float(b + 1) * 4.f);
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
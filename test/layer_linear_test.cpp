@@ -0,0 +1,207 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include "data/tensor_util.h"
+#include "layer/linear.h"
+#include "runtime/ir.h"
+#include "runtime/pnnx/store_zip.h"
+#include "test_util.h"
+
+using namespace kuiper_infer;
+
+
+// y[r][o] = sum_i x[r][i] * w[o][i] + b[o], 输入按行访问
+static float LinearReference(const sftensor& input, uint32_t c, uint32_t r, uint32_t o,
+                             const std::vector<float>& weights, const std::vector<float>& bias,
+                             uint32_t in_features) {
+  double sum = bias.empty() ? 0. : bias.at(o);
+  for (uint32_t i = 0; i < in_features; ++i) {
+    sum += double(input->at(c, r, i)) * weights.at(o * in_features + i);
+  }
+  return float(sum);
+}
+
+static void CheckLinear(uint32_t batch, uint32_t channels, uint32_t rows, TensorLayout layout,
+                        bool contiguous, bool use_bias, ActivationType activation,
+                        bool residual = false) {
+  const uint32_t in_features = 37;
+  const uint32_t out_features = 19;
+  LinearLayer layer(in_features, out_features, use_bias);
+  const std::vector<float> weights = TestValues(in_features * out_features, 0.2f, 0.5f);
+  const std::vector<float> bias =
+      use_bias ? TestValues(out_features, 1.f, 0.5f) : std::vector<float>{};
+  ASSERT_EQ(layer.set_weights(weights), StatusCode::kSuccess);
+  if (use_bias) {
+    ASSERT_EQ(layer.set_bias(bias), StatusCode::kSuccess);
+  }
+  layer.set_epilogue({activation, 0.01f, 0.f, residual});
+
+  const size_t in_sample = size_t(channels) * rows * in_features;
+  const size_t out_sample = size_t(channels) * rows * out_features;
+  std::vector<float> input_batch(in_sample * batch);
+  std::vector<float> output_batch(out_sample * batch);
+  std::vector<float> residual_batch(out_sample * batch);
+  std::vector<sftensor> inputs;
+  std::vector<sftensor> outputs;
+  std::vector<sftensor> residuals;
+  for (uint32_t b = 0; b < batch; ++b) {
+    sftensor input;
+    sftensor output;
+    if (contiguous) {
+      input = std::make_shared<ftensor>(input_batch.data() + b * in_sample,
+                                        std::vector<uint32_t>{channels, rows, in_features}, layout);
+      output = std::make_shared<ftensor>(output_batch.data() + b * out_sample,
+                                         std::vector<uint32_t>{channels, rows, out_features}, layout);
+    } else {
+      input = std::make_shared<ftensor>(channels, rows, in_features);
+      output = std::make_shared<ftensor>(channels, rows, out_features);
+      input->convert_layout(layout);
+      output->convert_layout(layout);
+    }
+    const std::vector<float> values = TestValues(in_sample, float(b + 1), 0.5f);
+    for (uint32_t c = 0; c < channels; ++c) {
+      for (uint32_t r = 0; r < rows; ++r) {
+        for (uint32_t i = 0; i < in_features; ++i) {
+          input->at(c, r, i) = values.at((c * rows + r) * in_features + i);
+        }
+      }
+    }
+    inputs.push_back(input);
+    outputs.push_back(output);
+
+    sftensor residual_tensor;
+    if (contiguous) {
+      residual_tensor = std::make_shared<ftensor>(
+          residual_batch.data() + b * out_sample,
+          std::vector<uint32_t>{channels, rows, out_features}, layout);
+    } else {
+      residual_tensor = std::make_shared<ftensor>(channels, rows, out_features);
+      residual_tensor->convert_layout(layout);
+    }
+    const std::vector<float> residual_values = TestValues(out_sample, float(b + 7), 0.5f);
+    std::copy(residual_values.begin(), residual_values.end(), residual_tensor->raw_ptr());
+    residuals.push_back(residual_tensor);
+  }
+  if (batch > 1) {
+    ASSERT_EQ(TensorBatchPtr(inputs, 0, batch) != nullptr, contiguous);
+  }
+  if (residual) {
+    // 残差操作数的批次排在输入之后
+    inputs.insert(inputs.end(), residuals.begin(), residuals.end());
+  }
+
+  ASSERT_EQ(layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  for (uint32_t b = 0; b < batch; ++b) {
+    for (uint32_t c = 0; c < channels; ++c) {
+      for (uint32_t r = 0; r < rows; ++r) {
+        for (uint32_t o = 0; o < out_features; ++o) {
+          float expected =
+              LinearReference(inputs.at(b), c, r, o, weights, bias, in_features);
+          if (residual) {
+            expected += residuals.at(b)->at(c, r, o);
+          }
+          if (activation == ActivationType::kRelu) {
+            expected = std::max(expected, 0.f);
+          }
+          ASSERT_NEAR(outputs.at(b)->at(c, r, o), expected, 1e-4f);
+        }
+      }
+    }
+  }
+}
+
+TEST(test_layer, linear_gemv) {
+  CheckLinear(1, 1, 1, TensorLayout::kRowMajor, true, true, ActivationType::kNone);
+  CheckLinear(1, 1, 1, TensorLayout::kColMajor, false, false, ActivationType::kNone);
+}
+
+TEST(test_layer, linear_batched_gemm) {
+  // 连续批次合并成一次乘法, 不连续时逐个样本计算
+  CheckLinear(4, 1, 1, TensorLayout::kRowMajor, true, true, ActivationType::kNone);
+  CheckLinear(4, 2, 3, TensorLayout::kRowMajor, true, true, ActivationType::kNone);
+  CheckLinear(3, 2, 3, TensorLayout::kRowMajor, false, true, ActivationType::kNone);
+}
+
+TEST(test_layer, linear_col_major) {
+  CheckLinear(2, 2, 5, TensorLayout::kColMajor, false, true, ActivationType::kNone);
+  CheckLinear(2, 1, 5, TensorLayout::kColMajor, true, false, ActivationType::kNone);
+}
+
+TEST(test_layer, linear_activation) {
+  CheckLinear(4, 1, 1, TensorLayout::kRowMajor, true, true, ActivationType::kRelu);
+  CheckLinear(2, 2, 5, TensorLayout::kColMajor, false, true, ActivationType::kRelu);
+}
+
+TEST(test_layer, linear_residual) {
+  const ActivationType relu = ActivationType::kRelu;
+  CheckLinear(3, 2, 3, TensorLayout::kRowMajor, true, true, relu, true);
+  CheckLinear(3, 2, 3, TensorLayout::kRowMajor, false, false, ActivationType::kNone, true);
+  CheckLinear(2, 2, 5, TensorLayout::kColMajor, false, true, relu, true);
+  // 行数超过一个后处理分块
+  CheckLinear(8, 1, 500, TensorLayout::kRowMajor, true, true, relu, true);
+}
+
+TEST(test_layer, linear_shape_mismatch) {
+  LinearLayer layer(4, 2, false);
+  ASSERT_EQ(layer.set_weights(std::vector<float>(7)), StatusCode::kParseWeightError);
+  ASSERT_EQ(layer.set_weights(std::vector<float>(8, 1.f)), StatusCode::kSuccess);
+  std::vector<sftensor> inputs{std::make_shared<ftensor>(1, 1, 5)};
+  std::vector<sftensor> outputs{std::make_shared<ftensor>(1, 1, 2)};
+  ASSERT_EQ(layer.Forward(inputs, outputs), StatusCode::kInferDimMismatch);
+
+  // 输入与输出的批次大小不同
+  inputs = {std::make_shared<ftensor>(1, 1, 4)};
+  outputs.push_back(std::make_shared<ftensor>(1, 1, 2));
+  ASSERT_EQ(layer.Forward(inputs, outputs), StatusCode::kInferDimMismatch);
+}
+
+TEST(test_layer, linear_graph) {
+  const std::string param_path = "./tmp_linear.pnnx.param";
+  const std::string bin_path = "./tmp_linear.pnnx.bin";
+  const uint32_t in_features = 6;
+  const uint32_t out_features = 3;
+  const std::vector<float> weights = TestValues(in_features * out_features, 0.5f, 0.5f);
+  const std::vector<float> bias = TestValues(out_features, 1.f, 0.5f);
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "3 2\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(4,6)f32\n"
+               << "nn.Linear linear 1 1 0 1 bias=True in_features=6 out_features=3 "
+               << "@bias=(3)f32 @weight=(3,6)f32 #0=(4,6)f32 #1=(4,3)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 1 #1=(4,3)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("linear.bias", (const char*)bias.data(), bias.size() * sizeof(float));
+    szw.write_file("linear.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    szw.close();
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  std::vector<sftensor> inputs;
+  for (uint32_t b = 0; b < 4; ++b) {
+    sftensor input = std::make_shared<ftensor>(1, 1, in_features);
+    const std::vector<float> values = TestValues(in_features, float(b + 1), 0.5f);
+    for (uint32_t i = 0; i < in_features; ++i) {
+      input->at(0, 0, i) = values.at(i);
+    }
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward();
+
+  const std::vector<sftensor>& outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 4);
+  for (uint32_t b = 0; b < 4; ++b) {
+    ASSERT_EQ(outputs.at(b)->cols(), out_features);
+    for (uint32_t o = 0; o < out_features; ++o) {
+      ASSERT_NEAR(outputs.at(b)->at(0, 0, o),
+                  LinearReference(inputs.at(b), 0, 0, o, weights, bias, in_features), 1e-5f);
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
 #include "runtime/attr.h"
+#include "runtime/pnnx/ir.h"
+#include "runtime/pnnx/store_zip.h"
 
 TEST(test_runtime, attr_weight_data1) {
   using namespace kuiper_infer;
@@ -54,4 +58,134 @@ TEST(test_runtime, attr_weight_data3) {
   for (int i = 0; i < 32; ++i) {
     ASSERT_EQ(weight_data.at(i), 0.f);
   }
-}
\ No newline at end of file
+}
+TEST(test_runtime, attr_mapped_weight_data) {
+  using namespace kuiper_infer;
+  std::shared_ptr<float> values(new float[6]{1.f, 2.f, 3.f, 4.f, 5.f, 6.f},
+                                std::default_delete<float[]>());
+  std::shared_ptr<const char> mapped(values, reinterpret_cast<const char*>(values.get() + 2));
+  RuntimeAttribute runtime_attr({2, 2}, RuntimeDataType::kTypeFloat32, mapped, 4 * sizeof(float));
+  ASSERT_TRUE(runtime_attr.weight_data.empty());
+  ASSERT_EQ(runtime_attr.data(), reinterpret_cast<const char*>(values.get() + 2));
+  ASSERT_EQ(runtime_attr.size(), 16);
+
+  const std::vector<float> weights = runtime_attr.get<float>(false);
+  ASSERT_EQ(weights, std::vector<float>({3.f, 4.f, 5.f, 6.f}));
+  ASSERT_EQ(runtime_attr.size(), 16);
+  runtime_attr.get<float>(true);
+  ASSERT_EQ(runtime_attr.size(), 0);
+  ASSERT_EQ(runtime_attr.mapped_data, nullptr);
+}
+
+TEST(test_runtime, attr_load_mapped) {
+  const std::string param_path = "./tmp_attr_mapped.pnnx.param";
+  const std::string bin_path = "./tmp_attr_mapped.pnnx.bin";
+  const std::vector<float> weights = {0.5f, -1.f, 2.f, 3.5f, -4.f, 6.f};
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "3 2\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,2)f32\n"
+               << "nn.Linear linear 1 1 0 1 bias=False in_features=2 out_features=3 "
+               << "@weight=(3,2)f32 #0=(1,2)f32 #1=(1,3)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 1 #1=(1,3)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("linear.weight", (const char*)weights.data(), weights.size() * sizeof(float));
+    szw.close();
+  }
+
+  std::shared_ptr<const char> mapped;
+  {
+    pnnx::StoreZipReader szr;
+    ASSERT_EQ(szr.open(bin_path), 0);
+    mapped = szr.map_file("linear.weight");
+    ASSERT_NE(mapped, nullptr);
+    ASSERT_EQ(szr.map_file("linear.bias"), nullptr);
+  }
+  // 关闭后视图仍然有效
+  ASSERT_EQ(std::memcmp(mapped.get(), weights.data(), weights.size() * sizeof(float)), 0);
+
+  pnnx::Graph graph;
+  ASSERT_EQ(graph.load(param_path, bin_path), 0);
+  const pnnx::Attribute& weight = graph.ops.at(1)->attrs.at("weight");
+  ASSERT_NE(weight.mapped_data, nullptr);
+  ASSERT_TRUE(weight.data.empty());
+  ASSERT_EQ(weight.raw_size(), weights.size() * sizeof(float));
+  ASSERT_EQ(weight.get_float32_data(), weights);
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_runtime, store_zip_aligned) {
+  const std::string bin_path = "./tmp_store_zip_aligned.pnnx.bin";
+  const std::vector<std::string> names = {"a.weight", "conv_1.bias", "block.3.linear.weight"};
+  std::vector<std::vector<char>> payloads;
+  {
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path, 64), 0);
+    for (uint32_t i = 0; i < names.size(); ++i) {
+      std::vector<char> payload(13 + i * 37);
+      for (uint32_t j = 0; j < payload.size(); ++j) {
+        payload.at(j) = char(i * 31 + j);
+      }
+      ASSERT_EQ(szw.write_file(names.at(i), payload.data(), payload.size()), 0);
+      payloads.push_back(payload);
+    }
+    szw.close();
+  }
+
+  pnnx::StoreZipReader szr;
+  ASSERT_EQ(szr.open(bin_path), 0);
+  ASSERT_EQ(szr.get_names().size(), names.size());
+  for (uint32_t i = 0; i < names.size(); ++i) {
+    const std::vector<char>& payload = payloads.at(i);
+    ASSERT_EQ(szr.get_file_size(names.at(i)), payload.size());
+    const std::shared_ptr<const char> mapped = szr.map_file(names.at(i));
+    ASSERT_NE(mapped, nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(mapped.get()) % 64, 0);
+    ASSERT_EQ(std::memcmp(mapped.get(), payload.data(), payload.size()), 0);
+
+    std::vector<char> data(payload.size());
+    ASSERT_EQ(szr.read_file(names.at(i), data.data()), 0);
+    ASSERT_EQ(data, payload);
+  }
+  szr.close();
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_runtime, attr_load_parallel) {
+  const std::string param_path = "./tmp_attr_parallel.pnnx.param";
+  const std::string bin_path = "./tmp_attr_parallel.pnnx.bin";
+  const int layers = 40;
+  std::vector<std::vector<float>> weights(layers);
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n" << layers + 2 << " " << layers + 1 << "\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,4)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    for (int i = 0; i < layers; ++i) {
+      param_file << "nn.Linear linear_" << i << " 1 1 " << i << " " << i + 1
+                 << " bias=False in_features=4 out_features=4 @weight=(4,4)f32\n";
+      for (int j = 0; j < 16; ++j) {
+        weights.at(i).push_back(float(i) + float(j) * 0.25f);
+      }
+      const std::string name = "linear_" + std::to_string(i) + ".weight";
+      szw.write_file(name, (const char*)weights.at(i).data(), weights.at(i).size() * sizeof(float));
+    }
+    param_file << "pnnx.Output pnnx_output_0 1 0 " << layers << "\n";
+    szw.close();
+  }
+
+  pnnx::Graph graph;
+  ASSERT_EQ(graph.load(param_path, bin_path), 0);
+  ASSERT_EQ(graph.ops.size(), layers + 2);
+  for (int i = 0; i < layers; ++i) {
+    const pnnx::Operator* op = graph.ops.at(i + 1);
+    ASSERT_EQ(op->name, "linear_" + std::to_string(i));
+    ASSERT_EQ(op->attrs.at("weight").get_float32_data(), weights.at(i));
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
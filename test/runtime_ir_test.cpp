@@ -1,8 +1,13 @@
 #include <glog/logging.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <gtest/gtest.h>
+#include "data/tensor_util.h"
 #include "runtime/ir.h"
 #include "runtime/op.h"
+#include "runtime/pnnx/store_zip.h"
 
 using namespace std;
 
@@ -46,4 +51,144 @@ TEST(test_runtime, runtime_graph_input_init1) {
     ASSERT_EQ(size1, 3);
     ASSERT_EQ(size1, size2);
   }
-}
\ No newline at end of file
+}
+
+TEST(test_runtime, runtime_graph_input_output_binding) {
+  using namespace kuiper_infer;
+  const std::string param_path = "./tmp_input_output.pnnx.param";
+  const std::string bin_path = "./tmp_input_output.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "2 1\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,3,4,4)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 0 #0=(2,3,4,4)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  ASSERT_EQ(graph.memory_plan().naive_bytes, 2 * 3 * 4 * 4 * sizeof(float));
+  ASSERT_EQ(graph.memory_plan().planned_bytes, graph.memory_plan().naive_bytes);
+  ASSERT_TRUE(graph.is_input_op("pnnx_input_0"));
+  ASSERT_TRUE(graph.is_output_op("pnnx_output_0"));
+
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < 2; ++i) {
+    sftensor input = std::make_shared<ftensor>(3, 4, 4);
+    input->fill(float(i + 1));
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward();
+
+  const std::vector<sftensor>& outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 2);
+  // 批次在内存中连续存放
+  const float* batch_ptr = TensorBatchPtr(outputs, 0, outputs.size());
+  ASSERT_NE(batch_ptr, nullptr);
+  ASSERT_EQ(batch_ptr + 3 * 4 * 4, outputs.at(1)->raw_ptr());
+  ASSERT_EQ(TensorBatchPtr(inputs, 0, inputs.size()), nullptr);
+  for (uint32_t i = 0; i < 2; ++i) {
+    ASSERT_EQ(outputs.at(i)->shapes(), inputs.at(i)->shapes());
+    for (uint32_t j = 0; j < outputs.at(i)->size(); ++j) {
+      ASSERT_EQ(outputs.at(i)->index(j), float(i + 1));
+    }
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_runtime, runtime_graph_outputs_outlive_graph) {
+  using namespace kuiper_infer;
+  const std::string param_path = "./tmp_outputs_outlive.pnnx.param";
+  const std::string bin_path = "./tmp_outputs_outlive.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "2 1\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(2,3,4,4)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 0 #0=(2,3,4,4)f32\n";
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.close();
+  }
+
+  std::vector<sftensor> outputs;
+  std::weak_ptr<float> arena;
+  {
+    RuntimeGraph graph(param_path, bin_path);
+    graph.Build();
+    std::vector<sftensor> inputs;
+    for (uint32_t i = 0; i < 2; ++i) {
+      sftensor input = std::make_shared<ftensor>(3, 4, 4);
+      input->fill(float(i + 1));
+      inputs.push_back(input);
+    }
+    graph.set_inputs("pnnx_input_0", inputs);
+    graph.Forward();
+    outputs = graph.get_outputs("pnnx_output_0");
+    arena = graph.memory_plan().arena;
+  }
+
+  // 图已经销毁, 输出仍然持有内存池
+  ASSERT_FALSE(arena.expired());
+  ASSERT_EQ(outputs.size(), 2);
+  for (uint32_t i = 0; i < 2; ++i) {
+    for (uint32_t j = 0; j < outputs.at(i)->size(); ++j) {
+      ASSERT_EQ(outputs.at(i)->index(j), float(i + 1));
+    }
+  }
+  outputs.clear();
+  ASSERT_TRUE(arena.expired());
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
+
+TEST(test_runtime, runtime_memory_plan_offsets) {
+  using namespace kuiper_infer;
+  // a -> b -> c -> d, 每个张量只被下一个算子使用
+  std::vector<TensorLifetime> lifetimes(4);
+  for (int32_t i = 0; i < 4; ++i) {
+    lifetimes.at(i).size = 100 + i;
+    lifetimes.at(i).start_time = i;
+    lifetimes.at(i).end_time = i + 1;
+  }
+  const size_t arena_size = PlanMemoryOffsets(lifetimes);
+  ASSERT_EQ(arena_size, 224);
+
+  for (uint32_t i = 0; i < lifetimes.size(); ++i) {
+    ASSERT_EQ(lifetimes.at(i).offset % kArenaAlignment, 0);
+    for (uint32_t j = i + 1; j < lifetimes.size(); ++j) {
+      const auto& l1 = lifetimes.at(i);
+      const auto& l2 = lifetimes.at(j);
+      const bool live_together = !(l1.end_time < l2.start_time || l2.end_time < l1.start_time);
+      const bool memory_overlap =
+          !(l1.offset + l1.size <= l2.offset || l2.offset + l2.size <= l1.offset);
+      ASSERT_FALSE(live_together && memory_overlap);
+    }
+  }
+}
+
+TEST(test_runtime, store_zip_truncated_archive) {
+  const std::string bin_path = "./tmp_truncated.pnnx.bin";
+  std::vector<char> data(4096, 1);
+  {
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    ASSERT_EQ(szw.write_file("weight", data.data(), data.size()), 0);
+    szw.close();
+  }
+  // 存档在数据中间被截断, 条目的范围超出文件末尾
+  std::filesystem::resize_file(bin_path, 1024);
+
+  pnnx::StoreZipReader szr;
+  ASSERT_EQ(szr.open(bin_path), 0);
+  ASSERT_EQ(szr.get_file_size("weight"), data.size());
+  ASSERT_EQ(szr.map_file("weight"), nullptr);
+  ASSERT_EQ(szr.read_file("weight", data.data()), -1);
+  szr.close();
+  std::remove(bin_path.c_str());
+}
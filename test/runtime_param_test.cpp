@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include "runtime/param.h"
+#include "runtime/pnnx/ir.h"
+#include "runtime/pnnx/store_zip.h"
 
 TEST(test_runtime, runtime_param1) {
   using namespace kuiper_infer;
@@ -13,4 +19,129 @@ TEST(test_runtime, runtime_param2) {
   ASSERT_EQ(param->type, RuntimeParameterType::kParameterInt);
   ASSERT_EQ(dynamic_cast<RuntimeParameterFloat*>(param), nullptr);
   ASSERT_NE(dynamic_cast<RuntimeParameterInt*>(param), nullptr);
-}
\ No newline at end of file
+}
+TEST(test_runtime, pnnx_parse_parameter) {
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("None").type, 0);
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("()").type, 0);
+  ASSERT_TRUE(pnnx::Parameter::parse_from_string("True").b);
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("-12").i, -12);
+  ASSERT_FLOAT_EQ(pnnx::Parameter::parse_from_string("1.000000e-01").f, 0.1f);
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("-x").s, "-x");
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("%size").type, 4);
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("(3,-1)").ai, std::vector<int>({3, -1}));
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("[0.5,2e+00]").af, std::vector<float>({0.5f, 2.f}));
+  ASSERT_EQ(pnnx::Parameter::parse_from_string("(a,b)").as, std::vector<std::string>({"a", "b"}));
+}
+
+TEST(test_runtime, pnnx_graph_parse) {
+  const std::string param =
+      "7767517\n"
+      "3 3\n"
+      "pnnx.Input  pnnx_input_0 0 1 0 #0=(1,3,?,%w)f32\r\n"
+      "nn.Conv2d\tconv 1 1 0 1 bias=True kernel_size=(3,3) padding_mode=zeros "
+      "@weight=(4,3,3,3)f32 $input=0 #0=(1,3,?,%w)f32 #1=(1,4,6,6)f16 \n"
+      "pnnx.Output pnnx_output_0 1 0 1 #1=(1,4,6,6)f16";
+  pnnx::Graph graph;
+  ASSERT_EQ(graph.parse(param), 0);
+  ASSERT_EQ(graph.ops.size(), 3);
+  ASSERT_EQ(graph.operands.size(), 2);
+
+  const pnnx::Operator* conv = graph.ops.at(1);
+  ASSERT_EQ(conv->type, "nn.Conv2d");
+  ASSERT_EQ(conv->name, "conv");
+  ASSERT_EQ(conv->params.size(), 3);
+  ASSERT_TRUE(conv->params.at("bias").b);
+  ASSERT_EQ(conv->params.at("kernel_size").ai, std::vector<int>({3, 3}));
+  ASSERT_EQ(conv->params.at("padding_mode").s, "zeros");
+  ASSERT_EQ(conv->attrs.at("weight").type, 1);
+  ASSERT_EQ(conv->attrs.at("weight").shape, std::vector<int>({4, 3, 3, 3}));
+  ASSERT_EQ(conv->inputnames, std::vector<std::string>({"input"}));
+
+  const pnnx::Operand* input = graph.operands.at(0);
+  ASSERT_EQ(input->shape, std::vector<int>({1, 3, -1, -233}));
+  ASSERT_EQ(input->params.at("__shape__3").s, "w");
+  ASSERT_EQ(input->consumers, std::vector<pnnx::Operator*>({graph.ops.at(1)}));
+  const pnnx::Operand* output = graph.operands.at(1);
+  ASSERT_EQ(output->type, 3);
+  ASSERT_EQ(output->shape, std::vector<int>({1, 4, 6, 6}));
+  ASSERT_EQ(output->producer, conv);
+}
+
+TEST(test_runtime, pnnx_graph_operand_index) {
+  std::string param = "7767517\n1002 1001\npnnx.Input input 0 1 0 #0=(1,8)f32\n";
+  for (int i = 0; i < 1000; ++i) {
+    param += "F.relu relu_" + std::to_string(i) + " 1 1 " + std::to_string(i) + " " +
+             std::to_string(i + 1) + " #" + std::to_string(i + 1) + "=(1,8)f32\n";
+  }
+  param += "pnnx.Output output 1 0 1000\n";
+  pnnx::Graph graph;
+  ASSERT_EQ(graph.parse(param), 0);
+  ASSERT_EQ(graph.operands.size(), 1001);
+
+  pnnx::Operand* middle = graph.get_operand("500");
+  ASSERT_NE(middle, nullptr);
+  ASSERT_EQ(middle->producer->name, "relu_499");
+  ASSERT_EQ(middle->shape, std::vector<int>({1, 8}));
+  ASSERT_EQ(graph.get_operand("1001"), nullptr);
+
+  graph.delete_operand(middle);
+  ASSERT_EQ(graph.operands.size(), 1000);
+  ASSERT_EQ(graph.get_operand("500"), nullptr);
+
+  pnnx::Operand* created = graph.new_operand("500");
+  ASSERT_EQ(graph.get_operand("500"), created);
+  const pnnx::Graph& const_graph = graph;
+  ASSERT_EQ(const_graph.get_operand("999")->name, "999");
+
+  // 删除大部分操作数后其余的仍然能通过名字找到
+  for (int i = 0; i < 1000; i += 3) {
+    graph.delete_operand(graph.get_operand(std::to_string(i)));
+  }
+  ASSERT_EQ(graph.operands.size(), 1001 - 334);
+  for (int i = 0; i <= 1000; ++i) {
+    const pnnx::Operand* operand = graph.get_operand(std::to_string(i));
+    if (i % 3 == 0 && i != 1000) {
+      ASSERT_EQ(operand, nullptr) << i;
+    } else {
+      ASSERT_NE(operand, nullptr) << i;
+      ASSERT_EQ(operand->name, std::to_string(i));
+      ASSERT_NE(std::find(graph.operands.begin(), graph.operands.end(), operand),
+                graph.operands.end());
+    }
+  }
+}
+
+TEST(test_runtime, pnnx_graph_load_truncated_bin) {
+  const std::string param_path = "./tmp_truncated_load.pnnx.param";
+  const std::string bin_path = "./tmp_truncated_load.pnnx.bin";
+  {
+    std::ofstream param_file(param_path);
+    param_file << "7767517\n"
+               << "4 3\n"
+               << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,256)f32\n"
+               << "nn.Linear fc1 1 1 0 1 bias=False in_features=256 out_features=256 "
+               << "@weight=(256,256)f32 #0=(1,256)f32 #1=(1,256)f32\n"
+               << "nn.Linear fc2 1 1 1 2 bias=False in_features=256 out_features=256 "
+               << "@weight=(256,256)f32 #1=(1,256)f32 #2=(1,256)f32\n"
+               << "pnnx.Output pnnx_output_0 1 0 2 #2=(1,256)f32\n";
+    const std::vector<float> weight(256 * 256, 0.5f);
+    pnnx::StoreZipWriter szw;
+    ASSERT_EQ(szw.open(bin_path), 0);
+    szw.write_file("fc1.weight", (const char*)weight.data(), weight.size() * sizeof(float));
+    szw.write_file("fc2.weight", (const char*)weight.data(), weight.size() * sizeof(float));
+    szw.close();
+  }
+  {
+    pnnx::Graph graph;
+    ASSERT_EQ(graph.load(param_path, bin_path), 0);
+  }
+
+  // 第二个权重在文件末尾被截断
+  std::filesystem::resize_file(bin_path, std::filesystem::file_size(bin_path) - 1024 * 1024 / 4);
+  {
+    pnnx::Graph graph;
+    ASSERT_EQ(graph.load(param_path, bin_path), -1);
+  }
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+}
@@ -1,7 +1,10 @@
 #include <glog/logging.h>
 #include <iostream>
+#include <thread>
 #include <gtest/gtest.h>
 #include "data/tensor.h"
+#include "data/tensor_expr.h"
+#include "data/tensor_layout.h"
 #include "data/tensor_util.h"
 using namespace std;
 
@@ -157,4 +160,301 @@ TEST(test_tensor, mul6) {
   for (int i = 0; i < f3->size(); ++i) {
     ASSERT_EQ(f3->index(i), 6.f);
   }
-}
\ No newline at end of file
+}
+TEST(test_tensor, broadcast_stride0) {
+  using namespace kuiper_infer;
+  // (C, H, 1) * (1, 1, W): 两个输入都被广播
+  const auto& column = std::make_shared<Tensor<float>>(2, 3, 1);
+  const auto& row = std::make_shared<Tensor<float>>(1, 1, 4);
+  for (uint32_t c = 0; c < 2; ++c) {
+    for (uint32_t r = 0; r < 3; ++r) {
+      column->at(c, r, 0) = float(c * 10 + r);
+    }
+  }
+  for (uint32_t col = 0; col < 4; ++col) {
+    row->at(0, 0, col) = float(col + 1);
+  }
+  for (TensorLayout layout : {TensorLayout::kColMajor, TensorLayout::kRowMajor}) {
+    const auto& output = std::make_shared<Tensor<float>>(2, 3, 4, layout);
+    const TensorAllocatorStats before = GetTensorAllocator()->stats();
+    TensorElementMultiply(column, row, output);
+    ASSERT_EQ(GetTensorAllocator()->stats().allocations, before.allocations);
+    for (uint32_t c = 0; c < 2; ++c) {
+      for (uint32_t r = 0; r < 3; ++r) {
+        for (uint32_t col = 0; col < 4; ++col) {
+          ASSERT_EQ(output->at(c, r, col), float(c * 10 + r) * float(col + 1));
+        }
+      }
+    }
+  }
+
+  // 偏置加法, 原地写回
+  const auto& input = std::make_shared<Tensor<float>>(3, 5, 7, TensorLayout::kRowMajor);
+  input->fill(1.f);
+  const auto& bias = std::make_shared<Tensor<float>>(3, 1, 1);
+  bias->at(0, 0, 0) = 1.f;
+  bias->at(1, 0, 0) = 2.f;
+  bias->at(2, 0, 0) = 3.f;
+  TensorElementAdd(input, bias, input);
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t i = 0; i < 5 * 7; ++i) {
+      ASSERT_EQ(input->matrix_raw_ptr(c)[i], float(c + 2));
+    }
+  }
+
+  const auto& added = TensorElementAdd(bias, row);
+  ASSERT_EQ(added->shapes(), std::vector<uint32_t>({3, 1, 4}));
+  ASSERT_EQ(added->at(2, 0, 3), 7.f);
+  ASSERT_EQ(TensorBroadcastShapes({3, 1, 5}, {2, 1, 4, 1}), std::vector<uint32_t>({2, 3, 4, 5}));
+}
+
+TEST(test_tensor, fused_expression) {
+  using namespace kuiper_infer;
+  const auto& a = std::make_shared<Tensor<float>>(2, 3, 4);
+  const auto& b = std::make_shared<Tensor<float>>(2, 3, 4);
+  const auto& c = std::make_shared<Tensor<float>>(2, 1, 1);
+  a->randn();
+  b->randn();
+  c->at(0, 0, 0) = 1.f;
+  c->at(1, 0, 0) = -1.f;
+
+  const auto& output = std::make_shared<Tensor<float>>(2, 3, 4);
+  const TensorAllocatorStats before = GetTensorAllocator()->stats();
+  TensorAssign(output, TensorExpr(a) * TensorExpr(b) + TensorExpr(c));
+  ASSERT_EQ(GetTensorAllocator()->stats().allocations, before.allocations);
+  for (uint32_t ch = 0; ch < 2; ++ch) {
+    for (uint32_t r = 0; r < 3; ++r) {
+      for (uint32_t col = 0; col < 4; ++col) {
+        ASSERT_FLOAT_EQ(output->at(ch, r, col),
+                        a->at(ch, r, col) * b->at(ch, r, col) + c->at(ch, 0, 0));
+      }
+    }
+  }
+
+  // 原地计算: a = (a + b) * 2 - 1
+  const ftensor expected_source(*a);
+  TensorAssign(a, (TensorExpr(a) + TensorExpr(b)) * 2.f - 1.f);
+  for (uint32_t i = 0; i < a->size(); ++i) {
+    ASSERT_FLOAT_EQ(a->index(i), (expected_source.index(i) + b->index(i)) * 2.f - 1.f);
+  }
+
+  const auto& relu = std::make_shared<Tensor<float>>(2, 3, 4, TensorLayout::kRowMajor);
+  TensorAssign(relu, expr::Map(TensorExpr(b) - TensorExpr(c),
+                               [](float x) { return std::max(x, 0.f); }));
+  for (uint32_t ch = 0; ch < 2; ++ch) {
+    for (uint32_t r = 0; r < 3; ++r) {
+      for (uint32_t col = 0; col < 4; ++col) {
+        ASSERT_FLOAT_EQ(relu->at(ch, r, col), std::max(b->at(ch, r, col) - c->at(ch, 0, 0), 0.f));
+      }
+    }
+  }
+}
+
+TEST(test_tensor, allocator_aligned_and_pooled) {
+  using namespace kuiper_infer;
+  const auto& allocator = std::make_shared<PooledTensorAllocator>();
+  SetTensorAllocator(allocator);
+  {
+    Tensor<float> f1(3, 17, 19);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(f1.raw_ptr()) % kTensorAlignment, 0);
+    f1.fill(1.f);
+  }
+  const TensorAllocatorStats stats1 = allocator->stats();
+  ASSERT_EQ(stats1.allocations, 1);
+  ASSERT_EQ(stats1.pool_hits, 0);
+  ASSERT_EQ(stats1.bytes_in_use, 0);
+  ASSERT_GT(stats1.bytes_cached, 0);
+
+  {
+    // 同一级别的请求命中池中的内存, 且已被清零
+    Tensor<float> f2(3, 17, 18);
+    for (uint32_t i = 0; i < f2.size(); ++i) {
+      ASSERT_EQ(f2.index(i), 0.f);
+    }
+    const TensorAllocatorStats stats2 = allocator->stats();
+    ASSERT_EQ(stats2.pool_hits, 1);
+    ASSERT_GT(stats2.bytes_in_use, 3 * 17 * 18 * sizeof(float) - 1);
+  }
+  ASSERT_EQ(allocator->stats().hit_rate(), 0.5);
+  SetTensorAllocator(nullptr);
+}
+
+TEST(test_tensor, allocator_size_class) {
+  using namespace kuiper_infer;
+  size_t class_bytes = 0;
+  ASSERT_EQ(PooledTensorAllocator::SizeClass(1, &class_bytes), 0);
+  ASSERT_EQ(class_bytes, 64);
+  ASSERT_EQ(PooledTensorAllocator::SizeClass(65, &class_bytes), 1);
+  ASSERT_EQ(class_bytes, 80);
+  ASSERT_EQ(PooledTensorAllocator::SizeClass(128, &class_bytes), 4);
+  ASSERT_EQ(class_bytes, 128);
+  ASSERT_EQ(PooledTensorAllocator::SizeClass(129, &class_bytes), 5);
+  ASSERT_EQ(class_bytes, 160);
+  ASSERT_EQ(PooledTensorAllocator::SizeClass(PooledTensorAllocator::kMaxPooledBytes + 1,
+                                             &class_bytes),
+            -1);
+}
+
+TEST(test_tensor, allocator_thread_cache) {
+  using namespace kuiper_infer;
+  PooledTensorAllocator allocator;
+  // 不是64整数倍的级别
+  void* small = allocator.Allocate(65);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(small) % kTensorAlignment, 0);
+  allocator.Release(small, 65);
+
+  // 不同级别的内存共用线程缓存的上限, 超出的部分归还到全局池, 其他线程可以复用
+  const size_t block_bytes = size_t(1) << 20;
+  std::vector<size_t> sizes;
+  for (uint32_t i = 0; i < 24; ++i) {
+    sizes.push_back(block_bytes * (i / 4 + 1) + i % 4 * block_bytes / 4);
+  }
+  std::vector<void*> blocks;
+  for (size_t size : sizes) {
+    blocks.push_back(allocator.Allocate(size));
+  }
+  for (uint32_t i = 0; i < sizes.size(); ++i) {
+    allocator.Release(blocks.at(i), sizes.at(i));
+  }
+  std::thread([&]() {
+    for (size_t size : sizes) {
+      allocator.Release(allocator.Allocate(size), size);
+    }
+  }).join();
+  const TensorAllocatorStats stats = allocator.stats();
+  ASSERT_GT(stats.pool_hits, 1);
+  ASSERT_GT(stats.bytes_cached, 0);
+
+  // 清空全局池和所有线程的缓存
+  allocator.ReleaseCached();
+  ASSERT_EQ(allocator.stats().bytes_cached, 0);
+  void* block = allocator.Allocate(block_bytes);
+  ASSERT_EQ(allocator.stats().pool_hits, stats.pool_hits);
+  allocator.Release(block, block_bytes);
+}
+
+TEST(test_tensor, row_major_layout) {
+  using namespace kuiper_infer;
+  Tensor<float> f1(2, 3, 4, TensorLayout::kRowMajor);
+  ASSERT_EQ(f1.layout(), TensorLayout::kRowMajor);
+  ASSERT_EQ(f1.channels(), 2);
+  ASSERT_EQ(f1.rows(), 3);
+  ASSERT_EQ(f1.cols(), 4);
+
+  std::vector<float> values;
+  for (int i = 0; i < 24; ++i) {
+    values.push_back(float(i));
+  }
+  f1.fill(values);
+  for (uint32_t c = 0; c < 2; ++c) {
+    for (uint32_t r = 0; r < 3; ++r) {
+      for (uint32_t col = 0; col < 4; ++col) {
+        ASSERT_EQ(f1.at(c, r, col), float(c * 12 + r * 4 + col));
+      }
+    }
+  }
+  // 存储即为行主序的NCHW
+  for (int i = 0; i < 24; ++i) {
+    ASSERT_EQ(f1.index(i), float(i));
+  }
+
+  const float* ptr = f1.raw_ptr();
+  f1.reshape({4, 6}, true);
+  ASSERT_EQ(f1.raw_ptr(), ptr);
+  ASSERT_EQ(f1.channels(), 1);
+  ASSERT_EQ(f1.rows(), 4);
+  ASSERT_EQ(f1.cols(), 6);
+  ASSERT_EQ(f1.at(0, 1, 2), 8.f);
+
+  f1.flatten(true);
+  ASSERT_EQ(f1.raw_ptr(), ptr);
+  for (int i = 0; i < 24; ++i) {
+    ASSERT_EQ(f1.index(i), float(i));
+  }
+}
+
+TEST(test_tensor, convert_layout) {
+  using namespace kuiper_infer;
+  Tensor<float> f1(2, 3, 4);
+  std::vector<float> values;
+  for (int i = 0; i < 24; ++i) {
+    values.push_back(float(i));
+  }
+  f1.fill(values);
+
+  Tensor<float> f2(f1);
+  f2.convert_layout(TensorLayout::kRowMajor);
+  ASSERT_EQ(f2.shapes(), f1.shapes());
+  for (uint32_t c = 0; c < 2; ++c) {
+    for (uint32_t r = 0; r < 3; ++r) {
+      for (uint32_t col = 0; col < 4; ++col) {
+        ASSERT_EQ(f1.at(c, r, col), f2.at(c, r, col));
+      }
+    }
+  }
+
+  f1.flatten(true);
+  f2.flatten(true);
+  for (int i = 0; i < 24; ++i) {
+    ASSERT_EQ(f1.index(i), f2.index(i));
+  }
+}
+
+TEST(test_tensor, blocked_layout) {
+  using namespace kuiper_infer;
+  // 通道数不是块大小的整数倍, 空间尺寸覆盖8x8转置和尾部
+  const uint32_t channels = 13, rows = 5, cols = 11;
+  std::vector<float> values;
+  for (uint32_t i = 0; i < channels * rows * cols; ++i) {
+    values.push_back(float(i));
+  }
+  for (TensorLayout plain_layout : {TensorLayout::kColMajor, TensorLayout::kRowMajor}) {
+    Tensor<float> plain(channels, rows, cols, plain_layout);
+    plain.fill(values);
+    for (TensorLayout blocked_layout : {TensorLayout::kNCHW8c, TensorLayout::kNCHW16c}) {
+      const uint32_t block_size = TensorLayoutBlockSize(blocked_layout);
+      Tensor<float> blocked(plain);
+      blocked.convert_layout(blocked_layout);
+      ASSERT_EQ(blocked.layout(), blocked_layout);
+      ASSERT_EQ(blocked.shapes(), plain.shapes());
+      ASSERT_EQ(blocked.size(), (channels + block_size - 1) / block_size * block_size * rows * cols);
+
+      const float* blocked_ptr = blocked.raw_ptr();
+      for (uint32_t c = 0; c < channels; ++c) {
+        for (uint32_t r = 0; r < rows; ++r) {
+          for (uint32_t col = 0; col < cols; ++col) {
+            ASSERT_EQ(blocked.at(c, r, col), plain.at(c, r, col));
+            const size_t offset =
+                ((c / block_size * rows + r) * cols + col) * block_size + c % block_size;
+            ASSERT_EQ(blocked_ptr[offset], plain.at(c, r, col));
+          }
+        }
+      }
+
+      Tensor<float> restored(channels, rows, cols, plain_layout);
+      TensorReorder(blocked, restored);
+      for (uint32_t i = 0; i < plain.size(); ++i) {
+        ASSERT_EQ(restored.index(i), plain.index(i));
+      }
+    }
+  }
+}
+
+TEST(test_tensor, blocked_layout_fill) {
+  using namespace kuiper_infer;
+  Tensor<float> blocked(16, 4, 8, TensorLayout::kNCHW8c);
+  std::vector<float> values;
+  for (int i = 0; i < 16 * 4 * 8; ++i) {
+    values.push_back(float(i));
+  }
+  blocked.fill(values);
+  ASSERT_EQ(blocked.at(9, 2, 3), 9 * 32 + 2 * 8 + 3);
+
+  std::vector<float> buffer(blocked.size());
+  Tensor<float> view(buffer.data(), {16, 4, 8}, TensorLayout::kNCHW16c);
+  TensorReorder(blocked, view);
+  view.convert_layout(TensorLayout::kRowMajor);
+  for (int i = 0; i < 16 * 4 * 8; ++i) {
+    ASSERT_EQ(buffer.at(i), float(i));
+  }
+}
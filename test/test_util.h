@@ -0,0 +1,50 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "data/tensor.h"
+
+namespace kuiper_infer {
+/*
+* @brief 确定性的测试数据, 第i个值为scale * sin(i * 0.61 + phase)
+* @param size 数据个数
+* @param scale 幅度
+* @param phase 相位, 不同的相位得到不同的数据
+* @return 测试数据
+*/
+inline std::vector<float> TestValues(size_t size, float scale, float phase) {
+  std::vector<float> values(size);
+  for (size_t i = 0; i < size; ++i) {
+    values.at(i) = scale * std::sin(float(i) * 0.61f + phase);
+  }
+  return values;
+}
+
+/*
+* @brief 以TestValues填充的张量
+*
+* 按(通道, 行, 列)的逻辑顺序填充, 数值与布局无关
+* @param channels 通道数
+* @param rows 行数
+* @param cols 列数
+* @param scale 幅度
+* @param phase 相位
+* @param layout 张量布局
+* @return 测试张量
+*/
+inline sftensor TestTensor(uint32_t channels, uint32_t rows, uint32_t cols, float scale,
+                           float phase, TensorLayout layout = TensorLayout::kColMajor) {
+  sftensor tensor = std::make_shared<ftensor>(channels, rows, cols, layout);
+  const std::vector<float> values = TestValues(size_t(channels) * rows * cols, scale, phase);
+  for (uint32_t c = 0; c < channels; ++c) {
+    for (uint32_t r = 0; r < rows; ++r) {
+      for (uint32_t w = 0; w < cols; ++w) {
+        tensor->at(c, r, w) = values.at((size_t(c) * rows + r) * cols + w);
+      }
+    }
+  }
+  return tensor;
+}
+}  // namespace kuiper_infer
@@ -0,0 +1,98 @@
+// 合成一个大图的pnnx.param, 测量Graph::load和Graph::parse的耗时
+// 用法: bench_param_load [operators=100000] [repeats=3]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "runtime/pnnx/ir.h"
+#include "runtime/pnnx/store_zip.h"
+
+// 卷积, 激活和残差加法交替的链, 参数和形状的写法与PNNX导出的一致
+static std::string SyntheticParam(int operators) {
+  std::ostringstream param;
+  param << "7767517\n" << operators + 2 << " " << operators + 1 << "\n";
+  param << "pnnx.Input pnnx_input_0 0 1 0 #0=(1,64,56,56)f32\n";
+  for (int i = 0; i < operators; ++i) {
+    const int input = i;
+    const int output = i + 1;
+    const std::string shape = "(1,64,56,56)f32";
+    switch (i % 3) {
+      case 0:
+        param << "nn.Conv2d conv_" << i << " 1 1 " << input << " " << output
+              << " bias=True dilation=(1,1) groups=1 in_channels=64 kernel_size=(3,3) "
+              << "out_channels=64 padding=(1,1) padding_mode=zeros stride=(1,1) "
+              << "#" << input << "=" << shape << " #" << output << "=" << shape << "\n";
+        break;
+      case 1:
+        param << "nn.LeakyReLU relu_" << i << " 1 1 " << input << " " << output
+              << " negative_slope=1.000000e-01 #" << input << "=" << shape << " #" << output
+              << "=" << shape << "\n";
+        break;
+      default:
+        param << "pnnx.Expression add_" << i << " 2 1 " << input << " " << std::max(input - 2, 0)
+              << " " << output << " expr=add(@0,@1) #" << input << "=" << shape << " #"
+              << std::max(input - 2, 0) << "=" << shape << " #" << output << "=" << shape << "\n";
+        break;
+    }
+  }
+  param << "pnnx.Output pnnx_output_0 1 0 " << operators << " #" << operators
+        << "=(1,64,56,56)f32\n";
+  return param.str();
+}
+
+template <typename Function>
+static double BestMilliseconds(int repeats, Function&& function) {
+  double best = 1e30;
+  for (int r = 0; r < repeats; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return best;
+}
+
+int main(int argc, char** argv) {
+  const int operators = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+  if (operators <= 0 || repeats <= 0) {
+    std::fprintf(stderr, "Usage: %s [operators=100000] [repeats=3]\n", argv[0]);
+    return -1;
+  }
+
+  const std::string param = SyntheticParam(operators);
+  const std::string param_path = "./bench_param_load.pnnx.param";
+  const std::string bin_path = "./bench_param_load.pnnx.bin";
+  {
+    std::ofstream param_file(param_path, std::ios::binary);
+    param_file << param;
+    pnnx::StoreZipWriter szw;
+    if (szw.open(bin_path) != 0) {
+      return -1;
+    }
+    szw.close();
+  }
+
+  size_t loaded_ops = 0;
+  const double load_ms = BestMilliseconds(repeats, [&]() {
+    pnnx::Graph graph;
+    graph.load(param_path, bin_path);
+    loaded_ops = graph.ops.size();
+  });
+  size_t parsed_ops = 0;
+  const double parse_ms = BestMilliseconds(repeats, [&]() {
+    pnnx::Graph graph;
+    graph.parse(param);
+    parsed_ops = graph.ops.size();
+  });
+  std::printf("param: %zu bytes, %d operators\n", param.size(), operators + 2);
+  std::printf("Graph::load  %10.2f ms, %zu operators\n", load_ms, loaded_ops);
+  std::printf("Graph::parse %10.2f ms, %zu operators\n", parse_ms, parsed_ops);
+
+  std::remove(param_path.c_str());
+  std::remove(bin_path.c_str());
+  return 0;
+}
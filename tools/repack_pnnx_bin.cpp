@@ -0,0 +1,51 @@
+// 把pnnx.bin重写为每个条目的数据都按固定字节数对齐的版本
+// 用法: repack_pnnx_bin <input.pnnx.bin> <output.pnnx.bin> [alignment=64]
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "runtime/pnnx/store_zip.h"
+
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 4) {
+    std::fprintf(stderr, "Usage: %s <input.pnnx.bin> <output.pnnx.bin> [alignment=64]\n", argv[0]);
+    return -1;
+  }
+  const std::string input_path = argv[1];
+  const std::string output_path = argv[2];
+  const int alignment = argc == 4 ? std::atoi(argv[3]) : 64;
+  if (alignment < 1 || alignment > 4096 || (alignment & (alignment - 1)) != 0) {
+    std::fprintf(stderr, "The alignment must be a power of two up to 4096, got %s\n", argv[3]);
+    return -1;
+  }
+  if (input_path == output_path) {
+    std::fprintf(stderr, "The output must not overwrite the input\n");
+    return -1;
+  }
+
+  pnnx::StoreZipReader reader;
+  if (reader.open(input_path) != 0) {
+    std::fprintf(stderr, "Can not open %s\n", input_path.c_str());
+    return -1;
+  }
+  pnnx::StoreZipWriter writer;
+  if (writer.open(output_path, alignment) != 0) {
+    std::fprintf(stderr, "Can not create %s\n", output_path.c_str());
+    return -1;
+  }
+
+  std::vector<char> data;
+  const std::vector<std::string> names = reader.get_names();
+  for (const std::string& name : names) {
+    data.resize(reader.get_file_size(name));
+    if (reader.read_file(name, data.data()) != 0 ||
+        writer.write_file(name, data.data(), data.size()) != 0) {
+      std::fprintf(stderr, "Can not repack %s\n", name.c_str());
+      return -1;
+    }
+  }
+  writer.close();
+  std::printf("Repacked %zu entries aligned to %d bytes into %s\n", names.size(), alignment,
+              output_path.c_str());
+  return 0;
+}